@@ -11,18 +11,99 @@ Date: Dec 29, 2025
 #include <string.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <errno.h>
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 // Constants
 #define LEN_NAME            30              // Name length
-#define LEN_REC             1000            // Receipt length
+#define LEN_REC_FIXED       1000            // Body array of the old fixed-size node (memory reports only)
 #define FILE_NAME           "receipts.txt"  // Receipts file name
 #define LEN_PREFIX_NAME     6               // Length of "Name: "
 #define LEN_PREFIX_RECEIPT  9               // Length of "Receipt: "
+#define LEN_PREFIX_ID       4               // Length of "Id: "
 #define LEN_DATETIME_FORMAT 26              // Length of "YYYY-MM-DD HH:MM:SS"
-#define LEN_INPUT_BUFFER    10              // Input buffer for menu choices
+#define LEN_INPUT_BUFFER    16              // Input buffer for menu choices (fits a 32-bit ID)
+#define PAGE_SIZE           20              // Receipts per page in the paged view
 #define LEN_LOG_MSG         50              // Small log message buffer
+#define LOAD_BATCH_INITIAL  256             // Initial capacity of the bulk-load node batch
+#define PARALLEL_MIN_BYTES  (4u << 20)     // Files at least this large are parsed on a worker pool
+#define MAX_LOAD_THREADS    64              // Upper bound on loader worker threads
+#define RANGES_PER_THREAD   4               // Byte ranges per worker, for load balancing
+#define LEN_PATH            4096            // Path buffer for derived file names
+#define SNAPSHOT_EXT        ".bin"          // Binary snapshot extension (receipts.bin)
+#define SNAPSHOT_MAGIC      "CKBKSNAP"      // Snapshot file signature (8 bytes)
+#define SNAPSHOT_VERSION    3               // Snapshot format version
+#define SNAPSHOT_IO_BUFFER  (1u << 20)     // stdio buffer used when writing a snapshot
+#define REWRITE_BUFFER      (4u << 20)     // Records serialized per write() by write_receipts_file()
+#define APPEND_BUFFER       (1u << 20)     // New records held by the append writer before an early write()
+#define INDEX_EXT           ".idx"          // Sidecar index extension (receipts.idx)
+#define INDEX_MAGIC         "CKBKIDX1"      // Sidecar index signature (8 bytes)
+#define INDEX_VERSION       2               // Sidecar index format version
+#define HASH_BLOCK          4096            // Blocks of the index's content hash; an in-place patch stays within one
+#define LEN_INDEX_NAME      32              // Name field of an index entry (LEN_NAME, padded)
+#define JOURNAL_EXT         ".jnl"          // Update/delete journal extension (receipts.jnl)
+#define JOURNAL_MAGIC       "CKBKJNL1"      // Journal file signature (8 bytes)
+#define JOURNAL_VERSION     1               // Journal format version
+#define COMPACT_EXT         ".compact"      // Suffix of the text file a compaction writes (receipts.txt.compact)
+#define COMPACT_DEAD_PCT    50              // Compact once dead bytes reach this percentage of live bytes
+#define COMPACT_MIN_DEAD    (64u << 10)     // ...and at least this many bytes are dead
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ull  // FNV-1a 64-bit offset basis
+#define FNV_PRIME           0x100000001b3ull       // FNV-1a 64-bit prime
+#define PROGRESS_STRIDE     1024            // Records parsed between progress updates
+#define PROGRESS_REDRAW_MS  100             // Menu redraw interval while loading
+#define BODY_CACHE_SLOTS    64              // Bodies kept in memory at once in lazy mode
+#define BODY_CHUNK_SIZE     (256u << 10)    // Body arena chunk size and alignment (power of two)
+#define BODY_LARGE          (BODY_CHUNK_SIZE / 8)  // Bodies past this get a chunk of their own
+#define BODY_SLICE_ALIGN    4               // Alignment of arena slices (of their length prefix)
+#define NODE_SLAB_SIZE      (64u << 10)     // Node slab size and alignment (power of two)
+#define ID_INDEX_INITIAL    64              // Initial slot count of the ID index (power of two)
+#define NODE_TABLE_INITIAL  1024            // Initial slot count of the node table
+#define NAME_KEY_BYTES      8               // Folded name bytes packed into a node's sort key
+#define BTREE_NODE_SIZE     256             // B+tree node size and alignment (four 64-byte cache lines)
+#define BTREE_LEAF_SLOTS    10              // Hot records per B+tree leaf (fills BTREE_NODE_SIZE)
+#define BTREE_FANOUT        7               // Children per inner B+tree node (fills BTREE_NODE_SIZE)
+#define BTREE_SPARE_MAX     64              // Freed B+tree nodes kept for reuse
+#define WATCH_HEAD_BYTES    4096            // Leading bytes hashed to detect in-place rewrites
+#define SCAN_BLOCK          64              // Bytes classified per newline-scanner step (one mask bit each)
+#define BENCH_TEMPLATE      "/tmp/cookbook_bench_XXXXXX"  // Benchmark corpus path template
+#define BENCH_LEGACY_MAX    10000           // Largest corpus timed with per-record insertion
+#define BENCH_SCAN_BYTES    (100u << 20)    // Size of the scanner benchmark corpus
+#define BENCH_SCAN_RUNS     3               // Scanner benchmark repetitions (best is reported)
+#define BENCH_CORPUS_OPS    1000            // Inserts and lookups timed per corpus
+#define BENCH_ID_OPS        10000           // ID lookups timed by the ids benchmark
+#define BENCH_RANK_OPS      10000           // Rank and select queries timed by the rank benchmark
+#define BENCH_STORE_OPS     10000           // Inserts, deletes and selects timed per ordered store
+#define BENCH_HANDLE_OPS    1000000         // Handle resolutions timed by the handles benchmark
+#define BENCH_JOURNAL_OPS   1000            // Updates and deletes timed per journal benchmark corpus
+#define BENCH_REWRITE_OPS   10              // Full rewrites timed as the journal benchmark's baseline
+#define BENCH_COMPACT_OPS   100             // Updates timed while the compact benchmark's compaction runs
+#define BENCH_APPEND_OPS    1000            // Receipts created per durability mode by the append benchmark
+#define BENCH_APPEND_MS     1               // Commit window of the append benchmark's interval mode
+#define BENCH_PATCH_OPS     1000            // Updates timed per run of the patch benchmark
+#define BENCH_REWRITE_RUNS  3               // Writer benchmark repetitions (best is reported)
+#define BENCH_TRAVERSE_RUNS 20              // Passes per traversal in the traverse benchmark
+#define BENCH_MEMORY_BODY_MIN 20            // Body length range of the memory benchmark corpus
+#define BENCH_MEMORY_BODY_MAX 3000
+#define CORPUS_DEFAULT_COUNT 10000          // Records written by "generate" without --count
+#define CORPUS_DEFAULT_SEED 2463534242u     // Generator seed, so corpora are reproducible
+#define CORPUS_NAME_MIN     4               // Default name length range
+#define CORPUS_NAME_MAX     (LEN_NAME - 1)
+#define CORPUS_BODY_MIN     20              // Default body length range
+#define CORPUS_BODY_MAX     400
 
 #define KEY_UP              65
 #define KEY_DOWN            66
@@ -42,64 +123,812 @@ typedef enum {
     MENU_VIEW = 2,
     MENU_UPDATE = 3,
     MENU_DELETE = 4,
+    MENU_BROWSE = 5,
 } MenuChoice;
 
+typedef enum {
+    JOURNAL_UPSERT = 1,         // Name and body of a receipt, created or replaced
+    JOURNAL_DELETE = 2,         // Receipt removed
+} JournalOp;
+
+typedef enum {
+    COMPACT_IDLE = 0,
+    COMPACT_RUNNING = 1,        // The worker is writing the compacted files
+    COMPACT_DONE = 2,           // Waiting for compaction_finish() to swap them in
+} CompactionState;
+
+typedef enum {
+    DURABLE_EVERY_OP = 0,       // Write and fsync each new receipt before create_receipt() returns
+    DURABLE_INTERVAL = 1,       // Group commit: one write and one fsync per commit window
+    DURABLE_ON_EXIT = 2,        // Write when the buffer fills, fsync only at exit
+} Durability;
+
 // Set minimum log level to display (logs below this level will be filtered out)
 #define MIN_LOG_LEVEL LOG_INFO
 
+// Runtime log threshold (starts at MIN_LOG_LEVEL; benchmarks raise it to keep output clean)
+static LogLevel min_log_level = MIN_LOG_LEVEL;
+
+// Path of the receipts file (benchmarks point it at temporary corpora)
+static const char *receipts_path = FILE_NAME;
+
 // Struct
 typedef struct Receipt {
-    uint16_t id;
+    uint32_t id;            // Stable ID, persisted in the file as an "Id: " line
     char name[LEN_NAME];
-    char receipt[LEN_REC];
+    char folded[LEN_NAME];  // Name lowercased and null-padded (see set_receipt_name())
+    uint64_t name_key;      // First NAME_KEY_BYTES of folded, big-endian: orders like the name
+    uint32_t body_len;      // Body length in bytes
+    uint32_t slot;          // Node table slot + 1 of the node's handle, 0 until one is issued
+    uint8_t id_positional;  // Parser only: id is the record's position, the file had no "Id: " line
+    uint8_t journaled;      // A journal record supersedes the text record since the last rewrite
+    uint32_t body_slack;    // Filler bytes after the body's line, free for a longer body (see patch_receipt())
+    char *receipt;          // Body text, or NULL while it only lives on disk (lazy mode)
+    off_t body_off;         // Offset of the body in the receipts file, -1 if not written yet
     struct Receipt *next;
     struct Receipt *prev;
 } Receipt;
 
+// Output buffer of the text file writer, flushed with one write() when full
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t capacity;
+    uint8_t ok;                 // Cleared by the first failed write
+} WriteBuffer;
+
+// Growable array of parsed nodes used by the bulk loader
+typedef struct {
+    Receipt **items;
+    size_t count;
+    size_t capacity;
+} ReceiptBatch;
+
+// Chunk of the body arena, followed by its slices: a uint32_t length, the body and a null
+typedef struct BodyChunk {
+    struct BodyChunk *prev;     // Neighbours in the chunk registry
+    struct BodyChunk *next;
+    size_t size;                // Bytes of slices the chunk can hold
+    size_t used;                // Bytes carved out so far
+    size_t live;                // Slices not released yet
+    size_t live_bytes;          // Bytes of those slices
+    uint8_t open;               // Still some thread's current chunk
+} BodyChunk;
+
+// Slab of the node pool, followed by capacity Receipt slots
+typedef struct NodeSlab {
+    struct NodeSlab *next;      // Next slab of the pool
+    size_t capacity;            // Node slots after the header
+    size_t used;                // Slots carved out so far
+    size_t live;                // Nodes handed out and not freed
+} NodeSlab;
+
+// Per-thread end of the node pool: a slab to carve from and a freelist
+typedef struct {
+    NodeSlab *slab;             // Slab new nodes are carved from
+    Receipt *free;              // Freed nodes, linked through next
+    size_t free_count;
+    size_t allocs;              // Nodes handed out
+    size_t recycled;            // Of those, taken from a freelist
+    size_t frees;               // Nodes given back
+} NodeCache;
+
+// Shared node pool: every slab, and the nodes finished threads handed back
+typedef struct {
+    pthread_mutex_t lock;
+    NodeSlab *slabs;
+    size_t slab_count;
+    Receipt *free;              // Linked through next
+    size_t free_count;
+    size_t allocs;              // Counters of finished threads
+    size_t recycled;
+    size_t frees;
+} NodePool;
+
+// Snapshot of the node pool and body arena (see allocator_stats())
+typedef struct {
+    size_t slabs;
+    size_t slots;               // Node slots in all slabs
+    size_t carved;              // Slots handed out at least once
+    size_t live_nodes;
+    size_t free_nodes;          // Nodes on a freelist
+    size_t allocs;
+    size_t recycled;
+    size_t frees;
+    size_t chunks;
+    size_t chunk_bytes;         // Bytes of all body chunks, headers included
+    size_t live_bodies;
+    size_t body_bytes;          // Bytes of live slices
+} AllocatorStats;
+
+// Generational handle to a receipt (see receipt_handle(), receipt_get())
+typedef struct {
+    uint32_t slot;              // Node table slot + 1, 0 for no receipt
+    uint32_t generation;        // Generation of the slot when the handle was issued
+} ReceiptHandle;
+
+// Slot of the node table: the node its handles resolve to while the generation matches
+typedef struct {
+    Receipt *node;              // NULL while the slot is free
+    uint32_t generation;        // Bumped every time the slot is released
+    uint32_t next_free;         // Free slots: next free slot + 1, 0 at the end
+} NodeTableSlot;
+
+// Table of every node a handle was issued for; freed slots are reused with a new generation
+typedef struct {
+    NodeTableSlot *slots;
+    uint32_t count;             // Slots handed out at least once
+    uint32_t capacity;
+    uint32_t free;              // First free slot + 1, 0 when there is none
+    uint32_t live;              // Slots holding a node
+} NodeTable;
+
+// Slot of the bounded body cache used in lazy mode
+typedef struct {
+    ReceiptHandle owner;
+    char *text;
+    uint64_t last_used;     // Cache clock value of the last hit (0 = empty)
+} BodyCacheSlot;
+
+// Binary snapshot header (native byte order, no padding)
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;             // Number of records in the table
+    uint64_t source_size;       // Size of the text file the snapshot mirrors
+    int64_t source_mtime_sec;   // Modification time of the text file
+    int64_t source_mtime_nsec;
+    uint64_t heap_size;         // Bytes of string heap after the table
+} SnapshotHeader;
+
+// Fixed-width snapshot record; name/body offsets are relative to the string heap
+typedef struct {
+    uint64_t text_off;          // Offset of the body in the text file (for lazy reads)
+    uint32_t id;
+    uint32_t name_off;
+    uint32_t name_len;
+    uint32_t body_off;
+    uint32_t body_len;
+    uint32_t reserved;
+} SnapshotRecord;
+
+// Sidecar index header (native byte order, no padding)
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;             // Number of entries
+    uint64_t source_size;       // Size of the text file the index describes
+    int64_t source_mtime_sec;   // Modification time of the text file
+    int64_t source_mtime_nsec;
+    uint64_t source_hash;       // Sum of the FNV-1a 64 hashes of the text file's blocks (see hash_file_blocks())
+} IndexHeader;
+
+// Sidecar index entry, sorted like the list (name, then ID)
+typedef struct {
+    uint64_t body_off;          // Offset of the body in the text file
+    uint32_t id;
+    uint32_t body_len;
+    char name[LEN_INDEX_NAME];  // Null-padded name
+} IndexEntry;
+
+// Journal header (native byte order, no padding); records follow it back to back
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t head_len;          // Leading bytes of the text file covered by head_hash
+    uint64_t source_ino;        // Inode of the text file the records apply to
+    uint64_t source_size;       // Size of the text file when the journal was started
+    uint64_t head_hash;         // FNV-1a 64 of the first head_len bytes of the text file
+} JournalHeader;
+
+// Journal record, followed by the name and body of an upsert
+typedef struct {
+    uint32_t op;                // JournalOp
+    uint32_t id;
+    uint32_t name_len;
+    uint32_t body_len;
+    uint64_t checksum;          // FNV-1a 64 of the fields above, the name and the body
+} JournalRecord;
+
+// Hot part of a receipt: what ordered walks, name searches and ID scans read
+typedef struct {
+    Receipt *node;              // Handle of the full record
+    uint64_t key;               // The node's name_key
+    uint32_t id;
+} HotRecord;
+
+// Contiguous array of hot records mirroring the list, for binary search by name
+typedef struct {
+    HotRecord *items;           // Hot records in list order
+    size_t count;
+    size_t capacity;
+    Receipt *head;              // Head of the list the table describes
+    uint8_t valid;
+} NameTable;
+
+// Entry of the ID index: the ID, so probes stay in the array, and the receipt's handle
+typedef struct {
+    uint32_t id;
+    ReceiptHandle handle;       // slot 0 = empty entry
+} IdIndexEntry;
+
+// Open-addressing hash from receipt ID to handle (linear probing, power-of-two capacity)
+typedef struct {
+    IdIndexEntry *slots;
+    size_t capacity;
+    size_t count;
+    Receipt *head;              // Head of the list the index describes
+    uint8_t valid;
+} IdIndex;
+
+// B+tree leaf: a run of hot records in list order, linked to the next leaf
+typedef struct BTreeLeaf {
+    struct BTreeLeaf *next;
+    uint32_t count;
+    HotRecord items[BTREE_LEAF_SLOTS];
+} BTreeLeaf;
+
+// Inner B+tree node: each child with the number of records under it and the first of them
+typedef struct {
+    uint32_t count;                 // Children in use
+    uint32_t sizes[BTREE_FANOUT];   // Records under each child (for rank and select)
+    void *children[BTREE_FANOUT];   // Inner nodes, or leaves on the lowest inner level
+    HotRecord lows[BTREE_FANOUT];   // First record under each child
+} BTreeInner;
+
+// B+tree of hot records in list order (name, then ID), see btree_insert()
+typedef struct {
+    void *root;                     // Leaf or inner node, NULL when empty
+    uint32_t height;                // Inner levels above the leaves
+    size_t count;                   // Records stored
+    size_t nodes;                   // Leaves and inner nodes in the tree
+    void *spare;                    // Freed nodes, linked through their first word
+    size_t spare_count;
+} BTree;
+
+// Run of consecutive hot records in list order (see OrderedStore)
+typedef struct {
+    HotRecord *items;
+    size_t count;
+    void *cursor;                   // Where the next run starts (store specific)
+} StoreRun;
+
+// Ordered container behind insert_alphabetically(), detach_receipt() and the listings
+typedef struct {
+    const char *name;
+    uint8_t (*build)(Receipt *head);                    // Describe the list at head (one O(n) pass)
+    uint8_t (*insert)(Receipt *node, Receipt **prev);   // Add in order; *prev gets the record before node, NULL at the front
+    uint8_t (*remove)(const Receipt *node);             // 0 if node is not stored
+    Receipt *(*find_name)(uint64_t key, const char *folded);  // First record with a name, or NULL
+    size_t (*rank)(const Receipt *node);                // Position of node, count() if it is not stored
+    uint8_t (*seek)(size_t rank, StoreRun *run);        // Run starting at a position, 0 past the end
+    uint8_t (*next)(StoreRun *run);                     // Run following run, 0 at the end
+    size_t (*count)(void);
+    void (*clear)(void);                                // Release the storage
+} OrderedStore;
+
+// Background compaction: a private copy of the list and what the worker made of it (see compaction_start())
+typedef struct {
+    pthread_t thread;
+    atomic_int state;           // CompactionState
+    Receipt *nodes;             // Copies of the list's nodes, linked in list order
+    size_t count;
+    char *bodies;               // Bodies of the nodes that only had them in memory
+    int source_fd;              // Text file the copies' body offsets point into
+    ino_t source_ino;           // Text file and journal as they were when copied
+    off_t source_size;
+    uint64_t journal_size;
+    uint8_t snapshot;           // Write a snapshot too (one exists); cleared if that failed
+    char path[LEN_PATH];        // Compacted text file (receipts.txt.compact)
+    uint8_t ok;                 // Set by the worker: text file and index written
+    double worker_ms;           // Time the worker took
+    uint64_t bytes_written;     // Bytes of text file, index and snapshot it wrote
+    uint64_t dead_bytes;        // Estimated dead bytes in the text file and journal (menu thread only)
+    uint32_t renumbered;        // IDs renumbered in memory that the text file does not have yet (see id_index_sync())
+    uint32_t renumbered_copied; // Of those, the ones in the copy
+} Compaction;
+
+// Updates patched into the receipts file in place, and those that had to go elsewhere (see patch_receipt())
+typedef struct {
+    size_t patched;
+    size_t relocated;           // Journaled instead: did not fit, or could not be patched safely
+    uint64_t bytes;             // Bytes written by the patches
+} PatchStats;
+
+// Long-lived writer for new receipts, and what still has to reach the disk (see save_receipt_to_file())
+typedef struct {
+    int fd;                     // Receipts file, opened for appending on first use
+    dev_t dev;                  // ...and the file it is, to notice a rewrite or replacement
+    ino_t ino;
+    char *data;                 // Formatted records not written yet
+    size_t len;
+    size_t capacity;
+    Receipt **pending;          // Their receipts, in file order
+    size_t *body_at;            // Offset of each one's body in data
+    size_t count;
+    size_t pending_capacity;
+    uint8_t window;             // A commit window is open: records pending, or written but not synced
+    struct timespec since;      // When it opened
+    uint8_t unsynced;           // Records written to the receipts file since the last fsync
+    uint8_t journal_unsynced;   // Journal records written since the last fsync
+    uint8_t patch_unsynced;     // Records patched in place in the receipts file since the last fsync
+    Durability durability;
+    unsigned interval_ms;       // Commit window length for DURABLE_INTERVAL
+    size_t writes;              // write() and fsync calls issued, for the append benchmark
+    size_t syncs;
+} AppendWriter;
+
+// Totals of the compactions run so far (see print_compaction_stats())
+typedef struct {
+    size_t runs;                // Compactions swapped in
+    size_t discarded;           // Compactions thrown away because the files changed meanwhile
+    double last_ms;             // Worker time of the last one swapped in
+    double total_ms;
+    uint64_t bytes_before;      // Text file and journal sizes before each swap, summed
+    uint64_t bytes_after;       // Text file sizes after each swap, summed
+    uint64_t bytes_written;     // Text files, indexes and snapshots written, summed
+    uint64_t journal_bytes;     // Journal bytes folded in, summed
+} CompactionStats;
+
+// Shape of a synthetic cookbook written by write_corpus()
+typedef struct {
+    size_t count;               // Records to write (may exceed the 16-bit ID range)
+    uint32_t name_min;          // Name lengths are uniform in [name_min, name_max]
+    uint32_t name_max;
+    uint32_t body_min;          // Body lengths are uniform in [body_min, body_max]
+    uint32_t body_max;
+    uint8_t shuffled_pct;       // Percentage of records shuffled out of sorted order
+    uint32_t seed;              // xorshift32 seed
+} CorpusSpec;
+
+// Newline classifier for one SCAN_BLOCK-byte block: bit i is set when block[i] is '\n'
+typedef uint64_t (*NewlineMaskFn)(const char *block);
+
+// Line scanner over a buffer, caching the newline mask of the current block
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t block;               // Offset of the block mask describes
+    uint64_t mask;              // Newlines of that block not returned yet
+} LineScanner;
+
+// Shared state of a parallel load: byte ranges handed out to workers
+typedef struct {
+    const char *data;
+    size_t *range_starts;       // ranges + 1 offsets, last one is the file length
+    size_t ranges;
+    ReceiptBatch *batches;      // One sorted partial batch per range
+    atomic_size_t next_range;
+    atomic_int failed;
+} ParallelLoad;
+
+// Progress of the current load, published for the menu's progress indicator
+typedef struct {
+    atomic_size_t records;      // Records parsed so far
+    atomic_size_t done;         // Units processed (bytes of text, or snapshot/index entries)
+    atomic_size_t total;        // Units in the whole load
+} LoadProgress;
+
+// Background load: the list is handed to the menu through a completion barrier
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    uint8_t started;            // A loader thread was started
+    uint8_t done;               // Set under lock when head is ready
+    uint8_t collected;          // The menu has taken head
+    Receipt *head;
+} BackgroundLoad;
+
+static LoadProgress load_progress;
+static BackgroundLoad background_load = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .finished = PTHREAD_COND_INITIALIZER,
+};
+
+// Newline scanner picked at startup by select_newline_scanner() (no mask: memchr() per line)
+static NewlineMaskFn newline_mask = NULL;
+static const char *newline_scanner = NULL;
+
+// What part of the receipts file the list reflects, and the inotify watch on it
+typedef struct {
+    uint8_t valid;              // The fields below describe the loaded file
+    dev_t dev;
+    ino_t ino;
+    off_t loaded_size;          // Bytes of the file already in the list
+    size_t head_len;            // Leading bytes covered by head_hash
+    uint64_t head_hash;         // FNV-1a 64 of the first head_len bytes
+    int fd;                     // inotify descriptor, -1 when not watching
+    char name[LEN_PATH];        // Base name of the receipts file in the watched directory
+} FileWatch;
+
+static FileWatch file_watch = {.fd = -1};
+
+// Name table and ID index of the current list (see name_table_sync(), id_index_sync())
+static NameTable name_table;
+static IdIndex id_index;
+
+// B+tree behind the default ordered store, and the list the ordered store describes (see store_sync())
+static BTree btree;
+static Receipt *store_head = NULL;
+static uint8_t store_valid = 0;
+
+// Next ID handed out by get_new_id() (0 = initialize from the list)
+static uint32_t next_receipt_id = 0;
+
+// Lazy body loading: names stay in memory, bodies are read from body_fd on demand
+static uint8_t lazy_bodies = 0;
+static int body_fd = -1;
+static BodyCacheSlot body_cache[BODY_CACHE_SLOTS];
+static uint64_t body_cache_clock = 0;
+
+// Chunk the calling thread carves new bodies from (see body_alloc()), and every chunk
+static _Thread_local BodyChunk *body_arena = NULL;
+static pthread_mutex_t body_chunks_lock = PTHREAD_MUTEX_INITIALIZER;
+static BodyChunk *body_chunks = NULL;
+
+// Node pool: slabs and shared freelist, and the calling thread's slab and freelist
+static NodePool node_pool = {.lock = PTHREAD_MUTEX_INITIALIZER};
+static _Thread_local NodeCache node_cache;
+
+// Node table behind receipt handles (only touched by one thread at a time, see receipt_handle())
+static NodeTable node_table;
+
+// Background compaction of the receipts files, and its totals
+static Compaction compaction = {.source_fd = -1};
+static CompactionStats compaction_totals;
+
+// Writer for new receipts (durability per --durability, every op by default)
+static AppendWriter appender = {.fd = -1};
+
+// Totals of the in-place updates, and whether to make them ("--no-patch" journals every update)
+static PatchStats patch_totals;
+static uint8_t patch_in_place = 1;
 
 // Function prototypes
 void clear_terminal(void);
 void custom_log(LogLevel level, const char *message);
 void trim_newline(char *str);
+char *read_input_line(void);
 void free_list(Receipt *head);
+void teardown_receipts(void);
 void display_receipts(Receipt *head);
-void view_receipt(Receipt *head, uint16_t receipt_id);
+void display_page(Receipt *head, size_t page);
+void view_receipt(Receipt *head, uint32_t receipt_id);
 const char* log_level_to_string(LogLevel level);
-uint16_t get_new_id(Receipt *head);
-uint8_t parse_receipt_id(const char *input, uint16_t *receipt_id);
-int8_t case_insensitive_compare(const char *s1, const char *s2);
+uint32_t get_new_id(Receipt *head);
+uint8_t parse_receipt_id(const char *input, uint32_t *receipt_id);
+int case_insensitive_compare(const char *s1, const char *s2);
+void fold_name(char *folded, const char *name);
+uint64_t name_key(const char *folded);
+void set_receipt_name(Receipt *r, const char *name, size_t len);
+int compare_name_keys(uint64_t key_a, const char *folded_a, uint64_t key_b, const char *folded_b);
 // Terminal control
 void enable_raw_mode(struct termios *orig_termios);
 void disable_raw_mode(struct termios *orig_termios);
 // Core logic
 Receipt *load_receipts(void);
+Receipt *load_receipts_from(const char *path);
+Receipt *load_receipts_threads(const char *path, unsigned threads);
+uint8_t parse_receipt_range(const char *data, size_t len, off_t base, ReceiptBatch *batch);
+uint8_t is_filler_line(const char *line, size_t len);
+uint8_t parse_id_field(const char *text, size_t len, uint32_t *id);
+uint8_t parse_receipts_parallel(const char *data, size_t len, unsigned threads, ReceiptBatch *batch);
+void *parallel_load_worker(void *arg);
+size_t resync_to_record(const char *data, size_t len, size_t pos);
+uint8_t merge_sorted_runs(ReceiptBatch *batch, size_t *bounds, size_t runs);
+unsigned default_load_threads(size_t len);
+uint8_t batch_push(ReceiptBatch *batch, Receipt *node);
+Receipt *link_batch(ReceiptBatch *batch);
+int compare_receipts(const void *a, const void *b);
 Receipt *run_menu(Receipt *head);
+// Line scanning
+uint8_t select_newline_scanner(const char *name);
+#if defined(__x86_64__) || defined(__i386__)
+uint64_t newline_mask_sse2(const char *block);
+uint64_t newline_mask_avx2(const char *block);
+#endif
+void line_scanner_init(LineScanner *scanner, const char *data, size_t len);
+uint64_t line_scanner_classify(const LineScanner *scanner, size_t block);
+size_t line_scanner_next(LineScanner *scanner);
+// Background loading
+void start_background_load(void);
+void *background_load_worker(void *arg);
+uint8_t background_load_finished(void);
+Receipt *wait_for_load(Receipt *head);
+void reset_load_progress(size_t total);
+// File watching
+void start_file_watch(const char *path);
+void stop_file_watch(void);
+uint8_t file_watch_drain(void);
+void track_receipts_file(int fd, off_t loaded);
+void track_receipts_path(const char *path, const struct stat *expected);
+void track_own_append(const struct stat *before, size_t len);
+uint8_t hash_file_head(int fd, size_t len, uint64_t *hash);
+size_t complete_records_end(const char *data, size_t start, size_t len);
+Receipt *merge_lists(Receipt *a, Receipt *b);
+Receipt *sync_with_file(Receipt *head, long *change);
 Receipt *create_receipt(Receipt *head, const char *name, const char *receipt);
 Receipt *insert_alphabetically(Receipt *head, Receipt *new_receipt);
-Receipt *update_receipt(Receipt *head, uint16_t receipt_id, const char *name, const char *receipt);
+Receipt *link_alphabetically(Receipt *head, Receipt *new_receipt);
+Receipt *update_receipt(Receipt *head, uint32_t receipt_id, const char *name, const char *receipt);
 Receipt *detach_receipt(Receipt *head, Receipt *node);
-Receipt *delete_receipt(Receipt *head, uint16_t receipt_id);
+Receipt *delete_receipt(Receipt *head, uint32_t receipt_id);
+Receipt *find_receipt(Receipt *head, uint32_t receipt_id);
+Receipt *find_receipt_linear(Receipt *head, uint32_t receipt_id);
+Receipt *find_receipt_by_name(Receipt *head, const char *name);
+// Name table
+void hot_record_set(HotRecord *rec, Receipt *node);
+int hot_compare_name(const HotRecord *rec, uint64_t key, const char *folded);
+int hot_compare_receipt(const HotRecord *rec, const Receipt *node);
+uint8_t name_table_sync(Receipt *head);
+uint8_t name_table_reserve(size_t count);
+void name_table_invalidate(void);
+void name_table_clear(void);
+size_t name_table_upper_bound(const Receipt *node);
+size_t name_table_lower_bound(uint64_t key, const char *folded);
+size_t name_table_position(const Receipt *node);
+Receipt *select_receipt(Receipt *head, size_t rank);
+uint8_t receipt_rank(Receipt *head, uint32_t receipt_id, size_t *rank);
+// Ordered store
+uint8_t select_ordered_store(const char *name);
+uint8_t store_sync(Receipt *head);
+void store_invalidate(void);
+void store_clear(void);
+uint8_t list_store_build(Receipt *head);
+uint8_t list_store_insert(Receipt *node, Receipt **prev);
+uint8_t list_store_remove(const Receipt *node);
+Receipt *list_store_find_name(uint64_t key, const char *folded);
+size_t list_store_rank(const Receipt *node);
+uint8_t list_store_seek(size_t rank, StoreRun *run);
+uint8_t list_store_next(StoreRun *run);
+size_t list_store_count(void);
+// B+tree
+void *btree_node_new(void);
+void btree_node_release(void *node);
+uint8_t btree_reserve(size_t nodes);
+void btree_free(void *node, uint32_t height);
+void btree_clear(void);
+void btree_refresh(BTreeInner *inner, uint32_t i, uint32_t child_height);
+void btree_fill(BTreeInner *inner, void *const *children, uint32_t count, uint32_t child_height);
+uint8_t btree_build(Receipt *head);
+void *btree_insert_into(void *n, uint32_t height, Receipt *node, Receipt **prev);
+uint8_t btree_insert(Receipt *node, Receipt **prev);
+void btree_remove_at(void *n, uint32_t height, size_t rank);
+void btree_rebalance(BTreeInner *inner, uint32_t i, uint32_t child_height);
+uint8_t btree_remove(const Receipt *node);
+BTreeLeaf *btree_leaf_at(size_t rank, uint32_t *pos);
+BTreeLeaf *btree_lower_bound(uint64_t key, const char *folded, uint32_t *pos, size_t *rank);
+Receipt *btree_find_name(uint64_t key, const char *folded);
+size_t btree_rank(const Receipt *node);
+uint8_t btree_seek(size_t rank, StoreRun *run);
+uint8_t btree_next(StoreRun *run);
+size_t btree_count(void);
+// ID index
+size_t id_index_slot(uint32_t id);
+uint8_t id_index_sync(Receipt *head);
+void renumber_relink(Receipt *node);
+void id_index_invalidate(void);
+void id_index_clear(void);
+uint8_t id_index_reserve(size_t count);
+uint8_t id_index_insert(Receipt *node);
+uint8_t id_index_remove(const Receipt *node);
+ReceiptHandle id_index_find(uint32_t receipt_id);
+ReceiptHandle find_receipt_handle(Receipt *head, uint32_t receipt_id);
+// Body storage
+size_t body_slice_size(size_t len);
+uint32_t body_slice_len(const char *body);
+BodyChunk *body_chunk(const char *body);
+char *body_alloc(const char *text, size_t len);
+void body_release(const char *body);
+void body_arena_close(void);
+BodyChunk *body_chunk_new(size_t size, uint8_t open);
+void body_chunk_free(BodyChunk *chunk);
+void body_arena_reset(void);
+// Node pool
+NodeSlab *node_slab(const Receipt *node);
+Receipt *node_alloc(void);
+void node_free(Receipt *node);
+uint8_t node_pool_refill(NodeCache *cache);
+void node_cache_close(void);
+void node_pool_reset(void);
+void allocator_stats(AllocatorStats *stats);
+void print_allocator_stats(const char *label);
+// Node table
+ReceiptHandle receipt_handle(Receipt *node);
+Receipt *receipt_get(ReceiptHandle handle);
+uint8_t node_table_reserve(uint32_t count);
+void node_table_release(Receipt *node);
+void node_table_reset(void);
+const char *receipt_body(Receipt *r);
+uint8_t set_receipt_body(Receipt *r, const char *text, size_t len);
+void body_cache_forget(const Receipt *r);
+void body_cache_clear(void);
+void open_body_source(const char *path);
+const char *map_body_source(size_t *len);
+const char *map_for_copy(int fd, size_t *len);
+const char *body_bytes(const Receipt *r, const char *source, size_t source_len);
 // File I/O
 uint8_t save_receipt_to_file(Receipt *r);
+uint8_t select_durability(const char *text);
+uint8_t append_flush(void);
+uint8_t append_commit(void);
+int append_due_ms(void);
+void append_commit_due(void);
+void append_commit_open(void);
+uint8_t sync_path(const char *path);
+uint8_t append_written(int fd, uint8_t *unsynced);
+void append_drop(void);
+void append_close(void);
+uint8_t patch_receipt(Receipt *r, const char *text, size_t len);
 uint8_t rewrite_receipts_to_file(Receipt *head);
+uint8_t write_receipts_file(Receipt *head, const char *path, const char *source, size_t source_len, off_t *offsets, uint8_t durable);
+void write_buffer_put(WriteBuffer *out, const char *data, size_t len);
+void write_buffer_flush(WriteBuffer *out);
+uint8_t write_all(int fd, const char *data, size_t len);
+uint8_t sync_directory_of(const char *path);
+void sidecar_path(char *out, size_t size, const char *data_path, const char *ext);
+uint8_t write_snapshot(Receipt *head, const char *data_path);
+uint8_t load_snapshot(const char *data_path, Receipt **head);
+// Sidecar index
+uint64_t fnv1a64(uint64_t hash, const void *data, size_t len);
+uint8_t hash_file(const char *path, uint64_t *hash);
+uint64_t hash_block(uint64_t block, const char *data, size_t len);
+uint8_t hash_file_blocks(const char *path, uint64_t *hash);
+uint8_t hash_blocks_at(int fd, off_t from, off_t to, off_t size, uint64_t *hash);
+int compare_index_entries(const void *a, const void *b);
+int compare_ids(const void *a, const void *b);
+uint8_t write_index(Receipt *head, const char *data_path);
+uint8_t write_index_file(const char *data_path, const IndexHeader *header, const IndexEntry *entries);
+uint8_t load_index(const char *data_path, Receipt **head);
+uint8_t index_append(const char *data_path, Receipt *const *added, size_t count, const struct stat *before);
+uint8_t index_patch(const char *data_path, const Receipt *r, uint32_t body_len, const struct stat *before, const struct stat *after, uint64_t old_terms, uint64_t new_terms);
+int verify_index(const char *data_path);
+// Journal
+uint8_t journal_source(const char *data_path, JournalHeader *header);
+uint8_t journal_matches(const char *data_path, const JournalHeader *header);
+uint64_t journal_checksum(const JournalRecord *rec, const char *name, const char *body);
+uint8_t journal_append(const char *data_path, JournalOp op, Receipt *r);
+Receipt *journal_replay(Receipt *head, const char *data_path);
+Receipt *journal_apply(Receipt *head, const JournalRecord *rec, const char *name, const char *body);
+void journal_reset(const char *data_path);
+// Compaction
+uint64_t record_bytes(const Receipt *r);
+uint64_t file_bytes(const char *path);
+uint8_t compaction_due(void);
+uint8_t compaction_start(Receipt *head);
+void *compaction_worker(void *arg);
+uint8_t compaction_running(void);
+void compaction_poll(Receipt *head);
+uint8_t compaction_finish(Receipt *head);
+uint8_t compaction_current(Receipt *head);
+void compaction_release(void);
+void print_compaction_stats(const char *label);
+// Benchmarks
+int run_benchmarks(const char *suite);
+int bench_load(void);
+int bench_parallel(void);
+int bench_snapshot(void);
+int bench_lazy(void);
+int bench_index(void);
+int bench_startup(void);
+int bench_scan(void);
+size_t count_records_memchr(const char *data, size_t len);
+size_t count_records_scanner(const char *data, size_t len);
+size_t list_memory(Receipt *head);
+double elapsed_ms(const struct timespec *start);
+uint8_t write_bench_corpus(const char *path, size_t count, uint8_t shuffled);
+uint8_t bench_temp_file(char *path);
+uint8_t bench_corpus_file(char *path, const CorpusSpec *spec);
+uint8_t bench_positional_file(char *path, size_t count, uint8_t shuffled);
+void bench_cleanup(const char *path);
+int bench_corpus(void);
+int bench_ids(void);
+int bench_traverse(void);
+uint8_t body_memory(Receipt *head, size_t *live, size_t *reserved);
+int compare_pointers(const void *a, const void *b);
+int bench_memory(void);
+int bench_alloc(void);
+int compare_receipts_tolower(const void *a, const void *b);
+int bench_keys(void);
+int bench_rank(void);
+uint8_t store_matches_list(Receipt *head);
+int bench_store(void);
+int bench_handles(void);
+uint8_t lists_match(Receipt *a, Receipt *b);
+int bench_journal(void);
+int bench_compact(void);
+uint8_t write_receipts_stdio(Receipt *head, const char *path);
+int bench_rewrite(void);
+uint8_t save_receipt_stdio(Receipt *r);
+int bench_append(void);
+int bench_patch(void);
+void print_corpus_row(const CorpusSpec *spec, const char *operation, size_t ops, double ms);
+// Corpus generator
+uint32_t xorshift32(uint32_t *state);
+uint8_t parse_range(const char *text, uint32_t *min, uint32_t *max);
+int compare_names(const void *a, const void *b);
+CorpusSpec corpus_spec(size_t count, uint8_t shuffled_pct);
+uint8_t write_corpus(const char *path, const CorpusSpec *spec);
+int run_generate(int argc, char *argv[]);
+
+// Ordered stores: the B+tree (default), and the linked list with its sorted name table
+static const OrderedStore btree_store = {
+    "btree", btree_build, btree_insert, btree_remove, btree_find_name,
+    btree_rank, btree_seek, btree_next, btree_count, btree_clear,
+};
+static const OrderedStore list_store = {
+    "list", list_store_build, list_store_insert, list_store_remove, list_store_find_name,
+    list_store_rank, list_store_seek, list_store_next, list_store_count, name_table_clear,
+};
+static const OrderedStore *ordered_store = &btree_store;
 
 /**
  * @brief Main entry point of the Cookbook application
  *
- * Initializes the application by loading receipts from file, running the
- * interactive menu loop, and cleaning up resources before exit.
+ * Initializes the application by starting the background load of the
+ * receipts file, running the interactive menu loop, and cleaning up
+ * resources before exit.
  *
+ * Passing "bench" as the first argument runs the benchmarks instead and
+ * "verify-index" checks the sidecar index and "generate" writes a
+ * synthetic cookbook (see run_generate()); "--lazy" keeps only names in
+ * memory and reads bodies on demand, and "--store list" keeps the list in
+ * order with the sorted name table instead of the B+tree; "--durability"
+ * sets when new receipts reach the disk (see select_durability()), and
+ * "--no-patch" journals every update instead of patching bodies in place.
+ * While the menu
+ * runs, records other programs append to the receipts file are picked up
+ * automatically.
+ *
+ * @param argc Argument count (int)
+ * @param argv Argument vector (char*[])
  * @return int Exit status (0 for success)
  */
-int main(){
-    // Setup
-    Receipt *head = load_receipts();
+int main(int argc, char *argv[]){
+    select_newline_scanner(NULL);
+
+    // Benchmark mode: ./cookbook bench [suite]
+    if(argc > 1 && strcmp(argv[1], "bench") == 0){
+        return run_benchmarks(argc > 2 ? argv[2] : NULL);
+    }
+    // Index check: ./cookbook verify-index
+    if(argc > 1 && strcmp(argv[1], "verify-index") == 0){
+        return verify_index(receipts_path);
+    }
+    // Corpus generator: ./cookbook generate PATH [options]
+    if(argc > 1 && strcmp(argv[1], "generate") == 0){
+        return run_generate(argc - 1, argv + 1);
+    }
+
+    // Options
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--lazy") == 0) lazy_bodies = 1;
+        else if(strcmp(argv[i], "--no-patch") == 0) patch_in_place = 0;
+        else if(strcmp(argv[i], "--store") == 0 && i + 1 < argc && !select_ordered_store(argv[++i])){
+            fprintf(stderr, "Unknown store '%s' (expected \"btree\" or \"list\").\n", argv[i]);
+            return 1;
+        }
+        else if(strcmp(argv[i], "--durability") == 0 && i + 1 < argc && !select_durability(argv[++i])){
+            fprintf(stderr, "Unknown durability '%s' (expected \"always\", \"exit\" or milliseconds).\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Setup: load in the background so the menu draws immediately
+    start_file_watch(receipts_path);
+    start_background_load();
 
     // Worker
-    head = run_menu(head);
+    Receipt *head = run_menu(NULL);
 
-    // Cleanup
-    free_list(head);
+    // Cleanup (quitting mid-load still waits for the loader, new receipts for their commit, and a compaction for its swap)
+    head = wait_for_load(head);
+    append_close();
+    compaction_finish(head);
+    teardown_receipts();
+    stop_file_watch();
     return 0;
 }
 
@@ -159,19 +988,54 @@ void disable_raw_mode(struct termios *orig_termios){
  * Supports arrow key navigation (UP/DOWN) and Enter to select.
  * Press 'Q' or 'q' at any time to exit.
  *
- * @param head Pointer to the head of the receipt linked list
+ * While the background load runs, the menu shows a progress line and stays
+ * navigable; each operation waits for the load to complete before it
+ * touches the list (Add waits only after its input has been typed).
+ *
+ * The menu also waits on the file watch: when another program changes the
+ * receipts file, the list is synced with it (see sync_with_file()) and a
+ * notice is shown under the menu. Between operations it starts background
+ * compactions and swaps them in (see compaction_poll()), and it wakes up
+ * to end commit windows for new receipts (see append_commit_due()); a
+ * window still open when it blocks on a prompt is committed first (see
+ * append_commit_open()).
+ *
+ * @param head Pointer to the head of the receipt linked list (NULL while loading)
  * @return Receipt* Updated head pointer of the receipt list
  */
 Receipt *run_menu(Receipt *head){
     char input[LEN_INPUT_BUFFER];
     uint8_t choice = 0;
-    uint8_t selected_option = 0;  // 0-4 for menu items, 5 for exit
+    uint8_t selected_option = 0;  // 0-5 for menu items, 6 for exit
     struct termios orig_termios;
+    uint8_t check_file = 1;       // Sync with the file once the list is ours
+    long file_change = 0;         // Outcome of the last sync, shown until the next key
+
+    // Unbuffered, so poll() on the descriptor sees every pending key
+    setvbuf(stdin, NULL, _IONBF, 0);
 
     clear_terminal();
     enable_raw_mode(&orig_termios);
 
     while(1){
+        // Merge outside changes to the receipts file once loading is done
+        if(check_file && background_load_finished()){
+            head = wait_for_load(head);
+            long change = 0;
+            head = sync_with_file(head, &change);
+            if(change != 0) file_change = change;
+            check_file = 0;
+        }
+
+        // End an expired commit window for new receipts
+        append_commit_due();
+
+        // Swap in a finished compaction, or start one once enough of the files is dead
+        if(background_load_finished()){
+            head = wait_for_load(head);
+            compaction_poll(head);
+        }
+
         // Display menu with current selection highlighted
         clear_terminal();
         printf("\n===== Diego's Cookbook =====\n");
@@ -181,11 +1045,41 @@ Receipt *run_menu(Receipt *head){
         printf("%s3. View receipt\n", (selected_option == 2) ? "> " : "  ");
         printf("%s4. Update receipt\n", (selected_option == 3) ? "> " : "  ");
         printf("%s5. Delete receipt\n", (selected_option == 4) ? "> " : "  ");
-        printf("%sQ. Exit\n", (selected_option == 5) ? "> " : "  ");
+        printf("%s6. Browse pages\n", (selected_option == 5) ? "> " : "  ");
+        printf("%sQ. Exit\n", (selected_option == 6) ? "> " : "  ");
         printf("\nUse UP/DOWN arrows to navigate, ENTER to select, Q to quit\n");
 
+        // Progress indicator, redrawn until the load completes
+        uint8_t loading = !background_load_finished();
+        if(loading){
+            size_t total = atomic_load(&load_progress.total);
+            size_t done = atomic_load(&load_progress.done);
+            printf("\nLoading cookbook... %zu receipt(s) (%zu%%)\n",
+                   atomic_load(&load_progress.records), total ? done * 100 / total : 0);
+        }
+        else if(file_change > 0){
+            printf("\n%ld new receipt(s) added to the file by another program.\n", file_change);
+        }
+        else if(file_change < 0){
+            printf("\nThe receipts file was replaced and has been reloaded.\n");
+        }
+        fflush(stdout);
+
+        // Wait for a key, a change to the file or the next progress redraw
+        struct pollfd pfd[2] = {
+            {.fd = STDIN_FILENO, .events = POLLIN},
+            {.fd = file_watch.fd, .events = POLLIN},
+        };
+        int timeout = (loading || compaction_running()) ? PROGRESS_REDRAW_MS : -1;
+        int commit_in = append_due_ms();
+        if(commit_in >= 0 && (timeout < 0 || commit_in < timeout)) timeout = commit_in;
+        if(poll(pfd, (file_watch.fd >= 0) ? 2 : 1, timeout) <= 0) continue;
+        if(file_watch.fd >= 0 && (pfd[1].revents & POLLIN) && file_watch_drain()) check_file = 1;
+        if(!(pfd[0].revents & (POLLIN | POLLHUP))) continue;
+
         // Read key input
         char c = getchar();
+        file_change = 0;
 
         // Handle 'Q' or 'q' for quit
         if(c == 'q' || c == 'Q'){
@@ -205,7 +1099,7 @@ Receipt *run_menu(Receipt *head){
                     }
                 }
                 else if(seq[1] == KEY_DOWN){  // Down arrow
-                    if(selected_option < 5){
+                    if(selected_option < 6){
                         selected_option++;
                     }
                 }
@@ -216,7 +1110,7 @@ Receipt *run_menu(Receipt *head){
         // Handle Enter key
         if(c == KEY_ENTER || c == '\r'){
             // Exit if "Exit" is selected
-            if(selected_option == 5){
+            if(selected_option == 6){
                 break;
             }
 
@@ -224,32 +1118,42 @@ Receipt *run_menu(Receipt *head){
             disable_raw_mode(&orig_termios);
             clear_terminal();
 
+            // The prompts block: don't leave a commit window open across them
+            append_commit_open();
+
             choice = selected_option;
 
+            // Everything but Add needs the full list up front
+            if(choice != MENU_ADD){
+                if(!background_load_finished()) printf("Waiting for the cookbook to finish loading...\n");
+                head = wait_for_load(head);
+            }
+
             if(choice == MENU_DISPLAY_ALL){
                 custom_log(LOG_INFO, "Displaying all receipts...\n");
                 display_receipts(head);
             }
             else if(choice == MENU_ADD){
                 custom_log(LOG_INFO, "Adding a new receipt...\n\n");
-                char name[LEN_NAME], receipt[LEN_REC];
+                char name[LEN_NAME];
 
                 printf("Name: ");
                 fgets(name, sizeof(name), stdin);
                 trim_newline(name);
 
                 printf("Receipt: ");
-                fgets(receipt, sizeof(receipt), stdin);
-                trim_newline(receipt);
+                char *receipt = read_input_line();
 
                 if(name[0] != '\0'){
-                    head = create_receipt(head, name, receipt);
+                    head = wait_for_load(head);
+                    head = create_receipt(head, name, receipt != NULL ? receipt : "");
                     custom_log(LOG_INFO, "New receipt saved!\n");
                 }
+                free(receipt);
             }
             else if(choice == MENU_VIEW){
                 // View receipt
-                uint16_t receipt_id = 0;
+                uint32_t receipt_id = 0;
 
                 display_receipts(head);
 
@@ -271,8 +1175,8 @@ Receipt *run_menu(Receipt *head){
             }
             else if(choice == MENU_UPDATE){
                 custom_log(LOG_INFO, "Update receipt...\n");
-                char name[LEN_NAME], receipt[LEN_REC];
-                uint16_t receipt_id = 0;
+                char name[LEN_NAME];
+                uint32_t receipt_id = 0;
 
                 display_receipts(head);
 
@@ -295,17 +1199,17 @@ Receipt *run_menu(Receipt *head){
                 trim_newline(name);
 
                 printf("Receipt (Press 'Enter' to keep current): ");
-                fgets(receipt, sizeof(receipt), stdin);
-                trim_newline(receipt);
+                char *receipt = read_input_line();
 
                 head = update_receipt(head, receipt_id, name, receipt);
+                free(receipt);
                 char msg[LEN_LOG_MSG];
-                snprintf(msg, sizeof(msg), "Receipt '%d' is updated.\n", receipt_id);
+                snprintf(msg, sizeof(msg), "Receipt '%u' is updated.\n", receipt_id);
                 custom_log(LOG_INFO, msg);
             }
             else if(choice == MENU_DELETE){
                 custom_log(LOG_INFO, "Delete receipt...\n");
-                uint16_t receipt_id = 0;
+                uint32_t receipt_id = 0;
 
                 display_receipts(head);
 
@@ -325,10 +1229,56 @@ Receipt *run_menu(Receipt *head){
 
                 head = delete_receipt(head, receipt_id);
                 char msg[LEN_LOG_MSG];
-                snprintf(msg, sizeof(msg), "Receipt '%d' is deleted.\n", receipt_id);
+                snprintf(msg, sizeof(msg), "Receipt '%u' is deleted.\n", receipt_id);
                 custom_log(LOG_INFO, msg);
             }
+            else if(choice == MENU_BROWSE){
+                // Page number, or "#ID" for the page holding that receipt
+                size_t page = 0;
+
+                printf("Page number, or #ID to find a receipt's page: ");
+                if(fgets(input, sizeof(input), stdin) == NULL){
+                    printf("Press any key to continue...");
+                    getchar();
+                    enable_raw_mode(&orig_termios);
+                    continue;
+                }
+                if(input[0] == '#'){
+                    uint32_t receipt_id = 0;
+                    size_t rank = 0;
+                    if(!parse_receipt_id(input + 1, &receipt_id)){
+                        printf("Press any key to continue...");
+                        getchar();
+                        enable_raw_mode(&orig_termios);
+                        continue;
+                    }
+                    if(!receipt_rank(head, receipt_id, &rank)){
+                        char msg[LEN_LOG_MSG];
+                        snprintf(msg, sizeof(msg), "Receipt ID %u not found.\n", receipt_id);
+                        custom_log(LOG_ERROR, msg);
+                        printf("Press any key to continue...");
+                        getchar();
+                        enable_raw_mode(&orig_termios);
+                        continue;
+                    }
+                    printf("Receipt %u is number %zu in alphabetical order.\n", receipt_id, rank + 1);
+                    page = rank / PAGE_SIZE;
+                }
+                else if(sscanf(input, "%zu", &page) == 1 && page > 0){
+                    page--;
+                }
+                else{
+                    custom_log(LOG_WARN, "Invalid input.\n");
+                    printf("Press any key to continue...");
+                    getchar();
+                    enable_raw_mode(&orig_termios);
+                    continue;
+                }
+
+                display_page(head, page);
+            }
 
+            append_commit_open();
             printf("\nPress any key to continue...");
             getchar();
             enable_raw_mode(&orig_termios);
@@ -342,559 +1292,8258 @@ Receipt *run_menu(Receipt *head){
 }
 
 /**
- * @brief Converts a LogLevel enum value to its string representation
+ * @brief Starts loading the receipts file on a background thread
  *
- * @param level The log level to convert (LogLevel enum)
- * @return const char* String representation of the log level
+ * The menu can draw as soon as this returns. If the thread cannot be
+ * created, the file is loaded synchronously instead.
  */
-const char* log_level_to_string(LogLevel level){
-    switch(level){
-        case LOG_DEBUG: return "DEBUG";
-        case LOG_INFO:  return "INFO";
-        case LOG_WARN:  return "WARN";
-        case LOG_ERROR: return "ERROR";
-        default:        return "UNKNOWN";
+void start_background_load(){
+    reset_load_progress(0);
+    if(pthread_create(&background_load.thread, NULL, background_load_worker, NULL) == 0){
+        background_load.started = 1;
+        return;
     }
+
+    custom_log(LOG_WARN, "Could not start loader thread, loading in the foreground.\n");
+    background_load_worker(NULL);
 }
 
 /**
- * @brief Logs a message with timestamp and log level
+ * @brief Thread body of the background load
  *
- * Filters messages based on MIN_LOG_LEVEL. Formats output with current
- * timestamp in YYYY-MM-DD HH:MM:SS format followed by log level and message.
+ * Loads the receipts file and releases everyone waiting on the barrier.
  *
- * @param level The severity level of the log message (LogLevel enum)
- * @param message The message string to log (const char*)
+ * @param arg Unused (void*)
+ * @return void* Always NULL
  */
-void custom_log(LogLevel level, const char *message){
-    // Filter logs based on minimum log level
-    if(level < MIN_LOG_LEVEL){
-        return;
-    }
-
-    time_t raw_time;
-    struct tm *local_info;
-    char time_buffer[LEN_DATETIME_FORMAT];
-
-    time(&raw_time);
-    // Convert raw time to the local timezone
-    local_info = localtime(&raw_time);
-
-    if(local_info == NULL){
-        // Fallback if localtime fails
-        printf("[%s] %s", log_level_to_string(level), message);
-        return;
-    }
+void *background_load_worker(void *arg){
+    (void) arg;
+    Receipt *head = load_receipts();
+    body_arena_close();
+    node_cache_close();
 
-    // Format the time for YYYY-MM-DD HH:MM:SS
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", local_info);
+    // Build the lookup tables here too, so the first menu operation doesn't pay for them
+    store_sync(head);
+    id_index_sync(head);
 
-    // Print datetime + log message
-    printf("%s - [%s] %s", time_buffer, log_level_to_string(level), message);
+    pthread_mutex_lock(&background_load.lock);
+    background_load.head = head;
+    background_load.done = 1;
+    pthread_cond_broadcast(&background_load.finished);
+    pthread_mutex_unlock(&background_load.lock);
+    return NULL;
 }
 
 /**
- * @brief Removes trailing newline characters from a string
- *
- * Removes both '\r' and '\n' characters from the end of the string
- * by replacing the first occurrence with a null terminator.
+ * @brief Tells whether the background load has completed
  *
- * @param str The string to trim (char*)
+ * @return uint8_t 1 if the list is ready (or no load is pending), 0 while loading
  */
-void trim_newline(char *str){
-    str[strcspn(str, "\r\n")] = 0;
+uint8_t background_load_finished(){
+    pthread_mutex_lock(&background_load.lock);
+    uint8_t done = background_load.done || background_load.collected;
+    pthread_mutex_unlock(&background_load.lock);
+    return done;
 }
 
 /**
- * @brief Parses a string input to extract a receipt ID
+ * @brief Completion barrier for the background load
  *
- * Attempts to parse the input string as an unsigned 16-bit integer.
- * Logs a warning if parsing fails.
+ * Blocks until the loader has finished, then hands its list over once.
+ * After that it simply returns the caller's head.
  *
- * @param input The input string to parse (const char*)
- * @param receipt_id Pointer to store the parsed ID (uint16_t*)
- * @return uint8_t 1 on success, 0 on failure
+ * @param head Current head pointer held by the caller (Receipt*)
+ * @return Receipt* Head of the fully loaded list
  */
-uint8_t parse_receipt_id(const char *input, uint16_t *receipt_id){
-    uint16_t temp;
-    if(sscanf(input, "%hu", &temp) == 1){
-        *receipt_id = temp;
-        return 1;  // Success
+Receipt *wait_for_load(Receipt *head){
+    pthread_mutex_lock(&background_load.lock);
+    if(background_load.collected){
+        pthread_mutex_unlock(&background_load.lock);
+        return head;
     }
-    custom_log(LOG_WARN, "Invalid input.\n");
-    return 0;  // Failure
+    while(!background_load.done){
+        pthread_cond_wait(&background_load.finished, &background_load.lock);
+    }
+    head = background_load.head;
+    background_load.collected = 1;
+    pthread_mutex_unlock(&background_load.lock);
+
+    if(background_load.started){
+        pthread_join(background_load.thread, NULL);
+        background_load.started = 0;
+    }
+    return head;
 }
 
 /**
- * @brief Loads all receipts from the storage file into memory
+ * @brief Resets the published load progress
  *
- * Reads receipts from FILE_NAME, parses each name/receipt pair, and
- * builds a sorted doubly-linked list. Logs the number of receipts loaded.
- *
- * @return Receipt* Pointer to the head of the loaded receipt list, or NULL if file doesn't exist
+ * @param total Units in the upcoming load, or 0 if not yet known (size_t)
  */
-Receipt *load_receipts(){
-    // Open receipts file
-    FILE *fptr = fopen(FILE_NAME, "r");
-    uint16_t num_rec = 0;
+void reset_load_progress(size_t total){
+    atomic_store(&load_progress.records, 0);
+    atomic_store(&load_progress.done, 0);
+    atomic_store(&load_progress.total, total);
+}
 
-    // Check file existance
-    if(fptr == NULL){
-        custom_log(LOG_WARN, "File does not exist, or could not be opened.\n");
-        return NULL;
+/**
+ * @brief Starts watching the receipts file for changes made by other programs
+ *
+ * Watches the directory holding the file with inotify rather than the file
+ * itself, so a file replaced by rename() keeps being watched. Without
+ * inotify (or if it fails) the cookbook simply does not pick up outside
+ * changes.
+ *
+ * @param path Path of the receipts file (const char*)
+ */
+void start_file_watch(const char *path){
+    file_watch.fd = -1;
+#ifdef __linux__
+    char dir[LEN_PATH];
+    const char *slash = strrchr(path, '/');
+    if(slash == NULL){
+        snprintf(dir, sizeof(dir), ".");
+        snprintf(file_watch.name, sizeof(file_watch.name), "%s", path);
     }
-    
-    // Declare variables
-    Receipt *head = NULL;
-    Receipt *tmp_node = NULL;
-    char buff[LEN_REC];
-
-    // Read receipts and store into a pointer
-    while(fgets(buff, sizeof(buff), fptr)){
-        // Clean buffer
-        trim_newline(buff);
-
-        // Check if the line starts a new Receipt
-        if(strstr(buff, "Name:")){
-            tmp_node = malloc(sizeof(Receipt));
-            // Check if new_node is created properly
-            if(!tmp_node){
-                custom_log(LOG_ERROR, "Memory allocation failed during load.\n");
-                break;
-            }
-
-            memset(tmp_node, 0, sizeof(Receipt));
-
-            // Copy the name skipping "Name: " prefix
-            strncpy(tmp_node->name, buff+LEN_PREFIX_NAME, LEN_NAME-1);
-            tmp_node->name[LEN_NAME-1] = '\0';  // Ensure null-termination
-        }
-        // If currently filling a receipt
-        else if(tmp_node != NULL && strstr(buff, "Receipt:")){
-            // Copy the receipt skipping "Receipt: " prefix
-            strncpy(tmp_node->receipt, buff+LEN_PREFIX_RECEIPT, LEN_REC-1);
-            tmp_node->receipt[LEN_REC-1] = '\0';  // Ensure null-termination
-            tmp_node->id = num_rec;
-            head = insert_alphabetically(head, tmp_node);
-
-            tmp_node = NULL;
-            num_rec++;
-        }
+    else{
+        snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path), path);
+        if(dir[0] == '\0') snprintf(dir, sizeof(dir), "/");
+        snprintf(file_watch.name, sizeof(file_watch.name), "%s", slash + 1);
     }
 
-    // Cleanup: free any partially read receipt
-    if(tmp_node != NULL){
-        free(tmp_node);
-        custom_log(LOG_WARN, "Partial receipt data discarded.\n");
+    file_watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(file_watch.fd < 0) return;
+    if(inotify_add_watch(file_watch.fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE) < 0){
+        custom_log(LOG_DEBUG, "Could not watch the receipts directory.\n");
+        close(file_watch.fd);
+        file_watch.fd = -1;
     }
+#else
+    (void) path;
+#endif
+}
 
-    char log_msg[LEN_LOG_MSG];
-    snprintf(log_msg, sizeof(log_msg), "%d receipt(s) loaded successfully!\n\n", num_rec);
-    custom_log(LOG_INFO, log_msg);
-
-    fclose(fptr);
-    return head;
+/**
+ * @brief Closes the inotify watch
+ */
+void stop_file_watch(){
+    if(file_watch.fd >= 0) close(file_watch.fd);
+    file_watch.fd = -1;
 }
 
 /**
- * @brief Generates a unique ID for a new receipt
- *
- * Uses a static counter to track the next available ID. On first call with
- * a non-empty list, initializes from the highest existing ID in the list.
+ * @brief Reads all pending watch events
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @return uint16_t A unique ID for a new receipt
+ * @return uint8_t 1 if any event concerned the receipts file, 0 otherwise
  */
-uint16_t get_new_id(Receipt *head){
-    static uint16_t next_id = 0;
+uint8_t file_watch_drain(){
+    uint8_t changed = 0;
+#ifdef __linux__
+    char buf[sizeof(struct inotify_event) + LEN_PATH] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t got;
 
-    // If this is the first call and list is not empty, initialize from the list
-    if(next_id == 0 && head != NULL){
-        Receipt *current = head;
-        while(current != NULL){
-            if(current->id >= next_id) next_id = current->id + 1;
-            current = current->next;
+    while((got = read(file_watch.fd, buf, sizeof(buf))) > 0){
+        for(char *p = buf; p < buf + got; ){
+            const struct inotify_event *event = (const struct inotify_event *) p;
+            if(event->len > 0 && strcmp(event->name, file_watch.name) == 0) changed = 1;
+            p += sizeof(struct inotify_event) + event->len;
         }
     }
-
-    return next_id++;
+#endif
+    return changed;
 }
 
 /**
- * @brief Saves a single receipt to the file in append mode
+ * @brief Records how much of the receipts file the list now reflects
  *
- * Appends the receipt's name and content to FILE_NAME. Creates the file
- * if it doesn't exist. Logs an error if the operation fails.
+ * Remembers the file's identity (device and inode), the byte offset the
+ * list covers and a hash of the file's leading bytes; sync_with_file()
+ * compares against these to tell an append from a rewrite.
  *
- * @param r Pointer to the receipt to save (Receipt*)
- * @return uint8_t 1 on success, 0 on failure
+ * @param fd Open descriptor of the loaded file (int)
+ * @param loaded Bytes of the file held in the list (off_t)
  */
-uint8_t save_receipt_to_file(Receipt *r){
-    if(r == NULL){
-        custom_log(LOG_ERROR, "Receipt is corrupted.\n");
-        return 0; // Return 0: Fail
-    }
+void track_receipts_file(int fd, off_t loaded){
+    struct stat st;
+    file_watch.valid = 0;
+    if(fstat(fd, &st) != 0) return;
 
-    // 'a' to append. It creates the file if it doesn't exist
-    FILE *fptr = fopen(FILE_NAME, "a");
-
-    if(fptr == NULL){
-        custom_log(LOG_ERROR, "Could not open file for writing.\n");
-        return 0; // Return 0: Fail
-    }
+    file_watch.dev = st.st_dev;
+    file_watch.ino = st.st_ino;
+    file_watch.loaded_size = loaded;
+    file_watch.head_len = (loaded < WATCH_HEAD_BYTES) ? (size_t) loaded : WATCH_HEAD_BYTES;
+    file_watch.valid = hash_file_head(fd, file_watch.head_len, &file_watch.head_hash);
+}
 
-    fprintf(fptr, "Name: %s\n", r->name);
-    fprintf(fptr, "Receipt: %s\n", r->receipt);
+/**
+ * @brief Records a receipts file that was validated by size, by path
+ *
+ * Used by the snapshot and index loaders, which check the text file with
+ * stat() but never open it. If the file changed in between, tracking is
+ * left invalid and the next change triggers a full reload.
+ *
+ * @param path Path of the receipts file (const char*)
+ * @param expected Status the loader validated against, or NULL for any (const struct stat*)
+ */
+void track_receipts_path(const char *path, const struct stat *expected){
+    struct stat st;
+    file_watch.valid = 0;
 
-    fclose(fptr);
-    return 1;   // Return 1: Success
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        // No file yet: the list is empty and the first append creates it
+        file_watch.dev = 0;
+        file_watch.ino = 0;
+        file_watch.loaded_size = 0;
+        file_watch.head_len = 0;
+        file_watch.head_hash = FNV_OFFSET_BASIS;
+        file_watch.valid = 1;
+        return;
+    }
+    if(fstat(fd, &st) == 0 && (expected == NULL
+       || (st.st_ino == expected->st_ino && st.st_size == expected->st_size))){
+        track_receipts_file(fd, st.st_size);
+    }
+    close(fd);
 }
 
 /**
- * @brief Rewrites the entire receipt file with current list contents
+ * @brief Notes an append made by this program
  *
- * Opens FILE_NAME in write mode (truncating existing content) and writes
- * all receipts from the linked list. Used after delete or update operations.
+ * Moves the loaded offset past the record when the list was up to date
+ * with the file before the write. Otherwise someone else appended first;
+ * tracking is invalidated so the next sync reloads the whole file rather
+ * than parsing this record a second time.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @return uint8_t 1 on success, 0 on failure
+ * @param before Status of the file just before the append (const struct stat*)
+ * @param len Bytes appended (size_t)
  */
-uint8_t rewrite_receipts_to_file(Receipt *head){
-    FILE *fptr = fopen(FILE_NAME, "w");
+void track_own_append(const struct stat *before, size_t len){
+    if(!file_watch.valid) return;
 
-    if(!fptr){
-        custom_log(LOG_ERROR, "Could not rewrite file.\n");
-        return 0;
+    if(file_watch.ino == 0 && file_watch.loaded_size == 0 && before->st_size == 0){
+        // The append created the file
+        track_receipts_path(receipts_path, NULL);
+        return;
+    }
+    if(before->st_dev == file_watch.dev && before->st_ino == file_watch.ino
+       && before->st_size == file_watch.loaded_size){
+        file_watch.loaded_size += (off_t) len;
+        return;
     }
+    file_watch.valid = 0;
+}
 
-    Receipt *current = head;
-    while(current != NULL){
-        fprintf(fptr, "Name: %s\n", current->name);
-        fprintf(fptr, "Receipt: %s\n", current->receipt);
-        current = current->next;
+/**
+ * @brief Hashes the first bytes of a file
+ *
+ * @param fd Open file descriptor (int)
+ * @param len Bytes to hash, at most WATCH_HEAD_BYTES (size_t)
+ * @param hash Receives the FNV-1a 64 hash (uint64_t*)
+ * @return uint8_t 1 on success, 0 if the bytes could not be read
+ */
+uint8_t hash_file_head(int fd, size_t len, uint64_t *hash){
+    char buf[WATCH_HEAD_BYTES];
+    size_t done = 0;
+
+    if(len > sizeof(buf)) len = sizeof(buf);
+    while(done < len){
+        ssize_t got = pread(fd, buf + done, len - done, (off_t) done);
+        if(got <= 0) return 0;
+        done += (size_t) got;
     }
-    fclose(fptr);
-    custom_log(LOG_INFO, "File updated.\n");
+    *hash = fnv1a64(FNV_OFFSET_BASIS, buf, len);
     return 1;
 }
 
 /**
- * @brief Creates a new receipt and adds it to the list
+ * @brief Finds the end of the last complete record in a byte range
  *
- * Allocates memory for a new receipt, initializes it with the provided
- * name and content, assigns a unique ID, inserts it alphabetically into
- * the list, and saves it to file.
+ * A record is complete once its "Receipt: " line ends with a newline.
+ * Anything after it (a record another program is still writing) is left
+ * for the next sync.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @param name The name of the recipe (const char*)
- * @param receipt The recipe content/instructions (const char*)
+ * @param data Start of the file (const char*)
+ * @param start Offset the range starts at (size_t)
+ * @param len Length of the file in bytes (size_t)
+ * @return size_t Offset just past the last complete record, or start if there is none
+ */
+size_t complete_records_end(const char *data, size_t start, size_t len){
+    size_t eol = len;
+
+    // Walk whole lines backwards, starting from the last newline
+    while(eol > start && data[eol-1] != '\n') eol--;
+    while(eol > start){
+        size_t line = eol - 1;
+        while(line > start && data[line-1] != '\n') line--;
+        if(eol - line > LEN_PREFIX_RECEIPT && memcmp(data + line, "Receipt: ", LEN_PREFIX_RECEIPT) == 0){
+            return eol;
+        }
+        eol = line;
+    }
+    return start;
+}
+
+/**
+ * @brief Merges two sorted receipt lists into one
+ *
+ * Relinks the nodes in a single pass (O(n + m)) using compare_receipts().
+ * On equal keys the node from a comes first.
+ *
+ * @param a Head of the first sorted list (Receipt*)
+ * @param b Head of the second sorted list (Receipt*)
+ * @return Receipt* Head of the merged list
+ */
+Receipt *merge_lists(Receipt *a, Receipt *b){
+    Receipt *head = NULL;
+    Receipt *tail = NULL;
+
+    store_invalidate();
+    id_index_invalidate();
+
+    while(a != NULL || b != NULL){
+        Receipt *node;
+        if(b == NULL || (a != NULL && compare_receipts(&a, &b) <= 0)){
+            node = a;
+            a = a->next;
+        }
+        else{
+            node = b;
+            b = b->next;
+        }
+        node->prev = tail;
+        node->next = NULL;
+        if(tail != NULL) tail->next = node;
+        else head = node;
+        tail = node;
+    }
+    return head;
+}
+
+/**
+ * @brief Brings the list up to date with changes other programs made to the file
+ *
+ * If the file is the one that was loaded (same inode, not shorter, same
+ * leading bytes) and has grown, only the appended tail is parsed: the new
+ * records keep the IDs they were written with, unless the list already
+ * uses them or they have none, in which case they get fresh ones past
+ * every kept ID, and are merged into the sorted list; an ID repeated
+ * within the tail is renumbered by id_index_sync(). A file that
+ * was replaced, truncated or rewritten in place is reloaded from scratch.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param change Receives the number of records added, -1 after a full reload, 0 if nothing changed (long*)
  * @return Receipt* Updated head pointer of the receipt list
  */
-Receipt *create_receipt(Receipt *head, const char *name, const char *receipt){
-    // Allocate memory
-    Receipt *new_receipt = malloc(sizeof(Receipt));
-    
-    // Check malloc
-    if(new_receipt == NULL){
-        char error_msg[LEN_LOG_MSG];
-        snprintf(error_msg, sizeof(error_msg), "Failed create new receipt %s.", name);
-        custom_log(LOG_ERROR, error_msg);
+Receipt *sync_with_file(Receipt *head, long *change){
+    struct stat st;
+    *change = 0;
+
+    // Our own new receipts go first; a reload must not lose them
+    if(!append_flush()) return head;
+
+    int fd = open(receipts_path, O_RDONLY);
+    if(fd < 0){
+        // Missing (or between unlink and rename): keep what we have
+        return head;
+    }
+    if(fstat(fd, &st) != 0){
+        close(fd);
         return head;
     }
 
-    // Initialize memory
-    memset(new_receipt, 0, sizeof(Receipt));
-    strncpy(new_receipt->name, name, LEN_NAME-1);
-    new_receipt->name[LEN_NAME-1] = '\0';  // Ensure null-termination
-    strncpy(new_receipt->receipt, receipt, LEN_REC-1);
-    new_receipt->receipt[LEN_REC-1] = '\0';  // Ensure null-termination
-    new_receipt->id = get_new_id(head);
+    uint64_t hash = 0;
+    uint8_t same_file = file_watch.valid
+        && st.st_dev == file_watch.dev && st.st_ino == file_watch.ino
+        && st.st_size >= file_watch.loaded_size
+        && hash_file_head(fd, file_watch.head_len, &hash) && hash == file_watch.head_hash;
 
-    // Insert into the list
-    head = insert_alphabetically(head, new_receipt);
+    if(!same_file){
+        close(fd);
+        custom_log(LOG_INFO, "Receipts file was rewritten, reloading.\n");
+        free_list(head);
+        next_receipt_id = 0;
+        *change = -1;
+        return load_receipts_from(receipts_path);
+    }
+    if(st.st_size == file_watch.loaded_size){
+        close(fd);
+        return head;
+    }
 
-    // File operation
-    if(!save_receipt_to_file(new_receipt)){
-        char error_msg[LEN_LOG_MSG];
-        snprintf(error_msg, sizeof(error_msg), "Failed to save receipt %s to the file.", new_receipt->name);
-        custom_log(LOG_ERROR, error_msg);
+    // Appended: parse only the complete records after the loaded offset
+    size_t len = (size_t) st.st_size;
+    char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        custom_log(LOG_ERROR, "Could not map receipts file.\n");
+        return head;
+    }
+
+    size_t start = (size_t) file_watch.loaded_size;
+    size_t end = complete_records_end(data, start, len);
+    ReceiptBatch batch = {0};
+    if(end > start && !parse_receipt_range(data + start, end - start, (off_t) start, &batch)){
+        custom_log(LOG_ERROR, "Memory allocation failed during load.\n");
+    }
+    munmap(data, len);
+    file_watch.loaded_size = (off_t) end;
+
+    // Only an unfinished record (or one without a trailing newline) arrived
+    if(batch.count == 0){
+        free(batch.items);
+        return head;
+    }
+
+    // Start the ID counter from the list before the tail's IDs move it on
+    if(next_receipt_id == 0 && head != NULL) next_receipt_id = get_new_id(head);
+
+    // Keep persisted IDs the list doesn't use, moving the counter past all of them first
+    for(size_t i = 0; i < batch.count; i++){
+        Receipt *r = batch.items[i];
+        if(!r->id_positional && r->id >= next_receipt_id && find_receipt(head, r->id) == NULL){
+            next_receipt_id = r->id + 1;
+        }
+    }
+    // Then fresh IDs in file order for the rest, so none of them meets a kept one
+    for(size_t i = 0; i < batch.count; i++){
+        Receipt *r = batch.items[i];
+        if(r->id_positional || find_receipt(head, r->id) != NULL){
+            r->id = get_new_id(head);
+        }
+    }
+    *change = (long) batch.count;
+    head = merge_lists(head, link_batch(&batch));
+
+    // Kept IDs may still repeat within the tail: the index rebuild renumbers those
+    id_index_sync(head);
+
+    char log_msg[LEN_LOG_MSG];
+    snprintf(log_msg, sizeof(log_msg), "%ld receipt(s) picked up from file.\n", *change);
+    custom_log(LOG_INFO, log_msg);
+    return head;
+}
+
+/**
+ * @brief Converts a LogLevel enum value to its string representation
+ *
+ * @param level The log level to convert (LogLevel enum)
+ * @return const char* String representation of the log level
+ */
+const char* log_level_to_string(LogLevel level){
+    switch(level){
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO:  return "INFO";
+        case LOG_WARN:  return "WARN";
+        case LOG_ERROR: return "ERROR";
+        default:        return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief Logs a message with timestamp and log level
+ *
+ * Filters messages based on min_log_level (initialized from MIN_LOG_LEVEL).
+ * Formats output with current timestamp in YYYY-MM-DD HH:MM:SS format followed by log level and message.
+ *
+ * @param level The severity level of the log message (LogLevel enum)
+ * @param message The message string to log (const char*)
+ */
+void custom_log(LogLevel level, const char *message){
+    // Filter logs based on minimum log level
+    if(level < min_log_level){
+        return;
+    }
+
+    time_t raw_time;
+    struct tm local_tm;
+    struct tm *local_info;
+    char time_buffer[LEN_DATETIME_FORMAT];
+
+    time(&raw_time);
+    // Convert raw time to the local timezone (reentrant: the loader thread logs too)
+    local_info = localtime_r(&raw_time, &local_tm);
+
+    if(local_info == NULL){
+        // Fallback if localtime fails
+        printf("[%s] %s", log_level_to_string(level), message);
+        return;
+    }
+
+    // Format the time for YYYY-MM-DD HH:MM:SS
+    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", local_info);
+
+    // Print datetime + log message
+    printf("%s - [%s] %s", time_buffer, log_level_to_string(level), message);
+}
+
+/**
+ * @brief Removes trailing newline characters from a string
+ *
+ * Removes both '\r' and '\n' characters from the end of the string
+ * by replacing the first occurrence with a null terminator.
+ *
+ * @param str The string to trim (char*)
+ */
+void trim_newline(char *str){
+    str[strcspn(str, "\r\n")] = 0;
+}
+
+/**
+ * @brief Reads one line of any length from stdin
+ *
+ * @return char* The line without its newline, to be freed by the caller, or NULL on end of input
+ */
+char *read_input_line(){
+    char *line = NULL;
+    size_t capacity = 0;
+    if(getline(&line, &capacity, stdin) < 0){
+        free(line);
+        return NULL;
+    }
+    trim_newline(line);
+    return line;
+}
+
+/**
+ * @brief Parses a string input to extract a receipt ID
+ *
+ * Accepts the same IDs as an "Id: " line (see parse_id_field()): decimal
+ * digits only, at most UINT32_MAX, so "-1" is refused rather than wrapped.
+ * Surrounding whitespace, such as the newline left by fgets(), is ignored.
+ * Logs a warning if parsing fails.
+ *
+ * @param input The input string to parse (const char*)
+ * @param receipt_id Pointer to store the parsed ID (uint32_t*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t parse_receipt_id(const char *input, uint32_t *receipt_id){
+    size_t len = strlen(input);
+    while(len > 0 && isspace((unsigned char) input[len-1])) len--;
+    while(len > 0 && isspace((unsigned char) *input)){
+        input++;
+        len--;
+    }
+    if(parse_id_field(input, len, receipt_id)){
+        return 1;  // Success
+    }
+    custom_log(LOG_WARN, "Invalid input.\n");
+    return 0;  // Failure
+}
+
+/**
+ * @brief Loads all receipts from the storage file into memory
+ *
+ * Convenience wrapper around load_receipts_from() for the configured
+ * receipts file.
+ *
+ * @return Receipt* Pointer to the head of the loaded receipt list, or NULL if file doesn't exist
+ */
+Receipt *load_receipts(){
+    return load_receipts_from(receipts_path);
+}
+
+/**
+ * @brief Loads all receipts from the given file into memory
+ *
+ * Uses the binary snapshot next to path when it matches the text file,
+ * then the sidecar index. Otherwise parses the text, using the parallel
+ * loader for files of at least PARALLEL_MIN_BYTES when more than one CPU
+ * is online, rebuilds the index and refreshes a stale snapshot so the next
+ * start can skip parsing. The snapshot and index mirror the text file
+ * alone; updates and deletes made since the last rewrite are then
+ * replayed from the journal (see journal_replay()).
+ *
+ * @param path Path of the receipts file (const char*)
+ * @return Receipt* Pointer to the head of the loaded receipt list, or NULL if file doesn't exist
+ */
+Receipt *load_receipts_from(const char *path){
+    Receipt *head = NULL;
+    reset_load_progress(0);
+    if(load_snapshot(path, &head) || load_index(path, &head)){
+        return journal_replay(head, path);
+    }
+
+    head = load_receipts_threads(path, 0);
+    if(access(path, F_OK) == 0 && !write_index(head, path)){
+        custom_log(LOG_WARN, "Could not write index.\n");
+    }
+
+    // Replace a stale snapshot, but don't create one nobody asked for
+    char snap[LEN_PATH];
+    sidecar_path(snap, sizeof(snap), path, SNAPSHOT_EXT);
+    if(access(snap, F_OK) == 0){
+        write_snapshot(head, path);
+    }
+    return journal_replay(head, path);
+}
+
+/**
+ * @brief Loads all receipts from the given file using a number of threads
+ *
+ * Maps path into memory, parses each name/receipt pair into a batch in a
+ * single scan, and links the batch into a sorted doubly-linked list in a single pass. Files
+ * written by rewrite_receipts_to_file() are already sorted and link in O(n);
+ * anything else is sorted once in O(n log n). Logs the number of receipts loaded.
+ *
+ * With more than one thread the scan is split into byte ranges parsed
+ * on a worker pool (see parse_receipts_parallel()); the resulting list is
+ * identical to the single-threaded one.
+ *
+ * @param path Path of the receipts file (const char*)
+ * @param threads Worker threads to use, or 0 to pick automatically (unsigned)
+ * @return Receipt* Pointer to the head of the loaded receipt list, or NULL if file doesn't exist
+ */
+Receipt *load_receipts_threads(const char *path, unsigned threads){
+    // Open receipts file
+    int fd = open(path, O_RDONLY);
+
+    // Check file existance
+    if(fd < 0){
+        custom_log(LOG_WARN, "File does not exist, or could not be opened.\n");
+        track_receipts_path(path, NULL);
+        return NULL;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        custom_log(LOG_ERROR, "Could not stat receipts file.\n");
+        close(fd);
+        return NULL;
+    }
+
+    // Map the whole file once; the mapping outlives the descriptor
+    ReceiptBatch batch = {0};
+    size_t len = (size_t) st.st_size;
+    size_t loaded = 0;
+    if(len > 0){
+        char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            custom_log(LOG_ERROR, "Could not map receipts file.\n");
+            close(fd);
+            return NULL;
+        }
+        madvise(data, len, MADV_SEQUENTIAL);
+        atomic_store(&load_progress.total, len);
+
+        if(threads == 0) threads = default_load_threads(len);
+        uint8_t ok = (threads > 1) ? parse_receipts_parallel(data, len, threads, &batch)
+                                   : parse_receipt_range(data, len, 0, &batch);
+        if(!ok){
+            custom_log(LOG_ERROR, "Memory allocation failed during load.\n");
+        }
+        // A trailing record still being written is parsed by a later sync,
+        // but a last "Receipt: " line without a newline was parsed already
+        loaded = complete_records_end(data, 0, len);
+        size_t last_line = len;
+        while(last_line > loaded && data[last_line-1] != '\n') last_line--;
+        if(len - last_line >= LEN_PREFIX_RECEIPT
+           && memcmp(data + last_line, "Receipt: ", LEN_PREFIX_RECEIPT) == 0){
+            loaded = len;
+        }
+        munmap(data, len);
     }
+    track_receipts_file(fd, (off_t) loaded);
+    close(fd);
+
+    // Lazy bodies are read back from this file
+    if(lazy_bodies) open_body_source(path);
+
+    size_t num_rec = batch.count;
+    Receipt *head = link_batch(&batch);
+
+    char log_msg[LEN_LOG_MSG];
+    snprintf(log_msg, sizeof(log_msg), "%zu receipt(s) loaded successfully!\n\n", num_rec);
+    custom_log(LOG_INFO, log_msg);
+
     return head;
 }
 
 /**
- * @brief Performs case-insensitive string comparison
+ * @brief Parses a byte range of the receipts file into a batch
+ *
+ * Walks the range once, finding line ends with the line scanner (see
+ * line_scanner_next()), or memchr() where there is no block classifier,
+ * and matching the "Name: " and "Receipt: " prefixes
+ * only at the start of a line. Each field
+ * is copied exactly once from the source bytes into its node; in lazy mode
+ * only the body's file offset and length are kept. A record keeps the ID
+ * of its "Id: " line; records written without one (older files) are
+ * numbered in the order they are parsed, counting from the batch's current
+ * size, and flagged id_positional. Filler lines following a record are
+ * counted as its slack (see patch_receipt()). Progress is published to
+ * load_progress as records are parsed.
+ *
+ * @param data Start of the range (const char*)
+ * @param len Length of the range in bytes (size_t)
+ * @param base File offset of data, used for lazy body offsets (off_t)
+ * @param batch Batch receiving the parsed nodes (ReceiptBatch*)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t parse_receipt_range(const char *data, size_t len, off_t base, ReceiptBatch *batch){
+    const char *p = data;
+    const char *end = data + len;
+    const char *reported = data;
+    size_t pending = 0;
+    Receipt *tmp_node = NULL;
+    Receipt *last = NULL;       // Last complete record, while filler lines may follow it
+    uint8_t has_id = 0;
+    LineScanner scanner;
+
+    line_scanner_init(&scanner, data, len);
+    while(p < end){
+        const char *eol;
+        if(newline_mask != NULL) eol = data + line_scanner_next(&scanner);
+        else if((eol = memchr(p, '\n', (size_t) (end - p))) == NULL) eol = end;
+        size_t line_len = (size_t) (eol - p);
+        if(line_len > 0 && p[line_len-1] == '\r') line_len--;
+
+        // Check if the line starts a new Receipt
+        if(line_len >= LEN_PREFIX_NAME && memcmp(p, "Name: ", LEN_PREFIX_NAME) == 0){
+            // A second "Name: " before "Receipt: " reuses the incomplete node
+            if(tmp_node == NULL){
+                tmp_node = node_alloc();
+                if(tmp_node == NULL) return 0;
+            }
+
+            set_receipt_name(tmp_node, p + LEN_PREFIX_NAME, line_len - LEN_PREFIX_NAME);
+            has_id = 0;
+            last = NULL;
+        }
+        // Stable ID of the record being filled
+        else if(tmp_node != NULL && line_len > LEN_PREFIX_ID && memcmp(p, "Id: ", LEN_PREFIX_ID) == 0){
+            has_id = parse_id_field(p + LEN_PREFIX_ID, line_len - LEN_PREFIX_ID, &tmp_node->id);
+        }
+        // If currently filling a receipt
+        else if(tmp_node != NULL && line_len >= LEN_PREFIX_RECEIPT
+                && memcmp(p, "Receipt: ", LEN_PREFIX_RECEIPT) == 0){
+            size_t n = line_len - LEN_PREFIX_RECEIPT;
+            if(n > UINT32_MAX) n = UINT32_MAX;
+            tmp_node->body_len = (uint32_t) n;
+            tmp_node->body_off = base + (p + LEN_PREFIX_RECEIPT - data);
+            tmp_node->receipt = NULL;
+            if(!lazy_bodies){
+                tmp_node->receipt = body_alloc(p + LEN_PREFIX_RECEIPT, n);
+                if(tmp_node->receipt == NULL){
+                    node_free(tmp_node);
+                    return 0;
+                }
+            }
+            if(!has_id) tmp_node->id = (uint32_t) batch->count;
+            tmp_node->id_positional = !has_id;
+            tmp_node->next = NULL;
+            tmp_node->prev = NULL;
+            if(!batch_push(batch, tmp_node)){
+                body_release(tmp_node->receipt);
+                node_free(tmp_node);
+                return 0;
+            }
+            last = tmp_node;
+            tmp_node = NULL;
+
+            // Publish progress every PROGRESS_STRIDE records
+            if(++pending == PROGRESS_STRIDE){
+                atomic_fetch_add(&load_progress.records, pending);
+                atomic_fetch_add(&load_progress.done, (size_t) (eol - reported));
+                reported = eol;
+                pending = 0;
+            }
+        }
+        // Lines of spaces right after a record are filler from in-place patches: its slack
+        else if(last != NULL && eol < end && is_filler_line(p, (size_t) (eol - p))){
+            last->body_slack += (uint32_t) (eol - p) + 1;
+        }
+        else{
+            last = NULL;
+        }
+
+        p = eol + 1;
+    }
+    atomic_fetch_add(&load_progress.records, pending);
+    atomic_fetch_add(&load_progress.done, (size_t) (end - reported));
+
+    // Cleanup: free any partially read receipt
+    if(tmp_node != NULL){
+        node_free(tmp_node);
+        custom_log(LOG_WARN, "Partial receipt data discarded.\n");
+    }
+    return 1;
+}
+
+/**
+ * @brief Tells whether a line is filler written by patch_receipt()
+ *
+ * @param line Start of the line, not null-terminated (const char*)
+ * @param len Length of the line without its newline (size_t)
+ * @return uint8_t 1 if the line is empty or only spaces, 0 otherwise
+ */
+uint8_t is_filler_line(const char *line, size_t len){
+    for(size_t i = 0; i < len; i++){
+        if(line[i] != ' ') return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Parses the value of an "Id: " line
+ *
+ * Accepts only decimal digits that fit in 32 bits, so a damaged line falls
+ * back to a positional ID instead of a wrong one.
+ *
+ * @param text Digits after the prefix, not null-terminated (const char*)
+ * @param len Number of bytes in text (size_t)
+ * @param id Receives the ID on success (uint32_t*)
+ * @return uint8_t 1 on success, 0 if the value is not a valid ID
+ */
+uint8_t parse_id_field(const char *text, size_t len, uint32_t *id){
+    uint64_t value = 0;
+    if(len == 0 || len > 10) return 0;
+    for(size_t i = 0; i < len; i++){
+        if(text[i] < '0' || text[i] > '9') return 0;
+        value = value * 10 + (uint64_t) (text[i] - '0');
+    }
+    if(value > UINT32_MAX) return 0;
+    *id = (uint32_t) value;
+    return 1;
+}
+
+/**
+ * @brief Picks the number of loader threads for a file of the given size
+ *
+ * @param len File size in bytes (size_t)
+ * @return unsigned 1 for small files, otherwise the online CPU count (capped at MAX_LOAD_THREADS)
+ */
+unsigned default_load_threads(size_t len){
+    if(len < PARALLEL_MIN_BYTES) return 1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus < 1) return 1;
+    if(cpus > MAX_LOAD_THREADS) return MAX_LOAD_THREADS;
+    return (unsigned) cpus;
+}
+
+/**
+ * @brief Finds the first record start at or after a byte offset
+ *
+ * A record starts at a line beginning with "Name: ". Offset 0 is always a
+ * valid start; any other offset is moved forward past the next newline
+ * until such a line is found.
+ *
+ * @param data Start of the file (const char*)
+ * @param len Length of the file in bytes (size_t)
+ * @param pos Offset to resync from (size_t)
+ * @return size_t Offset of the next record start, or len if there is none
+ */
+size_t resync_to_record(const char *data, size_t len, size_t pos){
+    if(pos == 0) return 0;
+
+    // Step back one byte so a line starting exactly at pos is found
+    pos--;
+    while(pos < len){
+        const char *nl = memchr(data + pos, '\n', len - pos);
+        if(nl == NULL) return len;
+        pos = (size_t) (nl - data) + 1;
+        if(len - pos >= LEN_PREFIX_NAME && memcmp(data + pos, "Name: ", LEN_PREFIX_NAME) == 0){
+            return pos;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Worker thread body for parse_receipts_parallel()
+ *
+ * Claims byte ranges until none are left, parsing each one into its own
+ * batch and sorting it. IDs are local to the range at this point.
+ *
+ * @param arg Shared load state (ParallelLoad*)
+ * @return void* Always NULL
+ */
+void *parallel_load_worker(void *arg){
+    ParallelLoad *load = arg;
+
+    while(1){
+        size_t r = atomic_fetch_add(&load->next_range, 1);
+        if(r >= load->ranges) break;
+
+        size_t start = load->range_starts[r];
+        size_t end = load->range_starts[r+1];
+        ReceiptBatch *batch = &load->batches[r];
+        if(!parse_receipt_range(load->data + start, end - start, (off_t) start, batch)){
+            atomic_store(&load->failed, 1);
+        }
+        qsort(batch->items, batch->count, sizeof(Receipt*), compare_receipts);
+    }
+    body_arena_close();
+    node_cache_close();
+    return NULL;
+}
+
+/**
+ * @brief Parses a mapped receipts file on a pool of worker threads
+ *
+ * Splits the file into RANGES_PER_THREAD ranges per thread, each resynced
+ * to the next record start, and lets the workers parse and sort them.
+ * IDs are then rebased to global file order and the sorted runs are merged
+ * into batch, which ends up exactly as a single-threaded parse followed by
+ * a stable sort would leave it.
+ *
+ * @param data Start of the mapped file (const char*)
+ * @param len Length of the file in bytes (size_t)
+ * @param threads Number of worker threads (unsigned)
+ * @param batch Batch receiving the merged nodes (ReceiptBatch*)
+ * @return uint8_t 1 on success, 0 on allocation or thread failure
+ */
+uint8_t parse_receipts_parallel(const char *data, size_t len, unsigned threads, ReceiptBatch *batch){
+    if(threads > MAX_LOAD_THREADS) threads = MAX_LOAD_THREADS;
+
+    size_t ranges = (size_t) threads * RANGES_PER_THREAD;
+    ParallelLoad load = {0};
+    pthread_t workers[MAX_LOAD_THREADS];
+    size_t bounds_len = ranges + 1;
+    uint8_t ok = 1;
+    size_t r;
+
+    load.data = data;
+    load.ranges = ranges;
+    load.range_starts = malloc(bounds_len * sizeof(size_t));
+    load.batches = calloc(ranges, sizeof(ReceiptBatch));
+    size_t *bounds = malloc(bounds_len * sizeof(size_t));
+    if(load.range_starts == NULL || load.batches == NULL || bounds == NULL){
+        free(load.range_starts);
+        free(load.batches);
+        free(bounds);
+        return 0;
+    }
+    atomic_init(&load.next_range, 0);
+    atomic_init(&load.failed, 0);
+
+    // Split into byte ranges aligned to record starts
+    load.range_starts[0] = 0;
+    for(r = 1; r < ranges; r++){
+        size_t start = resync_to_record(data, len, len / ranges * r);
+        if(start < load.range_starts[r-1]) start = load.range_starts[r-1];
+        load.range_starts[r] = start;
+    }
+    load.range_starts[ranges] = len;
+
+    // Parse on the worker pool
+    unsigned started = 0;
+    for(unsigned t = 0; t < threads; t++){
+        if(pthread_create(&workers[t], NULL, parallel_load_worker, &load) != 0) break;
+        started++;
+    }
+    if(started == 0){
+        // No threads available: drain the ranges on this thread
+        parallel_load_worker(&load);
+    }
+    for(unsigned t = 0; t < started; t++){
+        pthread_join(workers[t], NULL);
+    }
+    if(atomic_load(&load.failed)) ok = 0;
+
+    // Rebase positional IDs to file order and concatenate the sorted runs
+    size_t base = 0;
+    size_t runs = 0;
+    for(r = 0; r < ranges; r++){
+        ReceiptBatch *part = &load.batches[r];
+        for(size_t i = 0; i < part->count; i++){
+            if(part->items[i]->id_positional) part->items[i]->id = (uint32_t) (part->items[i]->id + base);
+            if(!batch_push(batch, part->items[i])){
+                body_release(part->items[i]->receipt);
+                node_free(part->items[i]);
+                ok = 0;
+            }
+        }
+        if(part->count > 0){
+            bounds[runs++] = base;
+        }
+        base += part->count;
+        free(part->items);
+    }
+    bounds[runs] = batch->count;
+
+    if(!merge_sorted_runs(batch, bounds, runs)) ok = 0;
+
+    free(load.range_starts);
+    free(load.batches);
+    free(bounds);
+    return ok;
+}
+
+/**
+ * @brief Merges consecutive sorted runs of a batch into one sorted run
+ *
+ * Performs bottom-up pairwise merges using compare_receipts(), halving the
+ * number of runs per pass (O(n log runs)). On equal keys the element from
+ * the earlier run wins, so the merge is stable.
+ *
+ * @param batch Batch whose items hold the runs back to back (ReceiptBatch*)
+ * @param bounds Start offset of each run, followed by batch->count (size_t*)
+ * @param runs Number of runs (size_t)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t merge_sorted_runs(ReceiptBatch *batch, size_t *bounds, size_t runs){
+    if(runs <= 1) return 1;
+
+    Receipt **src = batch->items;
+    Receipt **dst = malloc(batch->count * sizeof(Receipt*));
+    if(dst == NULL) return 0;
+    Receipt **scratch = dst;
+
+    while(runs > 1){
+        size_t out_runs = 0;
+        for(size_t r = 0; r < runs; r += 2){
+            size_t lo = bounds[r];
+            size_t mid = bounds[r+1];
+            size_t hi = (r + 2 <= runs) ? bounds[r+2] : mid;
+            size_t i = lo, j = mid, k = lo;
+
+            // An odd run out has no partner (hi == mid) and is copied through
+            while(i < mid && j < hi){
+                dst[k++] = (compare_receipts(&src[j], &src[i]) < 0) ? src[j++] : src[i++];
+            }
+            while(i < mid) dst[k++] = src[i++];
+            while(j < hi) dst[k++] = src[j++];
+            bounds[out_runs++] = lo;
+        }
+        bounds[out_runs] = batch->count;
+        runs = out_runs;
+
+        Receipt **tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    // Keep whichever buffer holds the result
+    if(src != batch->items){
+        free(batch->items);
+        batch->items = src;
+        batch->capacity = batch->count;
+    }
+    else{
+        free(scratch);
+    }
+    return 1;
+}
+
+/**
+ * @brief Appends a node to a bulk-load batch
+ *
+ * Grows the batch geometrically so that appending is amortized O(1).
+ *
+ * @param batch Batch to append to (ReceiptBatch*)
+ * @param node Node to append (Receipt*)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t batch_push(ReceiptBatch *batch, Receipt *node){
+    if(batch->count == batch->capacity){
+        size_t new_capacity = batch->capacity ? batch->capacity * 2 : LOAD_BATCH_INITIAL;
+        Receipt **items = realloc(batch->items, new_capacity * sizeof(Receipt*));
+        if(items == NULL) return 0;
+        batch->items = items;
+        batch->capacity = new_capacity;
+    }
+    batch->items[batch->count++] = node;
+    return 1;
+}
+
+/**
+ * @brief qsort() comparator ordering receipts by name, then by ID
+ *
+ * Uses the same case-insensitive ordering as insert_alphabetically(). Equal
+ * names fall back to the ID, which on load is the file position, so the
+ * sort is stable with respect to the file.
+ *
+ * @param a Pointer to the first element (const Receipt**)
+ * @param b Pointer to the second element (const Receipt**)
+ * @return int Negative, zero or positive like strcmp()
+ */
+int compare_receipts(const void *a, const void *b){
+    const Receipt *ra = *(const Receipt * const *) a;
+    const Receipt *rb = *(const Receipt * const *) b;
+    int cmp = compare_name_keys(ra->name_key, ra->folded, rb->name_key, rb->folded);
+    if(cmp != 0) return cmp;
+    return (ra->id > rb->id) - (ra->id < rb->id);
+}
+
+/**
+ * @brief Links a batch of parsed nodes into a sorted doubly-linked list
+ *
+ * Checks in one pass whether the batch is already in alphabetical order
+ * (the layout rewrite_receipts_to_file() produces). If it is, the nodes are
+ * linked as-is in O(n); otherwise the batch is sorted once with qsort()
+ * before linking. The batch storage is released; the nodes are not.
+ *
+ * @param batch Batch of nodes to link (ReceiptBatch*)
+ * @return Receipt* Head of the linked list, or NULL if the batch is empty
+ */
+Receipt *link_batch(ReceiptBatch *batch){
+    Receipt *head = NULL;
+    size_t i;
+
+    // Detect the already-sorted case
+    uint8_t sorted = 1;
+    for(i = 1; i < batch->count; i++){
+        if(compare_receipts(&batch->items[i-1], &batch->items[i]) > 0){
+            sorted = 0;
+            break;
+        }
+    }
+
+    if(!sorted){
+        custom_log(LOG_DEBUG, "File is not sorted, sorting on load.\n");
+        qsort(batch->items, batch->count, sizeof(Receipt*), compare_receipts);
+    }
+
+    // Link in order
+    for(i = 0; i < batch->count; i++){
+        Receipt *node = batch->items[i];
+        node->prev = (i > 0) ? batch->items[i-1] : NULL;
+        node->next = (i + 1 < batch->count) ? batch->items[i+1] : NULL;
+    }
+    if(batch->count > 0) head = batch->items[0];
+
+    free(batch->items);
+    batch->items = NULL;
+    batch->count = batch->capacity = 0;
+    return head;
+}
+
+/**
+ * @brief Picks the newline scanner used by the text loader
+ *
+ * Without a name, the widest implementation the CPU supports is chosen
+ * (AVX2, then SSE2). Without either, lines are found with one memchr()
+ * call each, as before the block scanner: a portable bitmask classifier
+ * was measured slower than the C library's own vectorized memchr().
+ * Benchmarks pass a name to force one.
+ *
+ * @param name "avx2", "sse2" or "memchr", or NULL for the best available (const char*)
+ * @return uint8_t 1 if the scanner was selected, 0 if the CPU does not support it
+ */
+uint8_t select_newline_scanner(const char *name){
+    NewlineMaskFn fn = NULL;
+    const char *chosen = "memchr";
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if((name == NULL || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")){
+        fn = newline_mask_avx2;
+        chosen = "avx2";
+    }
+    else if((name == NULL || strcmp(name, "sse2") == 0) && __builtin_cpu_supports("sse2")){
+        fn = newline_mask_sse2;
+        chosen = "sse2";
+    }
+#endif
+    if(name != NULL && strcmp(name, chosen) != 0) return 0;
+
+    newline_mask = fn;
+    newline_scanner = chosen;
+    return 1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief SSE2 newline classifier: four 16-byte compares per block
+ *
+ * @param block Start of the block, any alignment (const char*)
+ * @return uint64_t Bit i set when block[i] is '\n'
+ */
+__attribute__((target("sse2")))
+uint64_t newline_mask_sse2(const char *block){
+    const __m128i nl = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for(unsigned i = 0; i < SCAN_BLOCK; i += 16){
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (block + i));
+        mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nl)) << i;
+    }
+    return mask;
+}
+
+/**
+ * @brief AVX2 newline classifier: two 32-byte compares per block
+ *
+ * @param block Start of the block, any alignment (const char*)
+ * @return uint64_t Bit i set when block[i] is '\n'
+ */
+__attribute__((target("avx2")))
+uint64_t newline_mask_avx2(const char *block){
+    const __m256i nl = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i *) block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *) (block + 32));
+    uint64_t mask_lo = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl));
+    uint64_t mask_hi = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl));
+    return mask_lo | (mask_hi << 32);
+}
+#endif
+
+/**
+ * @brief Prepares a line scanner over a buffer
+ *
+ * @param scanner Scanner to initialize (LineScanner*)
+ * @param data Start of the buffer (const char*)
+ * @param len Length of the buffer in bytes (size_t)
+ */
+void line_scanner_init(LineScanner *scanner, const char *data, size_t len){
+    if(newline_scanner == NULL) select_newline_scanner(NULL);
+    scanner->data = data;
+    scanner->len = len;
+    scanner->block = 0;
+    scanner->mask = (newline_mask != NULL) ? line_scanner_classify(scanner, 0) : 0;
+}
+
+/**
+ * @brief Classifies one block of the scanner's buffer
+ *
+ * Full blocks go to the selected newline_mask implementation; the final
+ * partial block is classified byte by byte, so nothing past len is read.
+ *
+ * @param scanner Scanner over the buffer (const LineScanner*)
+ * @param block Offset of the block, a multiple of SCAN_BLOCK (size_t)
+ * @return uint64_t Bit i set when the byte at block + i is '\n'
+ */
+uint64_t line_scanner_classify(const LineScanner *scanner, size_t block){
+    const char *bytes = scanner->data + block;
+    if(block >= scanner->len) return 0;
+    if(scanner->len - block >= SCAN_BLOCK) return newline_mask(bytes);
+
+    uint64_t mask = 0;
+    for(size_t i = 0; i < scanner->len - block; i++){
+        mask |= (uint64_t) (bytes[i] == '\n') << i;
+    }
+    return mask;
+}
+
+/**
+ * @brief Returns the next newline of the buffer
+ *
+ * Each SCAN_BLOCK-byte block is classified once into a bitmask of newline
+ * positions; the lines inside it are then returned with a
+ * count-trailing-zeros and a clear-lowest-bit on the cached mask instead
+ * of a search call per line. Newlines are returned in order, once each.
+ * Only used with a block classifier; without one (see
+ * select_newline_scanner()) callers find each line with memchr() inline.
+ *
+ * @param scanner Scanner over the buffer (LineScanner*)
+ * @return size_t Offset of the next newline, or len once there are none left
+ */
+size_t line_scanner_next(LineScanner *scanner){
+    while(scanner->mask == 0){
+        scanner->block += SCAN_BLOCK;
+        if(scanner->block >= scanner->len) return scanner->len;
+        scanner->mask = line_scanner_classify(scanner, scanner->block);
+    }
+
+    size_t eol = scanner->block + (size_t) __builtin_ctzll(scanner->mask);
+    scanner->mask &= scanner->mask - 1;
+    return eol;
+}
+
+/**
+ * @brief Generates a unique ID for a new receipt
+ *
+ * Uses a static counter to track the next available ID. On first call with
+ * a non-empty list, initializes from the highest existing ID in the list;
+ * a full reload resets the counter to do so again.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint32_t A unique ID for a new receipt
+ */
+uint32_t get_new_id(Receipt *head){
+    // If this is the first call and list is not empty, initialize from the list
+    if(next_receipt_id == 0 && head != NULL){
+        Receipt *current = head;
+        while(current != NULL){
+            if(current->id >= next_receipt_id) next_receipt_id = current->id + 1;
+            current = current->next;
+        }
+    }
+
+    return next_receipt_id++;
+}
+
+/**
+ * @brief Returns the body text of a receipt
+ *
+ * Returns the in-memory body when there is one. Otherwise (lazy mode) the
+ * body is looked up in the bounded body cache, and on a miss read with a
+ * single pread() from the body source into the least recently used slot.
+ * Cache entries are keyed by the receipt's handle, so an entry left behind
+ * by a freed receipt is never served to a node that reuses its memory.
+ * The returned text is only guaranteed valid until the next call.
+ *
+ * @param r Receipt whose body is needed (Receipt*)
+ * @return const char* Null-terminated body, or NULL if it could not be read
+ */
+const char *receipt_body(Receipt *r){
+    if(r->receipt != NULL) return r->receipt;
+    if(body_fd < 0 || r->body_off < 0) return NULL;
+
+    // Look up the cache by handle, remembering the least recently used slot
+    ReceiptHandle owner = receipt_handle(r);
+    BodyCacheSlot *victim = &body_cache[0];
+    for(size_t i = 0; i < BODY_CACHE_SLOTS; i++){
+        if(owner.slot != 0 && body_cache[i].owner.slot == owner.slot && body_cache[i].owner.generation == owner.generation){
+            body_cache[i].last_used = ++body_cache_clock;
+            return body_cache[i].text;
+        }
+        if(body_cache[i].last_used < victim->last_used) victim = &body_cache[i];
+    }
+
+    // Miss: positioned read from the body source
+    char *text = malloc(r->body_len + 1);
+    if(text == NULL) return NULL;
+    size_t done = 0;
+    while(done < r->body_len){
+        ssize_t got = pread(body_fd, text + done, r->body_len - done, r->body_off + (off_t) done);
+        if(got <= 0){
+            free(text);
+            return NULL;
+        }
+        done += (size_t) got;
+    }
+    text[r->body_len] = '\0';
+
+    free(victim->text);
+    victim->owner = owner;
+    victim->text = text;
+    victim->last_used = ++body_cache_clock;
+    return text;
+}
+
+/**
+ * @brief Replaces the body of a receipt with an in-memory copy of text
+ *
+ * The copy goes into the body arena, whatever its length, and stays in
+ * memory until the next full rewrite puts it in the text file.
+ *
+ * @param r Receipt to update (Receipt*)
+ * @param text New body text (const char*)
+ * @param len Length of text in bytes (size_t)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t set_receipt_body(Receipt *r, const char *text, size_t len){
+    char *copy = body_alloc(text, len);
+    if(copy == NULL) return 0;
+
+    body_cache_forget(r);
+    body_release(r->receipt);
+    r->receipt = copy;
+    r->body_len = (uint32_t) len;
+    r->body_off = -1;
+    return 1;
+}
+
+/**
+ * @brief Bytes a body of len bytes takes in the arena
+ *
+ * A slice is a uint32_t length prefix, the body and a null terminator,
+ * padded so the next prefix stays aligned.
+ *
+ * @param len Body length in bytes (size_t)
+ * @return size_t Slice size in bytes
+ */
+size_t body_slice_size(size_t len){
+    size_t size = sizeof(uint32_t) + len + 1;
+    return (size + BODY_SLICE_ALIGN - 1) & ~(size_t) (BODY_SLICE_ALIGN - 1);
+}
+
+/**
+ * @brief Returns the length stored in front of an arena body
+ *
+ * @param body Body returned by body_alloc() (const char*)
+ * @return uint32_t Body length in bytes
+ */
+uint32_t body_slice_len(const char *body){
+    uint32_t len;
+    memcpy(&len, body - sizeof(uint32_t), sizeof(len));
+    return len;
+}
+
+/**
+ * @brief Finds the arena chunk a body was carved from
+ *
+ * Chunks are aligned to BODY_CHUNK_SIZE and every slice starts within the
+ * first BODY_CHUNK_SIZE bytes of its chunk, so masking the address is
+ * enough.
+ *
+ * @param body Body returned by body_alloc() (const char*)
+ * @return BodyChunk* Chunk holding the body
+ */
+BodyChunk *body_chunk(const char *body){
+    return (BodyChunk *) ((uintptr_t) body & ~(uintptr_t) (BODY_CHUNK_SIZE - 1));
+}
+
+/**
+ * @brief Copies a body into the arena
+ *
+ * Carves a length-prefixed slice from the calling thread's current chunk,
+ * starting a new chunk when it is full. Bodies larger than BODY_LARGE get
+ * a chunk of their own so they don't strand the rest of a shared one.
+ *
+ * @param text Body text (const char*)
+ * @param len Length of text in bytes (size_t)
+ * @return char* Null-terminated copy, to be given back with body_release(), or NULL on allocation failure
+ */
+char *body_alloc(const char *text, size_t len){
+    if(len > UINT32_MAX) return NULL;
+    size_t slice = body_slice_size(len);
+    BodyChunk *chunk = body_arena;
+
+    if(slice > BODY_LARGE){
+        size_t size = (sizeof(BodyChunk) + slice + BODY_CHUNK_SIZE - 1) & ~(size_t) (BODY_CHUNK_SIZE - 1);
+        chunk = body_chunk_new(size, 0);
+        if(chunk == NULL) return NULL;
+    }
+    else if(chunk == NULL || chunk->size - chunk->used < slice){
+        body_arena_close();
+        chunk = body_chunk_new(BODY_CHUNK_SIZE, 1);
+        if(chunk == NULL) return NULL;
+        body_arena = chunk;
+    }
+
+    char *p = (char *) (chunk + 1) + chunk->used;
+    uint32_t prefix = (uint32_t) len;
+    memcpy(p, &prefix, sizeof(prefix));
+    memcpy(p + sizeof(prefix), text, len);
+    p[sizeof(prefix) + len] = '\0';
+    chunk->used += slice;
+    chunk->live++;
+    chunk->live_bytes += slice;
+    return p + sizeof(prefix);
+}
+
+/**
+ * @brief Gives a body back to the arena
+ *
+ * A chunk is freed once its last body is released and no thread carves
+ * from it any more.
+ *
+ * @param body Body returned by body_alloc(), or NULL (const char*)
+ */
+void body_release(const char *body){
+    if(body == NULL) return;
+    BodyChunk *chunk = body_chunk(body);
+    chunk->live_bytes -= body_slice_size(body_slice_len(body));
+    if(--chunk->live == 0 && !chunk->open) body_chunk_free(chunk);
+}
+
+/**
+ * @brief Stops the calling thread carving bodies from its current chunk
+ *
+ * Loader threads call this before handing their nodes over, so the chunk
+ * is freed by whichever thread releases its last body.
+ */
+void body_arena_close(){
+    BodyChunk *chunk = body_arena;
+    if(chunk == NULL) return;
+    body_arena = NULL;
+    chunk->open = 0;
+    if(chunk->live == 0) body_chunk_free(chunk);
+}
+
+/**
+ * @brief Allocates an arena chunk and adds it to the chunk registry
+ *
+ * @param size Chunk size including the header, a multiple of BODY_CHUNK_SIZE (size_t)
+ * @param open 1 for a thread's current chunk, 0 for a single large body (uint8_t)
+ * @return BodyChunk* The empty chunk, or NULL on allocation failure
+ */
+BodyChunk *body_chunk_new(size_t size, uint8_t open){
+    BodyChunk *chunk = aligned_alloc(BODY_CHUNK_SIZE, size);
+    if(chunk == NULL) return NULL;
+    chunk->size = size - sizeof(BodyChunk);
+    chunk->used = 0;
+    chunk->live = 0;
+    chunk->live_bytes = 0;
+    chunk->open = open;
+
+    pthread_mutex_lock(&body_chunks_lock);
+    chunk->prev = NULL;
+    chunk->next = body_chunks;
+    if(body_chunks != NULL) body_chunks->prev = chunk;
+    body_chunks = chunk;
+    pthread_mutex_unlock(&body_chunks_lock);
+    return chunk;
+}
+
+/**
+ * @brief Removes a chunk from the chunk registry and frees it
+ *
+ * @param chunk Chunk with no live bodies (BodyChunk*)
+ */
+void body_chunk_free(BodyChunk *chunk){
+    pthread_mutex_lock(&body_chunks_lock);
+    if(chunk->prev != NULL) chunk->prev->next = chunk->next;
+    else body_chunks = chunk->next;
+    if(chunk->next != NULL) chunk->next->prev = chunk->prev;
+    pthread_mutex_unlock(&body_chunks_lock);
+    free(chunk);
+}
+
+/**
+ * @brief Frees every arena chunk at once, live bodies included
+ *
+ * One free() per chunk instead of one body_release() per body. Only for
+ * teardown: no body may be used afterwards and no other thread may be
+ * carving bodies.
+ */
+void body_arena_reset(){
+    pthread_mutex_lock(&body_chunks_lock);
+    BodyChunk *chunk = body_chunks;
+    while(chunk != NULL){
+        BodyChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    body_chunks = NULL;
+    pthread_mutex_unlock(&body_chunks_lock);
+    body_arena = NULL;
+}
+
+/**
+ * @brief Finds the slab a node was carved from
+ *
+ * Slabs are aligned to NODE_SLAB_SIZE, so masking the address is enough.
+ *
+ * @param node Node returned by node_alloc() (const Receipt*)
+ * @return NodeSlab* Slab holding the node
+ */
+NodeSlab *node_slab(const Receipt *node){
+    return (NodeSlab *) ((uintptr_t) node & ~(uintptr_t) (NODE_SLAB_SIZE - 1));
+}
+
+/**
+ * @brief Allocates an uninitialized receipt node from the node pool
+ *
+ * Takes the most recently freed node of the calling thread, or carves the
+ * next slot of its current slab. Only when both are dry is the pool lock
+ * taken, to adopt the nodes finished threads handed back or to add a slab.
+ *
+ * @return Receipt* Node to be given back with node_free(), or NULL on allocation failure
+ */
+Receipt *node_alloc(){
+    NodeCache *cache = &node_cache;
+    NodeSlab *slab = cache->slab;
+    if(cache->free == NULL && (slab == NULL || slab->used == slab->capacity)){
+        if(!node_pool_refill(cache)) return NULL;
+        slab = cache->slab;
+    }
+
+    Receipt *node;
+    if(cache->free != NULL){
+        node = cache->free;
+        cache->free = node->next;
+        cache->free_count--;
+        cache->recycled++;
+    }
+    else{
+        node = (Receipt *) (slab + 1) + slab->used++;
+    }
+    node->slot = 0;
+    node->journaled = 0;
+    node->body_slack = 0;
+    node_slab(node)->live++;
+    cache->allocs++;
+    return node;
+}
+
+/**
+ * @brief Gives a node back to the node pool
+ *
+ * The node goes onto the calling thread's freelist for the next
+ * node_alloc(); slabs are only returned to the system by node_pool_reset().
+ * Handles issued for the node go stale (see node_table_release()).
+ *
+ * @param node Node returned by node_alloc(), or NULL (Receipt*)
+ */
+void node_free(Receipt *node){
+    if(node == NULL) return;
+    if(node->slot != 0) node_table_release(node);
+    NodeCache *cache = &node_cache;
+    node_slab(node)->live--;
+    node->next = cache->free;
+    cache->free = node;
+    cache->free_count++;
+    cache->frees++;
+}
+
+/**
+ * @brief Restocks a thread's node cache from the shared pool
+ *
+ * Adopts the whole shared freelist if there is one, otherwise allocates a
+ * new slab and makes it the thread's current slab.
+ *
+ * @param cache Calling thread's cache (NodeCache*)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t node_pool_refill(NodeCache *cache){
+    uint8_t ok = 1;
+    pthread_mutex_lock(&node_pool.lock);
+    if(node_pool.free != NULL){
+        cache->free = node_pool.free;
+        cache->free_count = node_pool.free_count;
+        node_pool.free = NULL;
+        node_pool.free_count = 0;
+    }
+    else{
+        NodeSlab *slab = aligned_alloc(NODE_SLAB_SIZE, NODE_SLAB_SIZE);
+        if(slab != NULL){
+            slab->capacity = (NODE_SLAB_SIZE - sizeof(NodeSlab)) / sizeof(Receipt);
+            slab->used = 0;
+            slab->live = 0;
+            slab->next = node_pool.slabs;
+            node_pool.slabs = slab;
+            node_pool.slab_count++;
+            cache->slab = slab;
+        }
+        else{
+            ok = 0;
+        }
+    }
+    pthread_mutex_unlock(&node_pool.lock);
+    return ok;
+}
+
+/**
+ * @brief Hands a finished thread's node cache back to the shared pool
+ *
+ * The uncarved rest of the thread's slab and its freelist join the shared
+ * freelist, and its counters are added to the pool's. Loader threads call
+ * this before they exit.
+ */
+void node_cache_close(){
+    NodeCache *cache = &node_cache;
+    NodeSlab *slab = cache->slab;
+    if(slab != NULL){
+        while(slab->used < slab->capacity){
+            Receipt *node = (Receipt *) (slab + 1) + slab->used++;
+            node->next = cache->free;
+            cache->free = node;
+            cache->free_count++;
+        }
+    }
+
+    pthread_mutex_lock(&node_pool.lock);
+    if(cache->free != NULL){
+        Receipt *tail = cache->free;
+        while(tail->next != NULL) tail = tail->next;
+        tail->next = node_pool.free;
+        node_pool.free = cache->free;
+        node_pool.free_count += cache->free_count;
+    }
+    node_pool.allocs += cache->allocs;
+    node_pool.recycled += cache->recycled;
+    node_pool.frees += cache->frees;
+    pthread_mutex_unlock(&node_pool.lock);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief Frees every node slab at once, live nodes included
+ *
+ * One free() per slab instead of one node_free() per node. Only for
+ * teardown: no node may be used afterwards and no other thread may be
+ * allocating nodes. Every handle goes stale. The counters start over.
+ */
+void node_pool_reset(){
+    node_table_reset();
+    pthread_mutex_lock(&node_pool.lock);
+    NodeSlab *slab = node_pool.slabs;
+    while(slab != NULL){
+        NodeSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    node_pool.slabs = NULL;
+    node_pool.slab_count = 0;
+    node_pool.free = NULL;
+    node_pool.free_count = 0;
+    node_pool.allocs = 0;
+    node_pool.recycled = 0;
+    node_pool.frees = 0;
+    pthread_mutex_unlock(&node_pool.lock);
+    memset(&node_cache, 0, sizeof(node_cache));
+}
+
+/**
+ * @brief Collects node pool and body arena statistics
+ *
+ * Counters of threads that are still running (other than the caller) are
+ * not included.
+ *
+ * @param stats Receives the statistics (AllocatorStats*)
+ */
+void allocator_stats(AllocatorStats *stats){
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&node_pool.lock);
+    for(NodeSlab *slab = node_pool.slabs; slab != NULL; slab = slab->next){
+        stats->slabs++;
+        stats->slots += slab->capacity;
+        stats->carved += slab->used;
+        stats->live_nodes += slab->live;
+    }
+    stats->free_nodes = node_pool.free_count + node_cache.free_count;
+    stats->allocs = node_pool.allocs + node_cache.allocs;
+    stats->recycled = node_pool.recycled + node_cache.recycled;
+    stats->frees = node_pool.frees + node_cache.frees;
+    pthread_mutex_unlock(&node_pool.lock);
+
+    pthread_mutex_lock(&body_chunks_lock);
+    for(BodyChunk *chunk = body_chunks; chunk != NULL; chunk = chunk->next){
+        stats->chunks++;
+        stats->chunk_bytes += sizeof(BodyChunk) + chunk->size;
+        stats->live_bodies += chunk->live;
+        stats->body_bytes += chunk->live_bytes;
+    }
+    pthread_mutex_unlock(&body_chunks_lock);
+}
+
+/**
+ * @brief Prints allocator statistics with a label
+ *
+ * Node fragmentation is the share of carved slots that are free (on a
+ * freelist) rather than in use; body slack is the share of chunk bytes not
+ * held by a live body.
+ *
+ * @param label What the numbers were taken after (const char*)
+ */
+void print_allocator_stats(const char *label){
+    AllocatorStats st;
+    allocator_stats(&st);
+    double node_frag = st.carved ? 100.0 * (double) (st.carved - st.live_nodes) / (double) st.carved : 0.0;
+    double body_slack = st.chunk_bytes ? 100.0 * (double) (st.chunk_bytes - st.body_bytes) / (double) st.chunk_bytes : 0.0;
+    printf("%s\n", label);
+    printf("  nodes:  %zu live, %zu free-listed, %zu of %zu slots carved in %zu slabs (%.1f%% fragmentation)\n",
+           st.live_nodes, st.free_nodes, st.carved, st.slots, st.slabs, node_frag);
+    printf("          %zu allocations (%zu recycled), %zu frees\n", st.allocs, st.recycled, st.frees);
+    printf("  bodies: %zu live, %zu KiB of %zu KiB in %zu chunks (%.1f%% slack)\n",
+           st.live_bodies, st.body_bytes / 1024, st.chunk_bytes / 1024, st.chunks, body_slack);
+}
+
+/**
+ * @brief Returns the handle of a node, issuing one on first use
+ *
+ * The handle stays valid until the node is freed; after that it resolves
+ * to NULL, even once the node's memory or table slot is reused. Handles
+ * are issued and resolved by one thread at a time (the loader while it
+ * builds the ID index, the menu afterwards); loader workers never issue any.
+ *
+ * @param node Node returned by node_alloc() (Receipt*)
+ * @return ReceiptHandle The node's handle, or a zero handle on allocation failure
+ */
+ReceiptHandle receipt_handle(Receipt *node){
+    ReceiptHandle handle = {0, 0};
+    if(node->slot == 0){
+        uint32_t slot = node_table.free;
+        if(slot != 0){
+            node_table.free = node_table.slots[slot-1].next_free;
+        }
+        else{
+            if(!node_table_reserve(node_table.count + 1)) return handle;
+            slot = ++node_table.count;
+        }
+        node_table.slots[slot-1].node = node;
+        node_table.slots[slot-1].next_free = 0;
+        node_table.live++;
+        node->slot = slot;
+    }
+    handle.slot = node->slot;
+    handle.generation = node_table.slots[node->slot - 1].generation;
+    return handle;
+}
+
+/**
+ * @brief Resolves a handle to its receipt
+ *
+ * An array index plus a generation check: O(1), and a handle whose
+ * receipt was freed is detected instead of read through.
+ *
+ * @param handle Handle from receipt_handle() (ReceiptHandle)
+ * @return Receipt* The receipt, or NULL if the handle is zero or stale
+ */
+Receipt *receipt_get(ReceiptHandle handle){
+    if(handle.slot == 0 || handle.slot > node_table.count) return NULL;
+    const NodeTableSlot *entry = &node_table.slots[handle.slot - 1];
+    return (entry->generation == handle.generation) ? entry->node : NULL;
+}
+
+/**
+ * @brief Makes sure the node table can hold count slots
+ *
+ * Grows the array geometrically; slots keep their index, so handles stay valid.
+ *
+ * @param count Number of slots the table must hold (uint32_t)
+ * @return uint8_t 1 on success, 0 on allocation failure or past 2^32 - 1 slots
+ */
+uint8_t node_table_reserve(uint32_t count){
+    if(count <= node_table.capacity) return 1;
+    if(count == 0) return 0;    // Wrapped around
+
+    size_t capacity = node_table.capacity ? node_table.capacity : NODE_TABLE_INITIAL;
+    while(capacity < count) capacity *= 2;
+    if(capacity > UINT32_MAX) capacity = UINT32_MAX;
+    NodeTableSlot *slots = realloc(node_table.slots, capacity * sizeof(NodeTableSlot));
+    if(slots == NULL) return 0;
+    memset(&slots[node_table.capacity], 0, (capacity - node_table.capacity) * sizeof(NodeTableSlot));
+    node_table.slots = slots;
+    node_table.capacity = (uint32_t) capacity;
+    return 1;
+}
+
+/**
+ * @brief Releases a node's table slot
+ *
+ * Bumps the slot's generation, so every handle issued for the node goes
+ * stale, and puts the slot on the free list for the next node.
+ *
+ * @param node Node with an issued handle (Receipt*)
+ */
+void node_table_release(Receipt *node){
+    NodeTableSlot *entry = &node_table.slots[node->slot - 1];
+    entry->node = NULL;
+    entry->generation++;
+    entry->next_free = node_table.free;
+    node_table.free = node->slot;
+    node_table.live--;
+    node->slot = 0;
+}
+
+/**
+ * @brief Releases every slot of the node table at once
+ *
+ * Used when all nodes are freed wholesale (see node_pool_reset()). The
+ * slots are kept with their generations bumped, so handles issued before
+ * stay stale rather than resolving to whatever node gets the slot next.
+ */
+void node_table_reset(){
+    node_table.free = 0;
+    for(uint32_t slot = node_table.count; slot > 0; slot--){
+        NodeTableSlot *entry = &node_table.slots[slot-1];
+        if(entry->node != NULL){
+            entry->node = NULL;
+            entry->generation++;
+        }
+        entry->next_free = node_table.free;
+        node_table.free = slot;
+    }
+    node_table.live = 0;
+}
+
+/**
+ * @brief Drops the cached body of a receipt, if any
+ *
+ * @param r Receipt whose cache entry is dropped (const Receipt*)
+ */
+void body_cache_forget(const Receipt *r){
+    if(r->slot == 0) return;
+    for(size_t i = 0; i < BODY_CACHE_SLOTS; i++){
+        if(body_cache[i].owner.slot == r->slot){
+            free(body_cache[i].text);
+            memset(&body_cache[i], 0, sizeof(BodyCacheSlot));
+        }
+    }
+}
+
+/**
+ * @brief Empties the body cache
+ */
+void body_cache_clear(){
+    for(size_t i = 0; i < BODY_CACHE_SLOTS; i++){
+        free(body_cache[i].text);
+    }
+    memset(body_cache, 0, sizeof(body_cache));
+    body_cache_clock = 0;
+}
+
+/**
+ * @brief Makes path the file that non-resident bodies are read from
+ *
+ * @param path Path of the text file or snapshot holding the bodies (const char*)
+ */
+void open_body_source(const char *path){
+    if(body_fd >= 0) close(body_fd);
+    body_fd = open(path, O_RDONLY);
+    if(body_fd < 0){
+        custom_log(LOG_ERROR, "Could not open receipts for lazy reading.\n");
+    }
+}
+
+/**
+ * @brief Maps the whole body source for bulk copying
+ *
+ * @param len Receives the mapped length (size_t*)
+ * @return const char* Mapping to munmap() after use, or NULL if there is no body source
+ */
+const char *map_body_source(size_t *len){
+    return map_for_copy(body_fd, len);
+}
+
+/**
+ * @brief Maps a whole file for one sequential pass
+ *
+ * @param fd Open descriptor, or -1 (int)
+ * @param len Receives the mapped length (size_t*)
+ * @return const char* Mapping to munmap() after use, or NULL if fd is invalid or the file empty
+ */
+const char *map_for_copy(int fd, size_t *len){
+    struct stat st;
+    *len = 0;
+    if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) return NULL;
+
+    char *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) return NULL;
+    madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+    *len = (size_t) st.st_size;
+    return data;
+}
+
+/**
+ * @brief Returns a pointer to the body bytes of a receipt for bulk writes
+ *
+ * The result holds body_len bytes and is not null-terminated when it
+ * points into the mapped body source.
+ *
+ * @param r Receipt whose body is needed (const Receipt*)
+ * @param source Mapping from map_body_source(), or NULL (const char*)
+ * @param source_len Length of the mapping (size_t)
+ * @return const char* Body bytes, or NULL if the body is unavailable
+ */
+const char *body_bytes(const Receipt *r, const char *source, size_t source_len){
+    if(r->receipt != NULL) return r->receipt;
+    if(source == NULL || r->body_off < 0 || (uint64_t) r->body_off + r->body_len > source_len){
+        custom_log(LOG_ERROR, "Receipt body is not available.\n");
+        return NULL;
+    }
+    return source + r->body_off;
+}
+
+/**
+ * @brief Saves a single receipt to the file in append mode
+ *
+ * Formats the record into the append writer's buffer. When it reaches the
+ * file depends on the durability policy (see select_durability()): with
+ * DURABLE_EVERY_OP it is written and flushed to disk before returning;
+ * otherwise it waits for the end of the commit window or for exit, and
+ * goes out with the records queued next to it in one write (see
+ * append_flush()). Until then the receipt's body offset is -1 and its body
+ * stays in memory. Logs an error if the operation fails.
+ *
+ * @param r Pointer to the receipt to save (Receipt*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t save_receipt_to_file(Receipt *r){
+    if(r == NULL){
+        custom_log(LOG_ERROR, "Receipt is corrupted.\n");
+        return 0; // Return 0: Fail
+    }
+
+    const char *body = receipt_body(r);
+    if(body == NULL){
+        return 0; // Return 0: Fail
+    }
+
+    // Format the record up front: its bytes also extend the index hash
+    size_t name_len = strlen(r->name);
+    size_t id_len = (size_t) snprintf(NULL, 0, "Id: %u\n", r->id);
+    size_t len = LEN_PREFIX_NAME + name_len + 1 + id_len + LEN_PREFIX_RECEIPT + r->body_len + 1;
+
+    // A full buffer goes out first; one record larger than the buffer gets one of its own
+    if(appender.len > 0 && appender.len + len + 1 > appender.capacity && !append_flush()){
+        return 0; // Return 0: Fail
+    }
+    if(appender.len + len + 1 > appender.capacity){
+        size_t capacity = (len + 1 > APPEND_BUFFER) ? len + 1 : APPEND_BUFFER;
+        char *data = realloc(appender.data, capacity);
+        if(data == NULL){
+            custom_log(LOG_ERROR, "Memory allocation failed for the append buffer.\n");
+            return 0; // Return 0: Fail
+        }
+        appender.data = data;
+        appender.capacity = capacity;
+    }
+    if(appender.count == appender.pending_capacity){
+        size_t capacity = appender.pending_capacity ? appender.pending_capacity * 2 : LOAD_BATCH_INITIAL;
+        Receipt **pending = realloc(appender.pending, capacity * sizeof(Receipt *));
+        if(pending != NULL) appender.pending = pending;
+        size_t *body_at = realloc(appender.body_at, capacity * sizeof(size_t));
+        if(body_at != NULL) appender.body_at = body_at;
+        if(pending == NULL || body_at == NULL){
+            custom_log(LOG_ERROR, "Memory allocation failed for the append buffer.\n");
+            return 0; // Return 0: Fail
+        }
+        appender.pending_capacity = capacity;
+    }
+
+    snprintf(appender.data + appender.len, len + 1, "Name: %s\nId: %u\nReceipt: %s\n", r->name, r->id, body);
+    r->body_off = -1;
+    appender.pending[appender.count] = r;
+    appender.body_at[appender.count] = appender.len + LEN_PREFIX_NAME + name_len + 1 + id_len + LEN_PREFIX_RECEIPT;
+    appender.count++;
+    appender.len += len;
+    if(!appender.window){
+        appender.window = 1;
+        clock_gettime(CLOCK_MONOTONIC, &appender.since);
+    }
+
+    if(appender.durability == DURABLE_EVERY_OP) return append_commit();
+    append_commit_due();
+    return 1;   // Return 1: Success
+}
+
+/**
+ * @brief Selects the durability policy for new receipts (and the journal)
+ *
+ * "always" makes every new receipt durable before create_receipt()
+ * returns (the default); a number of milliseconds groups everything
+ * created within that window into one write and one fsync; "exit" only
+ * writes when the buffer fills and syncs at exit, so a crash loses what
+ * was added since the last write.
+ *
+ * @param text "always", "exit" or a commit interval in ms (const char*)
+ * @return uint8_t 1 if the policy was selected, 0 if text is not one
+ */
+uint8_t select_durability(const char *text){
+    char *end = NULL;
+    if(strcmp(text, "always") == 0){
+        appender.durability = DURABLE_EVERY_OP;
+        return 1;
+    }
+    if(strcmp(text, "exit") == 0){
+        appender.durability = DURABLE_ON_EXIT;
+        return 1;
+    }
+
+    unsigned long ms = strtoul(text, &end, 10);
+    if(end == text || *end != '\0' || ms == 0 || ms > INT32_MAX) return 0;
+    appender.durability = DURABLE_INTERVAL;
+    appender.interval_ms = (unsigned) ms;
+    return 1;
+}
+
+/**
+ * @brief Writes the pending new receipts to the receipts file
+ *
+ * All of them go out in one write() through the writer's descriptor,
+ * which stays open between calls. It is reopened when the path no longer
+ * names the file it was opened on, as after a rewrite or a compaction.
+ * Then the pending receipts learn their body offsets, the file watch
+ * moves past the records and the sidecar index takes them in with one
+ * update. A failed write is cut off again and the records stay pending.
+ * Does not fsync (see append_commit()).
+ *
+ * Anything else that writes the receipts files or reloads the list calls
+ * this first, so the records land in the file in the order they were made
+ * and no pending receipt is freed before it is written.
+ *
+ * @return uint8_t 1 on success (or nothing pending), 0 on failure
+ */
+uint8_t append_flush(){
+    if(appender.count == 0) return 1;
+
+    struct stat before;
+    if(appender.fd >= 0 && (stat(receipts_path, &before) != 0
+       || before.st_dev != appender.dev || before.st_ino != appender.ino)){
+        // Replaced since the last write: a full sync of the old file is moot
+        close(appender.fd);
+        appender.fd = -1;
+        appender.unsynced = 0;
+    }
+    if(appender.fd < 0){
+        // O_APPEND creates the file if it doesn't exist
+        appender.fd = open(receipts_path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if(appender.fd < 0){
+            custom_log(LOG_ERROR, "Could not open file for writing.\n");
+            return 0; // Return 0: Fail
+        }
+    }
+    if(fstat(appender.fd, &before) != 0){
+        custom_log(LOG_ERROR, "Could not stat receipts file.\n");
+        return 0; // Return 0: Fail
+    }
+    appender.dev = before.st_dev;
+    appender.ino = before.st_ino;
+
+    appender.writes++;
+    if(!write_all(appender.fd, appender.data, appender.len)){
+        if(ftruncate(appender.fd, before.st_size) != 0) custom_log(LOG_ERROR, "Could not truncate receipts file.\n");
+        custom_log(LOG_ERROR, "Could not write receipts file.\n");
+        return 0; // Return 0: Fail
+    }
+    appender.unsynced = 1;
+
+    for(size_t i = 0; i < appender.count; i++){
+        appender.pending[i]->body_off = before.st_size + (off_t) appender.body_at[i];
+    }
+    track_own_append(&before, appender.len);
+    if(!index_append(receipts_path, appender.pending, appender.count, &before)){
+        custom_log(LOG_DEBUG, "Index not updated, it will be rebuilt on next load.\n");
+    }
+    appender.len = 0;
+    appender.count = 0;
+    return 1;   // Return 1: Success
+}
+
+/**
+ * @brief Ends the commit window: writes pending receipts and flushes them to disk
+ *
+ * One fdatasync() covers every record written since the last commit, and
+ * one more each the journal records written and the records patched in
+ * place meanwhile. fdatasync() is enough for appends: the file size is
+ * flushed with the data.
+ *
+ * @return uint8_t 1 on success, 0 on failure (the window stays open)
+ */
+uint8_t append_commit(){
+    uint8_t ok = append_flush();
+    if(ok && appender.unsynced){
+        appender.syncs++;
+        if(fdatasync(appender.fd) == 0) appender.unsynced = 0;
+        else ok = 0;
+    }
+    if(ok && appender.journal_unsynced){
+        char path[LEN_PATH];
+        sidecar_path(path, sizeof(path), receipts_path, JOURNAL_EXT);
+        ok = sync_path(path);
+        if(ok) appender.journal_unsynced = 0;
+    }
+    if(ok && appender.patch_unsynced){
+        ok = sync_path(receipts_path);
+        if(ok) appender.patch_unsynced = 0;
+    }
+
+    if(!ok){
+        custom_log(LOG_ERROR, "Could not commit receipts to disk.\n");
+        return 0; // Return 0: Fail
+    }
+    appender.window = 0;
+    return 1;   // Return 1: Success
+}
+
+/**
+ * @brief Time left in the current commit window
+ *
+ * @return int Milliseconds until append_commit_due() commits, 0 if it is overdue, -1 if no window is open or the policy has none
+ */
+int append_due_ms(){
+    if(!appender.window || appender.durability != DURABLE_INTERVAL) return -1;
+    double left = (double) appender.interval_ms - elapsed_ms(&appender.since);
+    return (left > 0) ? (int) left + 1 : 0;
+}
+
+/**
+ * @brief Commits once the commit window has run out
+ *
+ * Called after each new receipt and from the menu loop, which wakes up
+ * for it (see append_due_ms()). Prompts don't wake up: see
+ * append_commit_open().
+ */
+void append_commit_due(){
+    if(append_due_ms() == 0) append_commit();
+}
+
+/**
+ * @brief Commits an open commit window before it could outlast its interval
+ *
+ * The menu calls this before it blocks on a prompt, where nothing wakes
+ * it up for append_commit_due(); the window would otherwise stay open for
+ * as long as the prompt waits.
+ */
+void append_commit_open(){
+    if(append_due_ms() >= 0) append_commit();
+}
+
+/**
+ * @brief Flushes a file written through another descriptor to disk
+ *
+ * @param path File to flush; a missing one (folded in by a rewrite or compaction since) is fine (const char*)
+ * @return uint8_t 1 on success, 0 if the flush failed
+ */
+uint8_t sync_path(const char *path){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return 1;
+
+    appender.syncs++;
+    uint8_t ok = (fdatasync(fd) == 0);
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Applies the durability policy to a record just written outside the append buffer
+ *
+ * Used for journal records and in-place patches. With DURABLE_EVERY_OP
+ * the file is flushed to disk now; otherwise with the next commit.
+ *
+ * @param fd Descriptor the record was written through (int)
+ * @param unsynced Flag the next commit checks for this file (uint8_t*)
+ * @return uint8_t 1 on success, 0 if the flush failed
+ */
+uint8_t append_written(int fd, uint8_t *unsynced){
+    if(appender.durability == DURABLE_EVERY_OP){
+        appender.syncs++;
+        return fdatasync(fd) == 0;
+    }
+    *unsynced = 1;
+    if(!appender.window){
+        appender.window = 1;
+        clock_gettime(CLOCK_MONOTONIC, &appender.since);
+    }
+    return 1;
+}
+
+/**
+ * @brief Forgets the pending receipts after a rewrite wrote them out
+ *
+ * rewrite_receipts_to_file() writes and flushes the whole list, pending
+ * receipts included, and removes the journal.
+ */
+void append_drop(){
+    appender.len = 0;
+    appender.count = 0;
+    appender.unsynced = 0;
+    appender.journal_unsynced = 0;
+    appender.patch_unsynced = 0;
+    appender.window = 0;
+}
+
+/**
+ * @brief Commits whatever is left and closes the append writer
+ *
+ * Called at exit, before the list is freed; the durability policy is kept.
+ */
+void append_close(){
+    append_commit();
+    if(appender.fd >= 0) close(appender.fd);
+    free(appender.data);
+    free(appender.pending);
+    free(appender.body_at);
+
+    Durability durability = appender.durability;
+    unsigned interval_ms = appender.interval_ms;
+    memset(&appender, 0, sizeof(appender));
+    appender.fd = -1;
+    appender.durability = durability;
+    appender.interval_ms = interval_ms;
+}
+
+/**
+ * @brief Overwrites a receipt's body in the receipts file, in place
+ *
+ * The new body goes where the old one is, followed by its newline and, if
+ * it is shorter, a filler line of spaces that the parser skips; the filler
+ * is the record's slack and a later, longer body can grow into it. That is
+ * one pwrite() of the record's body, with no journal record and nothing
+ * left for compaction, plus two small writes to the index (see
+ * index_patch()). The file is flushed to disk as the durability policy says.
+ * A snapshot would still hold the old body, so it is removed before the
+ * first patch; loads use the index until the next rewrite writes it again.
+ *
+ * Returns 0, leaving everything untouched, when the record cannot be
+ * patched safely and the caller must relocate the body (journal it):
+ * - the new body does not fit the old one and its slack, or holds a newline
+ * - the text record is not the current version (a journal record supersedes it, or it is not written yet)
+ * - it lies within the first WATCH_HEAD_BYTES, which the file watch and the journal identify the file by
+ * - the patch would span two HASH_BLOCK blocks: within one block, the write goes out as one page
+ * - a compaction is copying the file, or the snapshot cannot be removed
+ * - the file is no longer the one the list was loaded from, or does not hold the record where expected
+ *
+ * @param r Receipt to update (Receipt*)
+ * @param text New body text, without a newline (const char*)
+ * @param len Length of text in bytes (size_t)
+ * @return uint8_t 1 if the body was patched in place, 0 if it must be relocated
+ */
+uint8_t patch_receipt(Receipt *r, const char *text, size_t len){
+    char snap[LEN_PATH];
+    sidecar_path(snap, sizeof(snap), receipts_path, SNAPSHOT_EXT);
+
+    off_t start = r->body_off;
+    off_t end = start + (off_t) r->body_len + 1 + (off_t) r->body_slack;
+    if(!patch_in_place || start < WATCH_HEAD_BYTES || r->journaled || len > (size_t) r->body_len + r->body_slack
+       || memchr(text, '\n', len) != NULL || start / HASH_BLOCK != (end - 1) / HASH_BLOCK
+       || atomic_load(&compaction.state) != COMPACT_IDLE || !file_watch.valid){
+        return 0;
+    }
+
+    // In eager mode the body stays in memory as well
+    char *copy = NULL;
+    if(!lazy_bodies && (copy = body_alloc(text, len)) == NULL) return 0;
+
+    int fd = open(receipts_path, O_RDWR);
+    if(fd < 0){
+        body_release(copy);
+        return 0;
+    }
+
+    struct stat before, after;
+    char block[HASH_BLOCK];
+    off_t block_start = start - start % HASH_BLOCK;
+    size_t block_len = 0;
+    uint8_t ok = fstat(fd, &before) == 0
+        && before.st_dev == file_watch.dev && before.st_ino == file_watch.ino
+        && before.st_size == file_watch.loaded_size && end <= before.st_size;
+    if(ok){
+        // The record must still end where the list thinks it does
+        block_len = (before.st_size - block_start < HASH_BLOCK) ? (size_t) (before.st_size - block_start) : HASH_BLOCK;
+        ok = pread(fd, block, block_len, block_start) == (ssize_t) block_len
+             && block[start - block_start + r->body_len] == '\n' && block[end - 1 - block_start] == '\n';
+    }
+
+    // Same size and possibly the same mtime: drop the snapshot before it goes stale unnoticed
+    if(ok && unlink(snap) != 0 && errno != ENOENT) ok = 0;
+
+    size_t room = (size_t) (end - start);
+    uint64_t old_terms = 0, new_terms = 0;
+    if(ok){
+        old_terms = hash_block((uint64_t) (block_start / HASH_BLOCK), block, block_len);
+
+        // Body, newline, then the rest as a filler line
+        char *at = block + (start - block_start);
+        memcpy(at, text, len);
+        at[len] = '\n';
+        if(room > len + 1){
+            memset(at + len + 1, ' ', room - len - 2);
+            at[room - 1] = '\n';
+        }
+        new_terms = hash_block((uint64_t) (block_start / HASH_BLOCK), block, block_len);
+        ok = pwrite(fd, at, room, start) == (ssize_t) room;
+        if(ok) ok = append_written(fd, &appender.patch_unsynced);
+    }
+    if(ok && (fstat(fd, &after) != 0 || !index_patch(receipts_path, r, (uint32_t) len, &before, &after, old_terms, new_terms))){
+        custom_log(LOG_DEBUG, "Index not updated, it will be rebuilt on next load.\n");
+    }
+    close(fd);
+    if(!ok){
+        body_release(copy);
+        return 0;
+    }
+
+    // A shorter body leaves the difference as filler until the next rewrite
+    if(len <= r->body_len) compaction.dead_bytes += r->body_len - len;
+    else compaction.dead_bytes -= (compaction.dead_bytes < len - r->body_len) ? compaction.dead_bytes : len - r->body_len;
+
+    body_cache_forget(r);
+    body_release(r->receipt);
+    r->receipt = copy;
+    r->body_len = (uint32_t) len;
+    r->body_slack = (uint32_t) (room - len - 1);
+    patch_totals.patched++;
+    patch_totals.bytes += room;
+    return 1;
+}
+
+/**
+ * @brief Rewrites the entire receipt file with current list contents
+ *
+ * Writes all receipts from the linked list to a temporary file, flushes it
+ * to disk and renames it over the receipts file, then flushes the
+ * directory so the rename itself survives a crash. At every point the
+ * receipts file is either the old one or the complete new one. The new
+ * file holds every journaled update and delete, so the journal is removed
+ * afterwards. Used when the journal cannot be written. The old file stays
+ * readable until the rename, which lazy mode relies on:
+ * bodies that are not in memory are copied from the current body source.
+ * Afterwards every node's body offset points into the new file, and in
+ * lazy mode in-memory bodies that are now on disk are released.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t rewrite_receipts_to_file(Receipt *head){
+    char tmp[LEN_PATH + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", receipts_path);
+
+    size_t count = 0;
+    Receipt *current;
+    for(current = head; current != NULL; current = current->next) count++;
+
+    off_t *offsets = malloc((count ? count : 1) * sizeof(off_t));
+    if(offsets == NULL){
+        custom_log(LOG_ERROR, "Could not rewrite file.\n");
+        return 0;
+    }
+
+    size_t source_len = 0;
+    const char *source = map_body_source(&source_len);
+    uint8_t ok = write_receipts_file(head, tmp, source, source_len, offsets, 1);
+    if(ok && rename(tmp, receipts_path) != 0) ok = 0;
+    if(ok && !sync_directory_of(receipts_path)) custom_log(LOG_WARN, "Could not sync the receipts directory.\n");
+    if(source != NULL) munmap((void *) source, source_len);
+
+    if(!ok){
+        unlink(tmp);
+        free(offsets);
+        custom_log(LOG_ERROR, "Could not rewrite file.\n");
+        return 0;
+    }
+
+    // Bodies now live in the new file
+    size_t i = 0;
+    for(current = head; current != NULL; current = current->next, i++){
+        current->body_off = offsets[i];
+        current->body_slack = 0;
+        current->journaled = 0;
+        if(lazy_bodies && current->receipt != NULL){
+            body_release(current->receipt);
+            current->receipt = NULL;
+        }
+    }
+    free(offsets);
+    append_drop();
+    if(lazy_bodies) open_body_source(receipts_path);
+    track_receipts_path(receipts_path, NULL);
+    journal_reset(receipts_path);
+    compaction.renumbered = 0;
+    custom_log(LOG_INFO, "File updated.\n");
+
+    // Keep the binary snapshot and the index in step with the text file
+    if(!write_snapshot(head, receipts_path)){
+        custom_log(LOG_WARN, "Could not write snapshot.\n");
+    }
+    if(!write_index(head, receipts_path)){
+        custom_log(LOG_WARN, "Could not write index.\n");
+    }
+    return 1;
+}
+
+/**
+ * @brief Writes a list to a new text file
+ *
+ * Writes every receipt in list order, in the format save_receipt_to_file()
+ * appends, and records where each body lands. Bodies that are not in
+ * memory are copied from source at their current offsets. Records are
+ * serialized into a REWRITE_BUFFER-byte buffer that goes out with one
+ * write() whenever it fills up, rather than through a default-sized stdio
+ * buffer. With durable set the file is flushed to disk with fsync()
+ * before this returns, so it can be renamed over a file that matters.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param path File to create or truncate (const char*)
+ * @param source Mapping of the file the body offsets point into, or NULL (const char*)
+ * @param source_len Length of the mapping (size_t)
+ * @param offsets Receives the new body offset of each receipt, in list order (off_t*)
+ * @param durable 1 to fsync() the file, 0 to leave it to the page cache (uint8_t)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_receipts_file(Receipt *head, const char *path, const char *source, size_t source_len, off_t *offsets, uint8_t durable){
+    WriteBuffer out = {0};
+    out.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(out.fd < 0) return 0;
+    out.capacity = REWRITE_BUFFER;
+    out.data = malloc(out.capacity);
+    out.ok = (out.data != NULL);
+
+    off_t pos = 0;
+    size_t i = 0;
+    for(Receipt *current = head; current != NULL && out.ok; current = current->next, i++){
+        const char *body = body_bytes(current, source, source_len);
+        if(body == NULL){
+            out.ok = 0;
+            break;
+        }
+        char id_line[LEN_PREFIX_ID + LEN_INPUT_BUFFER];
+        size_t id_len = (size_t) snprintf(id_line, sizeof(id_line), "Id: %u\n", current->id);
+        size_t name_len = strlen(current->name);
+        write_buffer_put(&out, "Name: ", LEN_PREFIX_NAME);
+        write_buffer_put(&out, current->name, name_len);
+        write_buffer_put(&out, "\n", 1);
+        write_buffer_put(&out, id_line, id_len);
+        write_buffer_put(&out, "Receipt: ", LEN_PREFIX_RECEIPT);
+        write_buffer_put(&out, body, current->body_len);
+        write_buffer_put(&out, "\n", 1);
+
+        // Track where this body lands in the new file
+        pos += LEN_PREFIX_NAME + (off_t) (name_len + 1 + id_len);
+        offsets[i] = pos + LEN_PREFIX_RECEIPT;
+        pos += LEN_PREFIX_RECEIPT + (off_t) current->body_len + 1;
+    }
+    write_buffer_flush(&out);
+    if(out.ok && durable && fsync(out.fd) != 0) out.ok = 0;
+    if(close(out.fd) != 0) out.ok = 0;
+    free(out.data);
+    return out.ok;
+}
+
+/**
+ * @brief Appends bytes to a write buffer
+ *
+ * Flushes the buffer first when the bytes don't fit; a block larger than
+ * the whole buffer (a very long body) is written straight through.
+ *
+ * @param out Buffer to append to (WriteBuffer*)
+ * @param data Bytes to append (const char*)
+ * @param len Number of bytes (size_t)
+ */
+void write_buffer_put(WriteBuffer *out, const char *data, size_t len){
+    if(!out->ok) return;
+    if(out->len + len > out->capacity){
+        write_buffer_flush(out);
+        if(len > out->capacity){
+            if(!write_all(out->fd, data, len)) out->ok = 0;
+            return;
+        }
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+/**
+ * @brief Writes out and empties a write buffer
+ *
+ * @param out Buffer to flush (WriteBuffer*)
+ */
+void write_buffer_flush(WriteBuffer *out){
+    if(out->ok && out->len > 0 && !write_all(out->fd, out->data, out->len)) out->ok = 0;
+    out->len = 0;
+}
+
+/**
+ * @brief Writes a whole block to a file, across short writes
+ *
+ * @param fd Descriptor open for writing (int)
+ * @param data Bytes to write (const char*)
+ * @param len Number of bytes (size_t)
+ * @return uint8_t 1 on success, 0 on a write error
+ */
+uint8_t write_all(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t done = write(fd, data, len);
+        if(done <= 0) return 0;
+        data += done;
+        len -= (size_t) done;
+    }
+    return 1;
+}
+
+/**
+ * @brief Flushes the directory holding a file to disk
+ *
+ * Needed after a rename() for the new name to survive a crash; fsync()
+ * on the file itself only covers its contents.
+ *
+ * @param path Path of a file in the directory (const char*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t sync_directory_of(const char *path){
+    char dir[LEN_PATH];
+    const char *slash = strrchr(path, '/');
+    if(slash == NULL) snprintf(dir, sizeof(dir), ".");
+    else if(slash == path) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path), path);
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if(fd < 0) return 0;
+    uint8_t ok = (fsync(fd) == 0);
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Builds the path of a sidecar file next to the receipts file
+ *
+ * Replaces a trailing ".txt" of data_path with ext, or appends ext when
+ * there is none ("receipts.txt" -> "receipts.bin").
+ *
+ * @param out Output buffer (char*)
+ * @param size Size of the output buffer (size_t)
+ * @param data_path Path of the receipts file (const char*)
+ * @param ext Extension including the dot (const char*)
+ */
+void sidecar_path(char *out, size_t size, const char *data_path, const char *ext){
+    size_t len = strlen(data_path);
+    if(len >= 4 && strcmp(data_path + len - 4, ".txt") == 0) len -= 4;
+    snprintf(out, size, "%.*s%s", (int) len, data_path, ext);
+}
+
+/**
+ * @brief Writes the binary snapshot mirroring the receipts file
+ *
+ * Layout: a SnapshotHeader, a table of SnapshotRecord entries in list
+ * (alphabetical) order, then a heap holding all names followed by all
+ * bodies, so a lazy load only touches the front of the heap. The header records the size and mtime of the text file so a later
+ * load can tell whether the snapshot is current. The file is written under
+ * a temporary name and renamed into place, so readers never see half of it.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param data_path Path of the text receipts file, already written (const char*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_snapshot(Receipt *head, const char *data_path){
+    struct stat st;
+    if(stat(data_path, &st) != 0) return 0;
+
+    char snap[LEN_PATH], tmp[LEN_PATH + 8];
+    sidecar_path(snap, sizeof(snap), data_path, SNAPSHOT_EXT);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", snap);
+
+    // First pass: size the table
+    uint32_t count = 0;
+    Receipt *current;
+    for(current = head; current != NULL; current = current->next) count++;
+
+    SnapshotRecord *table = malloc((count ? count : 1) * sizeof(SnapshotRecord));
+    if(table == NULL) return 0;
+
+    // Second pass: lay out the heap, names first
+    uint64_t heap = 0;
+    uint32_t i = 0;
+    for(current = head; current != NULL; current = current->next, i++){
+        table[i].id = current->id;
+        table[i].name_len = (uint32_t) strlen(current->name);
+        table[i].name_off = (uint32_t) heap;
+        heap += table[i].name_len;
+    }
+    i = 0;
+    for(current = head; current != NULL; current = current->next, i++){
+        if(current->body_off < 0){
+            // Body not in the text file yet: the snapshot could not be lazy-loaded
+            free(table);
+            return 0;
+        }
+        table[i].text_off = (uint64_t) current->body_off;
+        table[i].body_len = current->body_len;
+        table[i].body_off = (uint32_t) heap;
+        table[i].reserved = 0;
+        heap += table[i].body_len;
+    }
+    if(heap > UINT32_MAX){
+        // Offsets are 32-bit; such a cookbook keeps using the text loader
+        free(table);
+        return 0;
+    }
+
+    SnapshotHeader header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.count = count;
+    header.source_size = (uint64_t) st.st_size;
+    header.source_mtime_sec = st.st_mtim.tv_sec;
+    header.source_mtime_nsec = st.st_mtim.tv_nsec;
+    header.heap_size = heap;
+
+    FILE *fptr = fopen(tmp, "wb");
+    if(fptr == NULL){
+        free(table);
+        return 0;
+    }
+    setvbuf(fptr, NULL, _IOFBF, SNAPSHOT_IO_BUFFER);
+
+    // Bodies not in memory are copied from the text file, where every one of them is
+    int source_fd = open(data_path, O_RDONLY);
+    size_t source_len = 0;
+    const char *source = map_for_copy(source_fd, &source_len);
+    if(source_fd >= 0) close(source_fd);
+    uint8_t ok = 1;
+
+    fwrite(&header, sizeof(header), 1, fptr);
+    fwrite(table, sizeof(SnapshotRecord), count, fptr);
+    i = 0;
+    for(current = head; current != NULL; current = current->next, i++){
+        fwrite(current->name, 1, table[i].name_len, fptr);
+    }
+    for(current = head; current != NULL; current = current->next){
+        const char *body = body_bytes(current, source, source_len);
+        if(body == NULL){
+            ok = 0;
+            break;
+        }
+        fwrite(body, 1, current->body_len, fptr);
+    }
+    free(table);
+    if(source != NULL) munmap((void *) source, source_len);
+
+    if(ferror(fptr)) ok = 0;
+    if(fclose(fptr) != 0) ok = 0;
+    if(ok && rename(tmp, snap) != 0) ok = 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
+
+/**
+ * @brief Loads the receipt list from the binary snapshot, if it is current
+ *
+ * Maps the snapshot and checks its signature, version, overall size and
+ * the recorded size/mtime of the text file. A valid snapshot is already in
+ * sorted order, so nodes are filled straight from the record table and the
+ * heap and linked in sequence; nothing is parsed or sorted. Nodes are still
+ * taken from the node pool and bodies copied into the arena, rather than
+ * pointing into the mapping: the list stays independent of the file, which
+ * a later rewrite replaces, and the mapping is released before returning.
+ * In lazy mode bodies are left on disk and later read on demand from the
+ * text file, which the snapshot has just been checked to match. If memory
+ * runs out part way, the partial list is freed and 0 returned, so the
+ * caller falls back to the index or the text rather than a truncated list.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param head Receives the head of the loaded list (Receipt**)
+ * @return uint8_t 1 if the snapshot was used, 0 if the caller must parse the text file
+ */
+uint8_t load_snapshot(const char *data_path, Receipt **head){
+    struct stat data_st, snap_st;
+    char snap[LEN_PATH];
+
+    *head = NULL;
+    if(stat(data_path, &data_st) != 0) return 0;
+
+    sidecar_path(snap, sizeof(snap), data_path, SNAPSHOT_EXT);
+    int fd = open(snap, O_RDONLY);
+    if(fd < 0) return 0;
+    if(fstat(fd, &snap_st) != 0 || (size_t) snap_st.st_size < sizeof(SnapshotHeader)){
+        close(fd);
+        return 0;
+    }
+
+    size_t len = (size_t) snap_st.st_size;
+    const char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return 0;
+
+    // Validate header against the text file
+    const SnapshotHeader *header = (const SnapshotHeader *) data;
+    uint8_t valid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->version == SNAPSHOT_VERSION
+        && header->source_size == (uint64_t) data_st.st_size
+        && header->source_mtime_sec == data_st.st_mtim.tv_sec
+        && header->source_mtime_nsec == data_st.st_mtim.tv_nsec
+        && len == sizeof(SnapshotHeader) + (uint64_t) header->count * sizeof(SnapshotRecord) + header->heap_size;
+    if(!valid){
+        custom_log(LOG_DEBUG, "Snapshot is stale or invalid, parsing text.\n");
+        munmap((void *) data, len);
+        return 0;
+    }
+
+    const SnapshotRecord *table = (const SnapshotRecord *) (data + sizeof(SnapshotHeader));
+    const char *heap = (const char *) (table + header->count);
+    Receipt *tail = NULL;
+    uint8_t ok = 1;
+    reset_load_progress(header->count);
+
+    for(uint32_t i = 0; i < header->count; i++){
+        const SnapshotRecord *rec = &table[i];
+        if(i % PROGRESS_STRIDE == 0){
+            atomic_store(&load_progress.records, i);
+            atomic_store(&load_progress.done, i);
+        }
+        if((uint64_t) rec->name_off + rec->name_len > header->heap_size
+           || (uint64_t) rec->body_off + rec->body_len > header->heap_size){
+            custom_log(LOG_WARN, "Snapshot is corrupted, parsing text.\n");
+            free_list(*head);
+            *head = NULL;
+            munmap((void *) data, len);
+            return 0;
+        }
+
+        Receipt *node = node_alloc();
+        if(node == NULL){
+            custom_log(LOG_ERROR, "Memory allocation failed during load.\n");
+            ok = 0;
+            break;
+        }
+        set_receipt_name(node, heap + rec->name_off, rec->name_len);
+        node->body_len = rec->body_len;
+        node->body_off = (off_t) rec->text_off;
+        node->receipt = NULL;
+        if(!lazy_bodies){
+            node->receipt = body_alloc(heap + rec->body_off, rec->body_len);
+            if(node->receipt == NULL){
+                node_free(node);
+                custom_log(LOG_ERROR, "Memory allocation failed during load.\n");
+                ok = 0;
+                break;
+            }
+        }
+        node->id = rec->id;
+
+        // Table is in list order: append
+        node->next = NULL;
+        node->prev = tail;
+        if(tail != NULL) tail->next = node;
+        else *head = node;
+        tail = node;
+    }
+
+    if(!ok){
+        free_list(*head);
+        *head = NULL;
+        munmap((void *) data, len);
+        return 0;
+    }
+
+    char log_msg[LEN_LOG_MSG];
+    snprintf(log_msg, sizeof(log_msg), "%u receipt(s) loaded from snapshot!\n\n", header->count);
+    custom_log(LOG_INFO, log_msg);
+
+    munmap((void *) data, len);
+    if(lazy_bodies) open_body_source(data_path);
+    track_receipts_path(data_path, &data_st);
+    return 1;
+}
+
+/**
+ * @brief Creates a new receipt and adds it to the list
+ *
+ * Allocates memory for a new receipt, initializes it with the provided
+ * name and content, assigns a unique ID, inserts it alphabetically into
+ * the list, and saves it to file (when it reaches the disk depends on the
+ * durability policy, see save_receipt_to_file()).
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param name The name of the recipe (const char*)
+ * @param receipt The recipe content/instructions (const char*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *create_receipt(Receipt *head, const char *name, const char *receipt){
+    // Allocate memory
+    Receipt *new_receipt = node_alloc();
+    
+    // Check malloc
+    if(new_receipt == NULL){
+        char error_msg[LEN_LOG_MSG];
+        snprintf(error_msg, sizeof(error_msg), "Failed create new receipt %s.", name);
+        custom_log(LOG_ERROR, error_msg);
+        return head;
+    }
+
+    // Initialize memory
+    memset(new_receipt, 0, sizeof(Receipt));
+    set_receipt_name(new_receipt, name, strlen(name));
+    if(!set_receipt_body(new_receipt, receipt, strlen(receipt))){
+        custom_log(LOG_ERROR, "Memory allocation failed for receipt body.\n");
+        node_free(new_receipt);
+        return head;
+    }
+    new_receipt->id = get_new_id(head);
+
+    // Insert into the list
+    head = insert_alphabetically(head, new_receipt);
+
+    // File operation
+    if(!save_receipt_to_file(new_receipt)){
+        char error_msg[LEN_LOG_MSG];
+        snprintf(error_msg, sizeof(error_msg), "Failed to save receipt %s to the file.", new_receipt->name);
+        custom_log(LOG_ERROR, error_msg);
+    }
+    return head;
+}
+
+/**
+ * @brief Performs case-insensitive string comparison
+ *
+ * Compares two strings character by character, ignoring case differences.
+ * Returns the difference between the first mismatched characters, which
+ * orders names like memcmp() over their lowercased bytes.
+ *
+ * @param s1 First string to compare (const char*)
+ * @param s2 Second string to compare (const char*)
+ * @return int Negative if s1 < s2, 0 if equal, positive if s1 > s2
+ */
+int case_insensitive_compare(const char *s1, const char *s2){
+    while(*s1 && *s2){
+        if(tolower((unsigned char) *s1) != tolower((unsigned char) *s2)){
+            return (tolower((unsigned char) *s1) - tolower((unsigned char) *s2));
+        }
+        s1++;
+        s2++;
+    }
+    return tolower((unsigned char) *s1) - tolower((unsigned char) *s2);
+}
+
+/**
+ * @brief Inserts a receipt into the list in alphabetical order by name
+ *
+ * Links the node with link_alphabetically() and adds it to the ID index.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param new_receipt Pointer to the receipt to insert (Receipt*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *insert_alphabetically(Receipt *head, Receipt *new_receipt){
+    // Check the index against the list before the head can change
+    uint8_t indexed = id_index.valid && id_index.head == head && id_index_reserve(id_index.count + 1);
+
+    head = link_alphabetically(head, new_receipt);
+    if(indexed && id_index_insert(new_receipt)){
+        id_index.head = head;
+    }
+    else{
+        // Also on a taken ID: the next id_index_sync() renumbers the node
+        id_index_invalidate();
+    }
+    return head;
+}
+
+/**
+ * @brief Links a receipt into the list in alphabetical order by name
+ *
+ * Maintains a doubly-linked list sorted alphabetically (case-insensitive).
+ * The node is added to the ordered store (O(log n) comparisons, most of
+ * them without touching a node) and linked after the record the store puts
+ * before it; equal names are ordered by ID. If the store cannot take the
+ * node, falls back to walking the list from the head.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param new_receipt Pointer to the receipt to insert (Receipt*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *link_alphabetically(Receipt *head, Receipt *new_receipt){
+    // The store finds the position; the list supplies the other neighbour
+    Receipt *prev = NULL;
+    if(store_sync(head) && ordered_store->insert(new_receipt, &prev)){
+        new_receipt->prev = prev;
+        new_receipt->next = (prev != NULL) ? prev->next : head;
+        if(prev != NULL) prev->next = new_receipt;
+        else head = new_receipt;
+        if(new_receipt->next != NULL) new_receipt->next->prev = new_receipt;
+
+        store_head = head;
+        return head;
+    }
+    store_invalidate();
+
+    // Case 1: Empty list
+    if(head == NULL){
+        new_receipt->next = NULL;
+        new_receipt->prev = NULL;
+        return new_receipt;
+    }
+    
+    // Case 2: New node goes at first position (head)
+    if(compare_name_keys(new_receipt->name_key, new_receipt->folded, head->name_key, head->folded) < 0){
+        new_receipt->prev = NULL;
+        new_receipt->next = head;
+        head->prev = new_receipt;
+        return new_receipt; // New node is now the head
+    }
+
+    // Case 3: Middle or end
+    Receipt *current = head;
+    while(current->next != NULL
+          && compare_name_keys(current->next->name_key, current->next->folded, new_receipt->name_key, new_receipt->folded) < 0){
+        current = current->next;
+    }
+    
+    // Insert new_receipt after current and before the current->next
+    new_receipt->prev = current;
+    new_receipt->next = current->next;
+
+    // Check if current->next exists
+    if(current->next != NULL){
+        current->next->prev = new_receipt;
+    }
+    current->next = new_receipt;
+
+    return head;
+}
+
+/**
+ * @brief Detaches a receipt node from the linked list
+ *
+ * Removes a node from the doubly-linked list by updating neighboring
+ * nodes' pointers, and from the ordered store and ID index. Does not free the node's
+ * memory. Handles edge cases for head, tail, and middle nodes.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param node Pointer to the node to detach (Receipt*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *detach_receipt(Receipt *head, Receipt *node){
+    if(head == NULL || node == NULL) return head;
+
+    // 0. Drop the node from the ordered store (by its current name) and the ID index
+    uint8_t in_index = id_index.valid && id_index.head == head && id_index_remove(node);
+    uint8_t in_store = store_valid && store_head == head && ordered_store->remove(node);
+
+    // 1. Deataching the head
+    if(head == node){
+        head = node->next;
+    }
+
+    // 2. Update NEXT node's 'prev' pointer
+    if(node->next != NULL){
+        node->next->prev = node->prev;
+    }
+
+    // 3. Update PREV node's 'next' pointer
+    if(node->prev != NULL){
+        node->prev->next = node->next;
+    }
+
+    // 4. Cleanup node links
+    node->next = NULL;
+    node->prev = NULL;
+
+    if(in_store) store_head = head;
+    else store_invalidate();
+    if(in_index) id_index.head = head;
+    else id_index_invalidate();
+    return head;
+}
+
+/**
+ * @brief Updates an existing receipt's name and/or content
+ *
+ * Searches for a receipt by ID and updates its fields. If the name changes,
+ * the receipt is detached and re-inserted to maintain alphabetical order.
+ * A new body that fits the old one's place is patched into the file in
+ * place (see patch_receipt()); any other change is persisted by appending
+ * the receipt to the journal, or by rewriting the file if that fails. An
+ * update that changes nothing (empty fields, the same name and body, or a
+ * body that could not be stored) writes nothing and leaves no dead bytes.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id The ID of the receipt to update (uint32_t)
+ * @param name New name for the recipe, or NULL/empty to keep current (const char*)
+ * @param receipt New content, or NULL/empty to keep current (const char*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *update_receipt(Receipt *head, uint32_t receipt_id, const char *name, const char *receipt){
+    if(name == NULL && receipt == NULL){
+        custom_log(LOG_INFO, "No changes were made.\n");
+        return head;
+    }
+
+    char msg[LEN_LOG_MSG];
+    snprintf(msg, sizeof(msg), "Searching for ID: %u...\n", receipt_id);
+    custom_log(LOG_DEBUG, msg);
+
+    // A pending new receipt goes to the file as it was created, before it changes
+    append_flush();
+
+    Receipt *current = find_receipt(head, receipt_id);
+    if(current == NULL){
+        custom_log(LOG_WARN, "Receipt ID not found.\n");
+        return head;
+    }
+
+    uint64_t old_bytes = record_bytes(current);
+    uint16_t name_changed = 0;
+    uint8_t body_changed = 0;
+    uint8_t patched = 0;
+
+    // Update name
+    if(name != NULL && name[0] != '\0'){
+        if(strcmp(name, current->name) != 0){
+            // Take the node out while the ordered store can still find it by name
+            head = detach_receipt(head, current);
+            set_receipt_name(current, name, strlen(name));  // Refreshes the sort key too
+            name_changed = 1;
+        }
+    }
+
+    // Update receipt: in place when only the body changes and it fits
+    if(receipt != NULL && receipt[0] != '\0'){
+        size_t len = strlen(receipt);
+        const char *old_body = receipt_body(current);
+        if(old_body != NULL && len == current->body_len && memcmp(old_body, receipt, len) == 0){
+            // Same body: nothing to write
+        }
+        else if(!name_changed && patch_receipt(current, receipt, len)){
+            patched = 1;
+            body_changed = 1;
+        }
+        else{
+            if(!name_changed) patch_totals.relocated++;
+            if(set_receipt_body(current, receipt, len)){
+                body_changed = 1;
+            }
+            else{
+                custom_log(LOG_ERROR, "Memory allocation failed for receipt body.\n");
+            }
+        }
+    }
+
+    if(name_changed){
+        head = insert_alphabetically(head, current);
+        custom_log(LOG_INFO, "Receipt updated and re-sorted.\n");
+    }
+    else if(body_changed){
+        custom_log(LOG_INFO, "Receipt updated (order unchanged).\n");
+    }
+    else{
+        custom_log(LOG_INFO, "No changes were made.\n");
+        return head;
+    }
+    if(!patched){
+        // The previous version of the record is dead from now on
+        if(journal_append(receipts_path, JOURNAL_UPSERT, current)){
+            compaction.dead_bytes += old_bytes;
+            current->journaled = 1;
+        }
+        else{
+            custom_log(LOG_WARN, "Could not write journal, rewriting file.\n");
+            rewrite_receipts_to_file(head);
+        }
+    }
+    return head;
+}
+
+/**
+ * @brief Deletes a receipt from the list by ID
+ *
+ * Searches for a receipt with the given ID, detaches it from the list,
+ * frees its memory, and persists the deletion with a journal record, or by
+ * rewriting the file if that fails.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id The ID of the receipt to delete (uint32_t)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *delete_receipt(Receipt *head, uint32_t receipt_id){
+    if(head == NULL){
+        custom_log(LOG_WARN, "List is empty, nothing to delete.\n");
+        return NULL;
+    }
+
+    Receipt *current = find_receipt(head, receipt_id);
+    if(current == NULL){
+        char msg[LEN_LOG_MSG];
+        snprintf(msg, sizeof(msg), "Receipt ID %u not found.\n", receipt_id);
+        custom_log(LOG_WARN, msg);
+        return head;
+    }
+
+    // Unlink from neighbors
+    head = detach_receipt(head, current);
+
+    // Update file: the record and the DELETE record are both dead
+    if(journal_append(receipts_path, JOURNAL_DELETE, current)){
+        compaction.dead_bytes += record_bytes(current) + sizeof(JournalRecord);
+    }
+    else{
+        custom_log(LOG_WARN, "Could not write journal, rewriting file.\n");
+        rewrite_receipts_to_file(head);
+    }
+
+    // Cleanup node
+    body_cache_forget(current);
+    body_release(current->receipt);
+    node_free(current);
+
+    return head;
+}
+
+/**
+ * @brief Finds a receipt by ID
+ *
+ * Looks the ID up in the ID index in O(1) and resolves the handle it
+ * holds; if the index cannot be built, walks the list instead.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id ID to look for (uint32_t)
+ * @return Receipt* The matching receipt, or NULL if there is none
+ */
+Receipt *find_receipt(Receipt *head, uint32_t receipt_id){
+    if(id_index_sync(head)) return receipt_get(id_index_find(receipt_id));
+    return find_receipt_linear(head, receipt_id);
+}
+
+/**
+ * @brief Finds the handle of a receipt by ID
+ *
+ * For callers that keep a reference to a receipt across operations: the
+ * handle is resolved with receipt_get() on every use, which returns NULL
+ * once the receipt has been deleted.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id ID to look for (uint32_t)
+ * @return ReceiptHandle The receipt's handle, or a zero handle if there is none
+ */
+ReceiptHandle find_receipt_handle(Receipt *head, uint32_t receipt_id){
+    if(id_index_sync(head)) return id_index_find(receipt_id);
+    ReceiptHandle none = {0, 0};
+    Receipt *node = find_receipt_linear(head, receipt_id);
+    return (node != NULL) ? receipt_handle(node) : none;
+}
+
+/**
+ * @brief Finds a receipt by ID by walking the list
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id ID to look for (uint32_t)
+ * @return Receipt* The first matching receipt, or NULL if there is none
+ */
+Receipt *find_receipt_linear(Receipt *head, uint32_t receipt_id){
+    Receipt *current = head;
+    while(current != NULL){
+        if(current->id == receipt_id) return current;
+        current = current->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the first receipt with a name, ignoring case
+ *
+ * Folds the name once, then searches the ordered store's hot records
+ * (O(log n)). If the store cannot be built, walks the sorted list and
+ * stops at the first name past the target. Names are compared up to the
+ * LEN_NAME-1 bytes a receipt keeps.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param name Name to look for (const char*)
+ * @return Receipt* The matching receipt, or NULL if there is none
+ */
+Receipt *find_receipt_by_name(Receipt *head, const char *name){
+    char folded[LEN_NAME];
+    fold_name(folded, name);
+    uint64_t key = name_key(folded);
+
+    if(store_sync(head)) return ordered_store->find_name(key, folded);
+
+    Receipt *current = head;
+    while(current != NULL){
+        int cmp = compare_name_keys(current->name_key, current->folded, key, folded);
+        if(cmp == 0) return current;
+        if(cmp > 0) break;
+        current = current->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Hash slot of an ID in the ID index
+ *
+ * Fibonacci hashing: sequential IDs spread evenly over the table.
+ *
+ * @param id Receipt ID (uint32_t)
+ * @return size_t Home slot, below id_index.capacity
+ */
+size_t id_index_slot(uint32_t id){
+    return (size_t) (((uint64_t) id * 0x9e3779b97f4a7c15ull) >> 32) & (id_index.capacity - 1);
+}
+
+/**
+ * @brief Makes the ID index describe the list starting at head
+ *
+ * Like name_table_sync(): the index is kept current by
+ * insert_alphabetically() and detach_receipt(), and rebuilt here in one
+ * O(n) pass for any other list, which also issues a handle to every node.
+ * The rebuild also keeps IDs unique: a node whose ID is already taken (a
+ * hand-edited file, say) gets a fresh one. Being the highest ID, it moves
+ * the node behind any others of the same name, in the list and the
+ * ordered store. The text file still has the old ID, which a later load
+ * would renumber again (and not necessarily the same way), so a renumbered
+ * node makes a compaction due (see compaction_due()), which writes the new
+ * IDs out and retires any journal records made in between.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if the index matches the list, 0 on allocation failure
+ */
+uint8_t id_index_sync(Receipt *head){
+    if(id_index.valid && id_index.head == head) return 1;
+
+    // Empty the slots first: they may hold handles of nodes that are gone
+    id_index.valid = 0;
+    id_index.count = 0;
+    if(id_index.slots != NULL) memset(id_index.slots, 0, id_index.capacity * sizeof(IdIndexEntry));
+
+    size_t count = 0;
+    for(Receipt *current = head; current != NULL; current = current->next){
+        if(receipt_handle(current).slot == 0) return 0;
+        count++;
+    }
+    if(!id_index_reserve(count)) return 0;
+    Receipt *next;
+    for(Receipt *current = head; current != NULL; current = next){
+        next = current->next;
+        if(id_index_insert(current)) continue;
+        if(receipt_get(id_index_find(current->id)) == current) continue;  // Renumbered and moved past this point
+
+        char msg[LEN_LOG_MSG];
+        snprintf(msg, sizeof(msg), "Duplicate receipt ID %u, renumbering it.\n", current->id);
+        custom_log(LOG_WARN, msg);
+
+        // The store finds records by name and ID: take the node out under its old ID
+        uint8_t in_store = store_valid && store_head == head && ordered_store->remove(current);
+        current->id = get_new_id(head);
+        renumber_relink(current);
+        Receipt *prev;
+        if(!in_store || !ordered_store->insert(current, &prev)) store_invalidate();
+        id_index_insert(current);
+        compaction.renumbered++;
+    }
+    id_index.head = head;
+    id_index.valid = 1;
+    return 1;
+}
+
+/**
+ * @brief Moves a renumbered node behind the other records of its name
+ *
+ * Equal names are ordered by ID, and a renumbered node has the highest
+ * one. The node is never the head: the record that keeps its old ID is
+ * ahead of it.
+ *
+ * @param node Node whose ID was just raised (Receipt*)
+ */
+void renumber_relink(Receipt *node){
+    Receipt *after = node;
+    while(after->next != NULL
+          && compare_name_keys(after->next->name_key, after->next->folded, node->name_key, node->folded) == 0
+          && after->next->id < node->id){
+        after = after->next;
+    }
+    if(after == node || node->prev == NULL) return;
+
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = after;
+    node->next = after->next;
+    if(after->next != NULL) after->next->prev = node;
+    after->next = node;
+}
+
+/**
+ * @brief Marks the ID index as not describing any list
+ */
+void id_index_invalidate(){
+    id_index.valid = 0;
+    id_index.head = NULL;
+}
+
+/**
+ * @brief Releases the ID index's storage
+ */
+void id_index_clear(){
+    free(id_index.slots);
+    memset(&id_index, 0, sizeof(id_index));
+}
+
+/**
+ * @brief Makes sure the ID index can hold count entries
+ *
+ * Keeps the load factor at or below 1/2 by doubling the power-of-two
+ * capacity; existing entries are rehashed into the new slots.
+ *
+ * @param count Number of entries the index must hold (size_t)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t id_index_reserve(size_t count){
+    if(id_index.slots != NULL && count * 2 <= id_index.capacity) return 1;
+
+    size_t capacity = ID_INDEX_INITIAL;
+    while(capacity < count * 2) capacity *= 2;
+    IdIndexEntry *slots = calloc(capacity, sizeof(IdIndexEntry));
+    if(slots == NULL) return 0;
+
+    IdIndexEntry *old_slots = id_index.slots;
+    size_t old_capacity = id_index.capacity;
+    size_t mask = capacity - 1;
+    id_index.slots = slots;
+    id_index.capacity = capacity;
+    for(size_t i = 0; i < old_capacity; i++){
+        if(old_slots[i].handle.slot == 0) continue;
+        size_t slot = id_index_slot(old_slots[i].id);
+        while(slots[slot].handle.slot != 0) slot = (slot + 1) & mask;
+        slots[slot] = old_slots[i];
+    }
+    free(old_slots);
+    return 1;
+}
+
+/**
+ * @brief Adds a node to the ID index
+ *
+ * The caller must have reserved room (see id_index_reserve()). The entry
+ * holds the node's handle, which is issued here if the node has none yet.
+ *
+ * @param node Node to add (Receipt*)
+ * @return uint8_t 1 if added, 0 if another node already has its ID or no handle could be issued (node is not added)
+ */
+uint8_t id_index_insert(Receipt *node){
+    ReceiptHandle handle = receipt_handle(node);
+    if(handle.slot == 0) return 0;
+
+    size_t mask = id_index.capacity - 1;
+    size_t slot = id_index_slot(node->id);
+    while(id_index.slots[slot].handle.slot != 0){
+        if(id_index.slots[slot].id == node->id) return 0;
+        slot = (slot + 1) & mask;
+    }
+    id_index.slots[slot].id = node->id;
+    id_index.slots[slot].handle = handle;
+    id_index.count++;
+    return 1;
+}
+
+/**
+ * @brief Removes a node from the ID index
+ *
+ * Uses backward-shift deletion, so no tombstones are left behind and
+ * probe sequences stay short.
+ *
+ * @param node Node to remove (const Receipt*)
+ * @return uint8_t 1 if the node was in the index, 0 otherwise
+ */
+uint8_t id_index_remove(const Receipt *node){
+    if(id_index.slots == NULL || node->slot == 0) return 0;
+
+    size_t mask = id_index.capacity - 1;
+    size_t slot = id_index_slot(node->id);
+    while(id_index.slots[slot].handle.slot != node->slot){
+        if(id_index.slots[slot].handle.slot == 0) return 0;
+        slot = (slot + 1) & mask;
+    }
+
+    // Pull later entries of the probe run back into the hole
+    size_t hole = slot;
+    for(size_t next = (hole + 1) & mask; id_index.slots[next].handle.slot != 0; next = (next + 1) & mask){
+        size_t home = id_index_slot(id_index.slots[next].id);
+        if(((next - home) & mask) >= ((next - hole) & mask)){
+            id_index.slots[hole] = id_index.slots[next];
+            hole = next;
+        }
+    }
+    memset(&id_index.slots[hole], 0, sizeof(IdIndexEntry));
+    id_index.count--;
+    return 1;
+}
+
+/**
+ * @brief Looks up an ID in the ID index
+ *
+ * Probes compare the IDs stored in the index, without reading any node.
+ *
+ * @param receipt_id ID to look for (uint32_t)
+ * @return ReceiptHandle Handle of the matching receipt, or a zero handle if there is none
+ */
+ReceiptHandle id_index_find(uint32_t receipt_id){
+    size_t mask = id_index.capacity - 1;
+    size_t slot = id_index_slot(receipt_id);
+    for(; id_index.slots[slot].handle.slot != 0; slot = (slot + 1) & mask){
+        if(id_index.slots[slot].id == receipt_id) break;
+    }
+    return id_index.slots[slot].handle;
+}
+
+/**
+ * @brief Lowercases a name into a null-padded buffer
+ *
+ * @param folded Output buffer of LEN_NAME bytes (char*)
+ * @param name Name to fold; only its first LEN_NAME-1 bytes are used (const char*)
+ */
+void fold_name(char *folded, const char *name){
+    size_t i = 0;
+    for(; i < LEN_NAME-1 && name[i] != '\0'; i++) folded[i] = (char) tolower((unsigned char) name[i]);
+    memset(folded + i, 0, LEN_NAME - i);
+}
+
+/**
+ * @brief Packs the first 8 bytes of a folded name into a sort key
+ *
+ * Big-endian, so comparing two keys as integers orders them like
+ * comparing the bytes with memcmp().
+ *
+ * @param folded Name from fold_name() (const char*)
+ * @return uint64_t Sort key
+ */
+uint64_t name_key(const char *folded){
+    uint64_t key = 0;
+    for(size_t i = 0; i < NAME_KEY_BYTES; i++) key = (key << 8) | (unsigned char) folded[i];
+    return key;
+}
+
+/**
+ * @brief Sets the name of a receipt along with its folded form and sort key
+ *
+ * Every write of a node's name goes through here, so the precomputed keys
+ * never go stale.
+ *
+ * @param r Receipt to name (Receipt*)
+ * @param name Name bytes, not necessarily null-terminated (const char*)
+ * @param len Length of name; cut to LEN_NAME-1 (size_t)
+ */
+void set_receipt_name(Receipt *r, const char *name, size_t len){
+    if(len > LEN_NAME-1) len = LEN_NAME-1;
+    memcpy(r->name, name, len);
+    r->name[len] = '\0';
+    fold_name(r->folded, r->name);
+    r->name_key = name_key(r->folded);
+}
+
+/**
+ * @brief Compares two names by their sort keys, ignoring case
+ *
+ * Decided by one integer comparison unless the keys are equal; then the
+ * folded names are compared past the key, unless the key already held the
+ * whole name.
+ *
+ * @param key_a Sort key of the first name (uint64_t)
+ * @param folded_a First folded name (const char*)
+ * @param key_b Sort key of the second name (uint64_t)
+ * @param folded_b Second folded name (const char*)
+ * @return int Negative, zero or positive like case_insensitive_compare()
+ */
+int compare_name_keys(uint64_t key_a, const char *folded_a, uint64_t key_b, const char *folded_b){
+    if(key_a != key_b) return (key_a < key_b) ? -1 : 1;
+    // A key ending in a null byte holds the whole name
+    if((key_a & 0xff) == 0) return 0;
+    return strcmp(folded_a + NAME_KEY_BYTES, folded_b + NAME_KEY_BYTES);
+}
+
+/**
+ * @brief Fills a hot record from its node
+ *
+ * @param rec Record to fill (HotRecord*)
+ * @param node Node the record stands for (Receipt*)
+ */
+void hot_record_set(HotRecord *rec, Receipt *node){
+    rec->node = node;
+    rec->key = node->name_key;
+    rec->id = node->id;
+}
+
+/**
+ * @brief Compares a hot record's name with a folded name
+ *
+ * Only reads the record's node when the sort keys are equal.
+ *
+ * @param rec Record to compare (const HotRecord*)
+ * @param key name_key() of folded (uint64_t)
+ * @param folded Folded name to compare against (const char*)
+ * @return int Negative, zero or positive like case_insensitive_compare()
+ */
+int hot_compare_name(const HotRecord *rec, uint64_t key, const char *folded){
+    return compare_name_keys(rec->key, rec->node->folded, key, folded);
+}
+
+/**
+ * @brief Compares a hot record with a node in list order (name, then ID)
+ *
+ * @param rec Record to compare (const HotRecord*)
+ * @param node Node to compare against (const Receipt*)
+ * @return int Negative, zero or positive as rec orders before, with or after node
+ */
+int hot_compare_receipt(const HotRecord *rec, const Receipt *node){
+    int cmp = hot_compare_name(rec, node->name_key, node->folded);
+    if(cmp == 0) cmp = (rec->id > node->id) - (rec->id < node->id);
+    return cmp;
+}
+
+/**
+ * @brief Makes the name table describe the list starting at head
+ *
+ * While the list store is selected, the table is kept up to date by
+ * insert_alphabetically() and detach_receipt(); for any other list (a
+ * fresh load, a merge, a list built by a benchmark) it is rebuilt here in
+ * one O(n) walk.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if the table matches the list, 0 on allocation failure
+ */
+uint8_t name_table_sync(Receipt *head){
+    if(name_table.valid && name_table.head == head) return 1;
+
+    name_table.valid = 0;
+    name_table.count = 0;
+    for(Receipt *current = head; current != NULL; current = current->next){
+        if(!name_table_reserve(name_table.count + 1)) return 0;
+        hot_record_set(&name_table.items[name_table.count++], current);
+    }
+    name_table.head = head;
+    name_table.valid = 1;
+    return 1;
+}
+
+/**
+ * @brief Makes sure the name table can hold count records
+ *
+ * Grows the array geometrically so that appending is amortized O(1).
+ *
+ * @param count Number of records the table must hold (size_t)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t name_table_reserve(size_t count){
+    if(count <= name_table.capacity) return 1;
+
+    size_t capacity = name_table.capacity ? name_table.capacity * 2 : LOAD_BATCH_INITIAL;
+    while(capacity < count) capacity *= 2;
+    HotRecord *items = realloc(name_table.items, capacity * sizeof(HotRecord));
+    if(items == NULL) return 0;
+    name_table.items = items;
+    name_table.capacity = capacity;
+    return 1;
+}
+
+/**
+ * @brief Marks the name table as not describing any list
+ */
+void name_table_invalidate(){
+    name_table.valid = 0;
+    name_table.head = NULL;
+}
+
+/**
+ * @brief Releases the name table's storage
+ */
+void name_table_clear(){
+    free(name_table.items);
+    memset(&name_table, 0, sizeof(name_table));
+}
+
+/**
+ * @brief Binary search for the first table entry ordered after a node
+ *
+ * Orders like compare_receipts() (name, then ID), so a node is placed
+ * after every receipt with the same name and a lower ID.
+ *
+ * @param node Node to position (const Receipt*)
+ * @return size_t Index of the first entry greater than node
+ */
+size_t name_table_upper_bound(const Receipt *node){
+    size_t lo = 0, hi = name_table.count;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(hot_compare_receipt(&name_table.items[mid], node) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Binary search for the first table entry whose name is not below a folded name
+ *
+ * @param key name_key() of folded (uint64_t)
+ * @param folded Name to look for, from fold_name() (const char*)
+ * @return size_t Index of the first entry with a name >= folded (ignoring case)
+ */
+size_t name_table_lower_bound(uint64_t key, const char *folded){
+    size_t lo = 0, hi = name_table.count;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(hot_compare_name(&name_table.items[mid], key, folded) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Finds the table index of a node
+ *
+ * Binary searches the node's name, then scans the run of equal names for
+ * the node itself, so a list whose equal names are not in ID order (an old
+ * snapshot, say) is handled as well.
+ *
+ * @param node Node to look for (const Receipt*)
+ * @return size_t Index of node, or the table size if it is not in the table
+ */
+size_t name_table_position(const Receipt *node){
+    size_t count = name_table.count;
+    for(size_t i = name_table_lower_bound(node->name_key, node->folded); i < count; i++){
+        if(name_table.items[i].node == node) return i;
+        if(hot_compare_name(&name_table.items[i], node->name_key, node->folded) != 0) break;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the receipt at a position in list order
+ *
+ * The ordered store counts the records under each of its nodes, so this is
+ * an array read with the list store's name table and an O(log n) descent
+ * with the B+tree; without a store the list is walked.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param rank Zero-based position in alphabetical order (size_t)
+ * @return Receipt* The receipt at that position, or NULL past the end
+ */
+Receipt *select_receipt(Receipt *head, size_t rank){
+    StoreRun run;
+    if(store_sync(head)){
+        return ordered_store->seek(rank, &run) ? run.items[0].node : NULL;
+    }
+    Receipt *current = head;
+    while(current != NULL && rank > 0){
+        current = current->next;
+        rank--;
+    }
+    return current;
+}
+
+/**
+ * @brief Finds the position of a receipt in list order
+ *
+ * Looks the ID up in the ID index, then searches the node's name in the
+ * ordered store: O(log n) instead of a walk that counts nodes from the head.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id ID of the receipt (uint32_t)
+ * @param rank Receives the zero-based position (size_t*)
+ * @return uint8_t 1 on success, 0 if no receipt has that ID
+ */
+uint8_t receipt_rank(Receipt *head, uint32_t receipt_id, size_t *rank){
+    Receipt *node = find_receipt(head, receipt_id);
+    if(node == NULL) return 0;
+
+    if(store_sync(head)){
+        size_t pos = ordered_store->rank(node);
+        if(pos < ordered_store->count()){
+            *rank = pos;
+            return 1;
+        }
+    }
+    size_t i = 0;
+    for(Receipt *current = head; current != NULL; current = current->next, i++){
+        if(current == node){
+            *rank = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Selects the ordered store behind the list
+ *
+ * The B+tree is the default; the list store (the sorted name table next to
+ * the list) is kept for comparison. The previous store's storage is
+ * released and the new one is built from the list on first use.
+ *
+ * @param name "btree" or "list" (const char*)
+ * @return uint8_t 1 if the store was selected, 0 for an unknown name
+ */
+uint8_t select_ordered_store(const char *name){
+    const OrderedStore *chosen = NULL;
+    if(strcmp(name, btree_store.name) == 0) chosen = &btree_store;
+    else if(strcmp(name, list_store.name) == 0) chosen = &list_store;
+    if(chosen == NULL) return 0;
+
+    if(chosen != ordered_store) store_clear();
+    ordered_store = chosen;
+    return 1;
+}
+
+/**
+ * @brief Makes the ordered store describe the list starting at head
+ *
+ * insert_alphabetically() and detach_receipt() keep the store current; any
+ * other list (a fresh load, a merge, a list built by a benchmark) is picked
+ * up here by rebuilding the store in one O(n) pass.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if the store matches the list, 0 on allocation failure
+ */
+uint8_t store_sync(Receipt *head){
+    if(store_valid && store_head == head) return 1;
+
+    store_valid = 0;
+    if(!ordered_store->build(head)) return 0;
+    store_head = head;
+    store_valid = 1;
+    return 1;
+}
+
+/**
+ * @brief Marks the ordered store as not describing any list
+ */
+void store_invalidate(){
+    store_valid = 0;
+    store_head = NULL;
+}
+
+/**
+ * @brief Releases the storage of every ordered store
+ */
+void store_clear(){
+    btree_store.clear();
+    list_store.clear();
+    store_invalidate();
+}
+
+/**
+ * @brief Rebuilds the name table for the list store
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t list_store_build(Receipt *head){
+    name_table_invalidate();
+    return name_table_sync(head);
+}
+
+/**
+ * @brief Inserts a node into the name table
+ *
+ * Binary searches the position (see name_table_upper_bound()) and moves
+ * the records after it up by one: O(log n) comparisons, O(n) moves.
+ *
+ * @param node Node to insert (Receipt*)
+ * @param prev Receives the record before node, NULL if it goes first (Receipt**)
+ * @return uint8_t 1 on success, 0 if the table cannot grow
+ */
+uint8_t list_store_insert(Receipt *node, Receipt **prev){
+    if(!name_table_reserve(name_table.count + 1)) return 0;
+
+    HotRecord *items = name_table.items;
+    size_t pos = name_table_upper_bound(node);
+    memmove(&items[pos+1], &items[pos], (name_table.count - pos) * sizeof(HotRecord));
+    hot_record_set(&items[pos], node);
+    name_table.count++;
+    *prev = (pos > 0) ? items[pos-1].node : NULL;
+    return 1;
+}
+
+/**
+ * @brief Removes a node from the name table
+ *
+ * @param node Node to remove, under its current name (const Receipt*)
+ * @return uint8_t 1 if the node was in the table, 0 otherwise
+ */
+uint8_t list_store_remove(const Receipt *node){
+    size_t pos = name_table_position(node);
+    if(pos >= name_table.count) return 0;
+    memmove(&name_table.items[pos], &name_table.items[pos+1], (name_table.count - pos - 1) * sizeof(HotRecord));
+    name_table.count--;
+    return 1;
+}
+
+/**
+ * @brief Binary searches the name table for a name
+ *
+ * @param key name_key() of folded (uint64_t)
+ * @param folded Name to look for, from fold_name() (const char*)
+ * @return Receipt* The first receipt with that name, or NULL
+ */
+Receipt *list_store_find_name(uint64_t key, const char *folded){
+    size_t pos = name_table_lower_bound(key, folded);
+    if(pos < name_table.count && hot_compare_name(&name_table.items[pos], key, folded) == 0){
+        return name_table.items[pos].node;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Position of a node in the name table
+ *
+ * @param node Node to look for (const Receipt*)
+ * @return size_t Its index, or the table size if it is not in the table
+ */
+size_t list_store_rank(const Receipt *node){
+    return name_table_position(node);
+}
+
+/**
+ * @brief Hands out the name table from a position on as a single run
+ *
+ * @param rank Position of the first record (size_t)
+ * @param run Receives the records (StoreRun*)
+ * @return uint8_t 1 on success, 0 if rank is past the end
+ */
+uint8_t list_store_seek(size_t rank, StoreRun *run){
+    if(rank >= name_table.count) return 0;
+    run->items = &name_table.items[rank];
+    run->count = name_table.count - rank;
+    run->cursor = NULL;
+    return 1;
+}
+
+/**
+ * @brief Run after a list store run: there is none, the first one holds the rest of the table
+ *
+ * @param run Run to advance (StoreRun*)
+ * @return uint8_t Always 0
+ */
+uint8_t list_store_next(StoreRun *run){
+    (void) run;
+    return 0;
+}
+
+/**
+ * @brief Number of records in the name table
+ *
+ * @return size_t Record count
+ */
+size_t list_store_count(){
+    return name_table.count;
+}
+
+/**
+ * @brief Takes a node for the B+tree
+ *
+ * Reuses a spare node when there is one. The caller fills in every field.
+ *
+ * @return void* A BTREE_NODE_SIZE-aligned node, or NULL on allocation failure
+ */
+void *btree_node_new(){
+    void *node = btree.spare;
+    if(node != NULL){
+        btree.spare = *(void **) node;
+        btree.spare_count--;
+    }
+    else{
+        node = aligned_alloc(BTREE_NODE_SIZE, BTREE_NODE_SIZE);
+        if(node == NULL) return NULL;
+    }
+    btree.nodes++;
+    return node;
+}
+
+/**
+ * @brief Gives a node that left the B+tree back
+ *
+ * Up to BTREE_SPARE_MAX nodes are kept for the next splits, the rest are freed.
+ *
+ * @param node Leaf or inner node (void*)
+ */
+void btree_node_release(void *node){
+    btree.nodes--;
+    if(btree.spare_count >= BTREE_SPARE_MAX){
+        free(node);
+        return;
+    }
+    *(void **) node = btree.spare;
+    btree.spare = node;
+    btree.spare_count++;
+}
+
+/**
+ * @brief Makes sure the next nodes btree_node_new() hands out are already allocated
+ *
+ * An insert takes at most one node per level plus a new root; reserving
+ * them up front means a split never fails halfway through.
+ *
+ * @param nodes Number of nodes needed (size_t)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t btree_reserve(size_t nodes){
+    while(btree.spare_count < nodes){
+        void *node = aligned_alloc(BTREE_NODE_SIZE, BTREE_NODE_SIZE);
+        if(node == NULL) return 0;
+        *(void **) node = btree.spare;
+        btree.spare = node;
+        btree.spare_count++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Frees a B+tree node and everything below it
+ *
+ * @param node Leaf or inner node (void*)
+ * @param height Inner levels below and including node, 0 for a leaf (uint32_t)
+ */
+void btree_free(void *node, uint32_t height){
+    if(height > 0){
+        BTreeInner *inner = node;
+        for(uint32_t i = 0; i < inner->count; i++) btree_free(inner->children[i], height - 1);
+    }
+    free(node);
+}
+
+/**
+ * @brief Releases the B+tree's nodes, spares included
+ */
+void btree_clear(){
+    if(btree.root != NULL) btree_free(btree.root, btree.height);
+    while(btree.spare != NULL){
+        void *node = btree.spare;
+        btree.spare = *(void **) node;
+        free(node);
+    }
+    memset(&btree, 0, sizeof(btree));
+}
+
+/**
+ * @brief Recomputes what an inner node knows about one of its children
+ *
+ * @param inner Parent node (BTreeInner*)
+ * @param i Index of the child (uint32_t)
+ * @param child_height Height of the child, 0 for a leaf (uint32_t)
+ */
+void btree_refresh(BTreeInner *inner, uint32_t i, uint32_t child_height){
+    if(child_height == 0){
+        const BTreeLeaf *leaf = inner->children[i];
+        inner->sizes[i] = leaf->count;
+        inner->lows[i] = leaf->items[0];
+        return;
+    }
+    const BTreeInner *child = inner->children[i];
+    uint32_t size = 0;
+    for(uint32_t k = 0; k < child->count; k++) size += child->sizes[k];
+    inner->sizes[i] = size;
+    inner->lows[i] = child->lows[0];
+}
+
+/**
+ * @brief Sets the children of an inner node
+ *
+ * @param inner Node to fill (BTreeInner*)
+ * @param children Children in order (void* const*)
+ * @param count Number of children, at most BTREE_FANOUT (uint32_t)
+ * @param child_height Height of the children, 0 for leaves (uint32_t)
+ */
+void btree_fill(BTreeInner *inner, void *const *children, uint32_t count, uint32_t child_height){
+    inner->count = count;
+    for(uint32_t i = 0; i < count; i++){
+        inner->children[i] = children[i];
+        btree_refresh(inner, i, child_height);
+    }
+}
+
+/**
+ * @brief Rebuilds the B+tree from a sorted list
+ *
+ * Bulk load in O(n): the records are spread evenly over just enough leaves,
+ * and each inner level is built over the one below in the same way, so
+ * every node starts at least half full.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 on success, 0 on allocation failure (the tree is left empty)
+ */
+uint8_t btree_build(Receipt *head){
+    btree_clear();
+
+    size_t count = 0;
+    for(Receipt *current = head; current != NULL; current = current->next) count++;
+    if(count == 0) return 1;
+
+    size_t width = (count + BTREE_LEAF_SLOTS - 1) / BTREE_LEAF_SLOTS;
+    void **level = malloc(width * sizeof(void*));
+    if(level == NULL) return 0;
+
+    // Leaves, linked in order
+    Receipt *current = head;
+    BTreeLeaf *prev = NULL;
+    for(size_t i = 0; i < width; i++){
+        BTreeLeaf *leaf = btree_node_new();
+        if(leaf == NULL){
+            for(size_t k = 0; k < i; k++) free(level[k]);
+            free(level);
+            btree_clear();
+            return 0;
+        }
+        leaf->next = NULL;
+        leaf->count = (uint32_t) (count * (i + 1) / width - count * i / width);
+        for(uint32_t k = 0; k < leaf->count; k++){
+            hot_record_set(&leaf->items[k], current);
+            current = current->next;
+        }
+        if(prev != NULL) prev->next = leaf;
+        prev = leaf;
+        level[i] = leaf;
+    }
+
+    // Inner levels, bottom up; each parent takes the slot of its first child
+    uint32_t height = 0;
+    while(width > 1){
+        size_t parents = (width + BTREE_FANOUT - 1) / BTREE_FANOUT;
+        for(size_t p = 0; p < parents; p++){
+            size_t first = width * p / parents;
+            size_t last = width * (p + 1) / parents;
+            BTreeInner *inner = btree_node_new();
+            if(inner == NULL){
+                for(size_t k = 0; k < p; k++) btree_free(level[k], height + 1);
+                for(size_t k = first; k < width; k++) btree_free(level[k], height);
+                free(level);
+                btree_clear();
+                return 0;
+            }
+            btree_fill(inner, &level[first], (uint32_t) (last - first), height);
+            level[p] = inner;
+        }
+        width = parents;
+        height++;
+    }
+
+    btree.root = level[0];
+    btree.height = height;
+    btree.count = count;
+    free(level);
+    return 1;
+}
+
+/**
+ * @brief Inserts a node below a B+tree node
+ *
+ * Descends into the last child whose first record orders at or before the
+ * node, so the node lands after every record with the same name and a
+ * lower ID, like name_table_upper_bound(). A full node is split in two
+ * halves. Nodes must have been reserved (see btree_reserve()).
+ *
+ * @param n Node to insert below (void*)
+ * @param height Height of n, 0 for a leaf (uint32_t)
+ * @param node Receipt to insert (Receipt*)
+ * @param prev Receives the record before node, NULL if it goes first (Receipt**)
+ * @return void* New right sibling of n if n was split, NULL otherwise
+ */
+void *btree_insert_into(void *n, uint32_t height, Receipt *node, Receipt **prev){
+    if(height == 0){
+        BTreeLeaf *leaf = n;
+        uint32_t pos = 0;
+        while(pos < leaf->count && hot_compare_receipt(&leaf->items[pos], node) <= 0) pos++;
+        // Every leaf but the first starts with a record at or before node, so pos is 0 only at the front
+        *prev = (pos > 0) ? leaf->items[pos-1].node : NULL;
+
+        if(leaf->count < BTREE_LEAF_SLOTS){
+            memmove(&leaf->items[pos+1], &leaf->items[pos], (leaf->count - pos) * sizeof(HotRecord));
+            hot_record_set(&leaf->items[pos], node);
+            leaf->count++;
+            return NULL;
+        }
+
+        // Split: the upper half of the BTREE_LEAF_SLOTS + 1 records moves to a new leaf
+        HotRecord items[BTREE_LEAF_SLOTS + 1];
+        memcpy(items, leaf->items, pos * sizeof(HotRecord));
+        hot_record_set(&items[pos], node);
+        memcpy(&items[pos+1], &leaf->items[pos], (leaf->count - pos) * sizeof(HotRecord));
+
+        BTreeLeaf *right = btree_node_new();
+        uint32_t keep = (BTREE_LEAF_SLOTS + 1) / 2;
+        leaf->count = keep;
+        memcpy(leaf->items, items, keep * sizeof(HotRecord));
+        right->count = BTREE_LEAF_SLOTS + 1 - keep;
+        memcpy(right->items, &items[keep], right->count * sizeof(HotRecord));
+        right->next = leaf->next;
+        leaf->next = right;
+        return right;
+    }
+
+    BTreeInner *inner = n;
+    uint32_t i = 0;
+    while(i + 1 < inner->count && hot_compare_receipt(&inner->lows[i+1], node) <= 0) i++;
+
+    void *split = btree_insert_into(inner->children[i], height - 1, node, prev);
+    btree_refresh(inner, i, height - 1);
+    if(split == NULL) return NULL;
+
+    if(inner->count < BTREE_FANOUT){
+        uint32_t move = inner->count - i - 1;
+        memmove(&inner->children[i+2], &inner->children[i+1], move * sizeof(void*));
+        memmove(&inner->sizes[i+2], &inner->sizes[i+1], move * sizeof(uint32_t));
+        memmove(&inner->lows[i+2], &inner->lows[i+1], move * sizeof(HotRecord));
+        inner->children[i+1] = split;
+        btree_refresh(inner, i + 1, height - 1);
+        inner->count++;
+        return NULL;
+    }
+
+    // Split: the upper half of the BTREE_FANOUT + 1 children moves to a new node
+    void *children[BTREE_FANOUT + 1];
+    memcpy(children, inner->children, (i + 1) * sizeof(void*));
+    children[i+1] = split;
+    memcpy(&children[i+2], &inner->children[i+1], (inner->count - i - 1) * sizeof(void*));
+
+    BTreeInner *right = btree_node_new();
+    uint32_t keep = (BTREE_FANOUT + 1) / 2;
+    btree_fill(inner, children, keep, height - 1);
+    btree_fill(right, &children[keep], BTREE_FANOUT + 1 - keep, height - 1);
+    return right;
+}
+
+/**
+ * @brief Inserts a node into the B+tree
+ *
+ * O(log n): one root-to-leaf descent, splitting full nodes on the way back
+ * up; a split root gets a new root above it.
+ *
+ * @param node Node to insert (Receipt*)
+ * @param prev Receives the record before node, NULL if it goes first (Receipt**)
+ * @return uint8_t 1 on success, 0 on allocation failure (the tree is unchanged)
+ */
+uint8_t btree_insert(Receipt *node, Receipt **prev){
+    if(!btree_reserve(btree.height + 2)) return 0;
+
+    if(btree.root == NULL){
+        BTreeLeaf *leaf = btree_node_new();
+        leaf->next = NULL;
+        leaf->count = 1;
+        hot_record_set(&leaf->items[0], node);
+        btree.root = leaf;
+        btree.height = 0;
+        btree.count = 1;
+        *prev = NULL;
+        return 1;
+    }
+
+    void *split = btree_insert_into(btree.root, btree.height, node, prev);
+    if(split != NULL){
+        void *children[2] = {btree.root, split};
+        BTreeInner *root = btree_node_new();
+        btree_fill(root, children, 2, btree.height);
+        btree.root = root;
+        btree.height++;
+    }
+    btree.count++;
+    return 1;
+}
+
+/**
+ * @brief Removes the record at a position below a B+tree node
+ *
+ * A child left less than half full is merged with a neighbour, or evened
+ * out with it if both do not fit in one node (see btree_rebalance()).
+ *
+ * @param n Node to remove from (void*)
+ * @param height Height of n, 0 for a leaf (uint32_t)
+ * @param rank Position of the record below n (size_t)
+ */
+void btree_remove_at(void *n, uint32_t height, size_t rank){
+    if(height == 0){
+        BTreeLeaf *leaf = n;
+        memmove(&leaf->items[rank], &leaf->items[rank+1], (leaf->count - rank - 1) * sizeof(HotRecord));
+        leaf->count--;
+        return;
+    }
+
+    BTreeInner *inner = n;
+    uint32_t i = 0;
+    while(rank >= inner->sizes[i]){
+        rank -= inner->sizes[i];
+        i++;
+    }
+    btree_remove_at(inner->children[i], height - 1, rank);
+
+    uint32_t children = (height == 1) ? ((BTreeLeaf *) inner->children[i])->count
+                                      : ((BTreeInner *) inner->children[i])->count;
+    uint32_t min = (height == 1) ? BTREE_LEAF_SLOTS / 2 : BTREE_FANOUT / 2;
+    if(children < min && inner->count > 1){
+        btree_rebalance(inner, (i > 0) ? i - 1 : i, height - 1);
+    }
+    else{
+        btree_refresh(inner, i, height - 1);
+    }
+}
+
+/**
+ * @brief Merges or evens out two neighbouring children of an inner node
+ *
+ * If the records (or children) of both fit in one node, the right one is
+ * emptied into the left one and released; otherwise they are split evenly
+ * between the two.
+ *
+ * @param inner Parent node (BTreeInner*)
+ * @param i Index of the left child; i + 1 is the right one (uint32_t)
+ * @param child_height Height of the children, 0 for leaves (uint32_t)
+ */
+void btree_rebalance(BTreeInner *inner, uint32_t i, uint32_t child_height){
+    uint32_t merged = 0;
+
+    if(child_height == 0){
+        BTreeLeaf *left = inner->children[i];
+        BTreeLeaf *right = inner->children[i+1];
+        uint32_t total = left->count + right->count;
+        if(total <= BTREE_LEAF_SLOTS){
+            memcpy(&left->items[left->count], right->items, right->count * sizeof(HotRecord));
+            left->count = total;
+            left->next = right->next;
+            btree_node_release(right);
+            merged = 1;
+        }
+        else if(left->count > total / 2){
+            uint32_t move = left->count - total / 2;
+            memmove(&right->items[move], right->items, right->count * sizeof(HotRecord));
+            memcpy(right->items, &left->items[total / 2], move * sizeof(HotRecord));
+            left->count -= move;
+            right->count += move;
+        }
+        else{
+            uint32_t move = total / 2 - left->count;
+            memcpy(&left->items[left->count], right->items, move * sizeof(HotRecord));
+            memmove(right->items, &right->items[move], (right->count - move) * sizeof(HotRecord));
+            left->count += move;
+            right->count -= move;
+        }
+    }
+    else{
+        BTreeInner *left = inner->children[i];
+        BTreeInner *right = inner->children[i+1];
+        uint32_t total = left->count + right->count;
+        void *children[2 * BTREE_FANOUT];
+        memcpy(children, left->children, left->count * sizeof(void*));
+        memcpy(&children[left->count], right->children, right->count * sizeof(void*));
+        if(total <= BTREE_FANOUT){
+            btree_fill(left, children, total, child_height - 1);
+            btree_node_release(right);
+            merged = 1;
+        }
+        else{
+            btree_fill(left, children, total / 2, child_height - 1);
+            btree_fill(right, &children[total / 2], total - total / 2, child_height - 1);
+        }
+    }
+
+    if(merged){
+        uint32_t move = inner->count - i - 2;
+        memmove(&inner->children[i+1], &inner->children[i+2], move * sizeof(void*));
+        memmove(&inner->sizes[i+1], &inner->sizes[i+2], move * sizeof(uint32_t));
+        memmove(&inner->lows[i+1], &inner->lows[i+2], move * sizeof(HotRecord));
+        inner->count--;
+    }
+    else{
+        btree_refresh(inner, i + 1, child_height);
+    }
+    btree_refresh(inner, i, child_height);
+}
+
+/**
+ * @brief Removes a node from the B+tree
+ *
+ * Finds the node's position (see btree_rank()), then removes by position
+ * in one descent: O(log n). A root left with a single child is replaced by
+ * that child.
+ *
+ * @param node Node to remove, under its current name (const Receipt*)
+ * @return uint8_t 1 if the node was in the tree, 0 otherwise
+ */
+uint8_t btree_remove(const Receipt *node){
+    size_t rank = btree_rank(node);
+    if(rank >= btree.count) return 0;
+
+    btree_remove_at(btree.root, btree.height, rank);
+    btree.count--;
+
+    if(btree.height > 0 && ((BTreeInner *) btree.root)->count == 1){
+        void *old = btree.root;
+        btree.root = ((BTreeInner *) old)->children[0];
+        btree.height--;
+        btree_node_release(old);
+    }
+    else if(btree.height == 0 && btree.count == 0){
+        btree_node_release(btree.root);
+        btree.root = NULL;
+    }
+    return 1;
+}
+
+/**
+ * @brief Finds the leaf holding the record at a position
+ *
+ * Descends by the record counts of the inner nodes: O(log n).
+ *
+ * @param rank Position of the record, below btree.count (size_t)
+ * @param pos Receives the record's index in the leaf (uint32_t*)
+ * @return BTreeLeaf* The leaf
+ */
+BTreeLeaf *btree_leaf_at(size_t rank, uint32_t *pos){
+    void *n = btree.root;
+    for(uint32_t height = btree.height; height > 0; height--){
+        BTreeInner *inner = n;
+        uint32_t i = 0;
+        while(rank >= inner->sizes[i]){
+            rank -= inner->sizes[i];
+            i++;
+        }
+        n = inner->children[i];
+    }
+    *pos = (uint32_t) rank;
+    return n;
+}
+
+/**
+ * @brief Finds the first B+tree record whose name is not below a folded name
+ *
+ * @param key name_key() of folded (uint64_t)
+ * @param folded Name to look for, from fold_name() (const char*)
+ * @param pos Receives the record's index in the returned leaf (uint32_t*)
+ * @param rank Receives the record's position, btree.count if there is none (size_t*)
+ * @return BTreeLeaf* Leaf of the record, or NULL if every name is below folded
+ */
+BTreeLeaf *btree_lower_bound(uint64_t key, const char *folded, uint32_t *pos, size_t *rank){
+    *rank = 0;
+    void *n = btree.root;
+    if(n == NULL) return NULL;
+
+    for(uint32_t height = btree.height; height > 0; height--){
+        BTreeInner *inner = n;
+        uint32_t i = 0;
+        while(i + 1 < inner->count && hot_compare_name(&inner->lows[i+1], key, folded) < 0){
+            *rank += inner->sizes[i];
+            i++;
+        }
+        n = inner->children[i];
+    }
+
+    BTreeLeaf *leaf = n;
+    uint32_t i = 0;
+    while(i < leaf->count && hot_compare_name(&leaf->items[i], key, folded) < 0) i++;
+    *rank += i;
+    if(i == leaf->count){
+        // The first record at or past the name starts the next leaf
+        leaf = leaf->next;
+        i = 0;
+    }
+    *pos = i;
+    return leaf;
+}
+
+/**
+ * @brief Looks a name up in the B+tree
+ *
+ * @param key name_key() of folded (uint64_t)
+ * @param folded Name to look for, from fold_name() (const char*)
+ * @return Receipt* The first receipt with that name, or NULL
+ */
+Receipt *btree_find_name(uint64_t key, const char *folded){
+    uint32_t pos;
+    size_t rank;
+    BTreeLeaf *leaf = btree_lower_bound(key, folded, &pos, &rank);
+    if(leaf != NULL && hot_compare_name(&leaf->items[pos], key, folded) == 0) return leaf->items[pos].node;
+    return NULL;
+}
+
+/**
+ * @brief Position of a node in the B+tree
+ *
+ * Searches the node's name, then scans the run of equal names for the node
+ * itself, like name_table_position().
+ *
+ * @param node Node to look for (const Receipt*)
+ * @return size_t Its position, or btree.count if it is not in the tree
+ */
+size_t btree_rank(const Receipt *node){
+    uint32_t pos;
+    size_t rank;
+    for(BTreeLeaf *leaf = btree_lower_bound(node->name_key, node->folded, &pos, &rank); leaf != NULL; leaf = leaf->next, pos = 0){
+        for(; pos < leaf->count; pos++, rank++){
+            if(leaf->items[pos].node == node) return rank;
+            if(hot_compare_name(&leaf->items[pos], node->name_key, node->folded) != 0) return btree.count;
+        }
+    }
+    return btree.count;
+}
+
+/**
+ * @brief Hands out the B+tree's records from a position on, one leaf per run
+ *
+ * @param rank Position of the first record (size_t)
+ * @param run Receives the rest of the leaf holding it (StoreRun*)
+ * @return uint8_t 1 on success, 0 if rank is past the end
+ */
+uint8_t btree_seek(size_t rank, StoreRun *run){
+    if(rank >= btree.count) return 0;
+    uint32_t pos;
+    BTreeLeaf *leaf = btree_leaf_at(rank, &pos);
+    run->items = &leaf->items[pos];
+    run->count = leaf->count - pos;
+    run->cursor = leaf->next;
+    return 1;
+}
+
+/**
+ * @brief Moves a B+tree run on to the next leaf
+ *
+ * @param run Run to advance (StoreRun*)
+ * @return uint8_t 1 on success, 0 after the last leaf
+ */
+uint8_t btree_next(StoreRun *run){
+    BTreeLeaf *leaf = run->cursor;
+    if(leaf == NULL) return 0;
+    run->items = leaf->items;
+    run->count = leaf->count;
+    run->cursor = leaf->next;
+    return 1;
+}
+
+/**
+ * @brief Number of records in the B+tree
+ *
+ * @return size_t Record count
+ */
+size_t btree_count(){
+    return btree.count;
+}
+
+/**
+ * @brief Displays the full details of a specific receipt
+ *
+ * Searches for a receipt by ID and prints its name and content to stdout.
+ * In lazy mode the body is fetched on demand through the body cache.
+ * Logs an error if the receipt is not found.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param receipt_id The ID of the receipt to view (uint32_t)
+ */
+void view_receipt(Receipt *head, uint32_t receipt_id){
+    if(head == NULL){
+        custom_log(LOG_WARN, "Receipt list is empty, nothing to view.\n");
+        return;
+    }
+
+    Receipt *current = find_receipt(head, receipt_id);
+    if(current == NULL){
+        char msg[LEN_LOG_MSG];
+        snprintf(msg, sizeof(msg), "Receipt ID '%u' not found.\n", receipt_id);
+        custom_log(LOG_ERROR, msg);
+        return;
+    }
+
+    const char *body = receipt_body(current);
+    if(body == NULL){
+        custom_log(LOG_ERROR, "Could not read receipt body.\n");
+        return;
+    }
+
+    printf("\n\t[%u] %s\n\n", current->id, current->name);
+    printf("\t%s\n", body);
+}
+
+/**
+ * @brief Displays a summary list of all receipts
+ *
+ * Prints a formatted list showing the ID and name of each receipt.
+ * Displays a message if the list is empty. Scans the ordered store's hot
+ * records run by run (the B+tree's linked leaves) when it can, so node
+ * addresses are known ahead of the loads instead of being chased through
+ * next pointers.
+ *
+ * @param r Pointer to the head of the receipt list (Receipt*)
+ */
+void display_receipts(Receipt *r){
+    if(r == NULL){
+        custom_log(LOG_INFO, "The cookbook is empty!\n");
+        return;
+    }
+    printf("[ID] Receipt name\n");
+    StoreRun run;
+    if(store_sync(r)){
+        for(uint8_t more = ordered_store->seek(0, &run); more; more = ordered_store->next(&run)){
+            for(size_t i = 0; i < run.count; i++){
+                printf("- [%u] %s\n", run.items[i].id, run.items[i].node->name);
+            }
+        }
+        return;
+    }
+    Receipt *current = r;
+    while(current != NULL){
+        printf("- [%u] %s\n", current->id, current->name);
+        current = current->next;
+    }
+}
+
+/**
+ * @brief Displays one page of the receipt summary list
+ *
+ * Pages hold PAGE_SIZE receipts in alphabetical order. The first receipt
+ * of the page is found with the ordered store's seek, so any page is
+ * reached without walking the receipts before it. A page past the end
+ * shows the last page.
+ *
+ * @param r Pointer to the head of the receipt list (Receipt*)
+ * @param page Zero-based page number (size_t)
+ */
+void display_page(Receipt *r, size_t page){
+    if(r == NULL){
+        custom_log(LOG_INFO, "The cookbook is empty!\n");
+        return;
+    }
+
+    size_t count = 0;
+    uint8_t stored = store_sync(r);
+    if(stored) count = ordered_store->count();
+    else for(Receipt *current = r; current != NULL; current = current->next) count++;
+
+    size_t pages = (count + PAGE_SIZE - 1) / PAGE_SIZE;
+    if(page >= pages) page = pages - 1;
+    size_t first = page * PAGE_SIZE;
+    size_t last = (first + PAGE_SIZE < count) ? first + PAGE_SIZE : count;
+
+    printf("Page %zu of %zu (receipts %zu-%zu of %zu)\n", page + 1, pages, first + 1, last, count);
+    printf("[ID] Receipt name\n");
+    StoreRun run;
+    if(stored){
+        size_t i = first;
+        for(uint8_t more = ordered_store->seek(first, &run); more && i < last; more = ordered_store->next(&run)){
+            for(size_t k = 0; k < run.count && i < last; k++, i++){
+                printf("- [%u] %s\n", run.items[k].id, run.items[k].node->name);
+            }
+        }
+        return;
+    }
+    Receipt *current = select_receipt(r, first);
+    for(size_t i = first; current != NULL && i < last; i++){
+        printf("- [%u] %s\n", current->id, current->name);
+        current = current->next;
+    }
+}
+
+/**
+ * @brief Frees all memory allocated for the receipt linked list
+ *
+ * Traverses the entire linked list and gives each node and its body back
+ * to the node pool and body arena, then closes the calling thread's body
+ * arena chunk and empties the body cache. Use this for a list that is
+ * replaced while the program runs; teardown_receipts() frees everything
+ * at exit without the walk.
+ * Should be called before program exit to prevent memory leaks.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ */
+void free_list(Receipt *head){
+    Receipt *tmp;
+    while(head != NULL){
+        tmp = head;
+        head = head->next;
+        body_release(tmp->receipt);
+        node_free(tmp);
+    }
+    body_arena_close();
+    body_cache_clear();
+    store_clear();
+    id_index_clear();
+}
+
+/**
+ * @brief Releases every receipt node and body at once
+ *
+ * Frees the node slabs and body chunks wholesale, one free() each, instead
+ * of walking the list, then empties the body cache and lookup tables. Only
+ * for shutdown (or a benchmark between runs): no list may be used
+ * afterwards and no loader thread may be running.
+ */
+void teardown_receipts(){
+    body_cache_clear();
+    store_clear();
+    id_index_clear();
+    node_pool_reset();
+    body_arena_reset();
+}
+
+/**
+ * @brief Extends a 64-bit FNV-1a hash with a block of bytes
+ *
+ * Hashing a file in pieces gives the same result as hashing it at once,
+ * which lets appends extend the stored hash without rereading the file.
+ *
+ * @param hash Current hash, FNV_OFFSET_BASIS to start (uint64_t)
+ * @param data Bytes to hash (const void*)
+ * @param len Number of bytes (size_t)
+ * @return uint64_t Updated hash
+ */
+uint64_t fnv1a64(uint64_t hash, const void *data, size_t len){
+    const unsigned char *p = data;
+    for(size_t i = 0; i < len; i++){
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Computes the FNV-1a hash of a whole file
+ *
+ * @param path File to hash (const char*)
+ * @param hash Receives the hash (uint64_t*)
+ * @return uint8_t 1 on success, 0 if the file could not be read
+ */
+uint8_t hash_file(const char *path, uint64_t *hash){
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return 0;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        return 0;
+    }
+
+    *hash = FNV_OFFSET_BASIS;
+    if(st.st_size > 0){
+        char *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            close(fd);
+            return 0;
+        }
+        madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+        *hash = fnv1a64(*hash, data, (size_t) st.st_size);
+        munmap(data, (size_t) st.st_size);
+    }
+    close(fd);
+    return 1;
+}
+
+/**
+ * @brief Hashes one block of a file for the index's content hash
+ *
+ * @param block Block number: the block starts at block * HASH_BLOCK (uint64_t)
+ * @param data Bytes of the block, up to the end of the file (const char*)
+ * @param len Number of bytes, at most HASH_BLOCK (size_t)
+ * @return uint64_t FNV-1a 64 of the block number and its bytes
+ */
+uint64_t hash_block(uint64_t block, const char *data, size_t len){
+    uint64_t hash = fnv1a64(FNV_OFFSET_BASIS, &block, sizeof(block));
+    return fnv1a64(hash, data, len);
+}
+
+/**
+ * @brief Computes the index's content hash of a whole file
+ *
+ * The hash is the sum of the hashes of the file's HASH_BLOCK-byte blocks
+ * (see hash_block()), so a write only changes the terms of the blocks it
+ * touches: an append or an in-place patch updates the stored hash by
+ * rehashing those blocks alone (see hash_blocks_at()).
+ *
+ * @param path File to hash (const char*)
+ * @param hash Receives the hash, 0 for an empty file (uint64_t*)
+ * @return uint8_t 1 on success, 0 if the file could not be read
+ */
+uint8_t hash_file_blocks(const char *path, uint64_t *hash){
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return 0;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        return 0;
+    }
+
+    *hash = 0;
+    if(st.st_size > 0){
+        size_t len = (size_t) st.st_size;
+        char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            close(fd);
+            return 0;
+        }
+        madvise(data, len, MADV_SEQUENTIAL);
+        for(size_t off = 0; off < len; off += HASH_BLOCK){
+            *hash += hash_block(off / HASH_BLOCK, data + off, (len - off < HASH_BLOCK) ? len - off : HASH_BLOCK);
+        }
+        munmap(data, len);
+    }
+    close(fd);
+    return 1;
+}
+
+/**
+ * @brief Sums the content hash terms of the blocks a byte range touches
+ *
+ * Blocks are read as if the file ended at size, so the same call before
+ * and after an append (with the old and the new size) gives the terms to
+ * subtract and to add.
+ *
+ * @param fd Open file descriptor (int)
+ * @param from First byte of the range (off_t)
+ * @param to End of the range (off_t)
+ * @param size File size to assume (off_t)
+ * @param hash Receives the sum (uint64_t*)
+ * @return uint8_t 1 on success, 0 if a block could not be read
+ */
+uint8_t hash_blocks_at(int fd, off_t from, off_t to, off_t size, uint64_t *hash){
+    char buf[HASH_BLOCK];
+    *hash = 0;
+    for(off_t block = from / HASH_BLOCK; block * HASH_BLOCK < to && block * HASH_BLOCK < size; block++){
+        off_t start = block * HASH_BLOCK;
+        size_t len = (size - start < HASH_BLOCK) ? (size_t) (size - start) : HASH_BLOCK;
+        if(pread(fd, buf, len, start) != (ssize_t) len) return 0;
+        *hash += hash_block((uint64_t) block, buf, len);
+    }
+    return 1;
+}
+
+/**
+ * @brief qsort()/bsearch() comparator for index entries (name, then ID)
+ *
+ * @param a First entry (const IndexEntry*)
+ * @param b Second entry (const IndexEntry*)
+ * @return int Negative, zero or positive like strcmp()
+ */
+int compare_index_entries(const void *a, const void *b){
+    const IndexEntry *ea = a;
+    const IndexEntry *eb = b;
+    int cmp = case_insensitive_compare(ea->name, eb->name);
+    if(cmp != 0) return cmp;
+    return (ea->id > eb->id) - (ea->id < eb->id);
+}
+
+/**
+ * @brief qsort comparator for receipt IDs
+ *
+ * @param a Pointer to the first ID (const uint32_t*)
+ * @param b Pointer to the second ID (const uint32_t*)
+ * @return int Negative, zero or positive as a is below, equal to or above b
+ */
+int compare_ids(const void *a, const void *b){
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Rebuilds the sidecar index from the in-memory list
+ *
+ * Writes one IndexEntry per receipt (name, ID, body offset and length in
+ * the text file), sorted by name and ID, under a header recording the size,
+ * mtime and content hash of the text file.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param data_path Path of the text receipts file, already written (const char*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_index(Receipt *head, const char *data_path){
+    IndexHeader header = {0};
+    struct stat st;
+    Receipt *current;
+
+    if(stat(data_path, &st) != 0) return 0;
+    if(!hash_file_blocks(data_path, &header.source_hash)) return 0;
+
+    uint32_t count = 0;
+    for(current = head; current != NULL; current = current->next) count++;
+
+    IndexEntry *entries = calloc(count ? count : 1, sizeof(IndexEntry));
+    if(entries == NULL) return 0;
+
+    uint32_t i = 0;
+    for(current = head; current != NULL; current = current->next, i++){
+        if(current->body_off < 0){
+            free(entries);
+            return 0;
+        }
+        entries[i].body_off = (uint64_t) current->body_off;
+        entries[i].id = current->id;
+        entries[i].body_len = current->body_len;
+        memcpy(entries[i].name, current->name, strlen(current->name));
+    }
+    qsort(entries, count, sizeof(IndexEntry), compare_index_entries);
+
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.count = count;
+    header.source_size = (uint64_t) st.st_size;
+    header.source_mtime_sec = st.st_mtim.tv_sec;
+    header.source_mtime_nsec = st.st_mtim.tv_nsec;
+
+    uint8_t ok = write_index_file(data_path, &header, entries);
+    free(entries);
+    return ok;
+}
+
+/**
+ * @brief Writes an index header and its entries next to the text file
+ *
+ * Writes to a temporary name and renames it into place.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param header Index header (const IndexHeader*)
+ * @param entries header->count entries (const IndexEntry*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_index_file(const char *data_path, const IndexHeader *header, const IndexEntry *entries){
+    char idx[LEN_PATH], tmp[LEN_PATH + 8];
+    sidecar_path(idx, sizeof(idx), data_path, INDEX_EXT);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", idx);
+
+    FILE *fptr = fopen(tmp, "wb");
+    if(fptr == NULL) return 0;
+
+    uint8_t ok = fwrite(header, sizeof(IndexHeader), 1, fptr) == 1
+        && fwrite(entries, sizeof(IndexEntry), header->count, fptr) == header->count;
+    if(fclose(fptr) != 0) ok = 0;
+    if(ok && rename(tmp, idx) != 0) ok = 0;
+    if(!ok) unlink(tmp);
+    return ok;
+}
+
+/**
+ * @brief Loads the receipt list from the sidecar index, if it is current
+ *
+ * The index is trusted when its recorded size and mtime match the text
+ * file; the content hash is only checked by verify_index(), since hashing
+ * would read the whole file. Entries are already sorted and are linked in
+ * order. Bodies are copied from the mapped text file at their recorded
+ * offsets, without scanning it, or left on disk in lazy mode.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param head Receives the head of the loaded list (Receipt**)
+ * @return uint8_t 1 if the index was used, 0 if the caller must parse the text file
+ */
+uint8_t load_index(const char *data_path, Receipt **head){
+    struct stat data_st, idx_st;
+    char idx[LEN_PATH];
+
+    *head = NULL;
+    if(stat(data_path, &data_st) != 0) return 0;
+
+    sidecar_path(idx, sizeof(idx), data_path, INDEX_EXT);
+    int fd = open(idx, O_RDONLY);
+    if(fd < 0) return 0;
+    if(fstat(fd, &idx_st) != 0 || (size_t) idx_st.st_size < sizeof(IndexHeader)){
+        close(fd);
+        return 0;
+    }
+
+    size_t len = (size_t) idx_st.st_size;
+    const char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return 0;
+
+    const IndexHeader *header = (const IndexHeader *) data;
+    uint8_t valid = memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0
+        && header->version == INDEX_VERSION
+        && header->source_size == (uint64_t) data_st.st_size
+        && header->source_mtime_sec == data_st.st_mtim.tv_sec
+        && header->source_mtime_nsec == data_st.st_mtim.tv_nsec
+        && len == sizeof(IndexHeader) + (uint64_t) header->count * sizeof(IndexEntry);
+    if(!valid){
+        custom_log(LOG_DEBUG, "Index is stale or invalid, parsing text.\n");
+        munmap((void *) data, len);
+        return 0;
+    }
+
+    // Eager mode copies bodies out of the text file
+    const char *text = NULL;
+    size_t text_len = (size_t) data_st.st_size;
+    if(!lazy_bodies && text_len > 0){
+        int text_fd = open(data_path, O_RDONLY);
+        if(text_fd >= 0){
+            text = mmap(NULL, text_len, PROT_READ, MAP_PRIVATE, text_fd, 0);
+            close(text_fd);
+        }
+        if(text == NULL || text == MAP_FAILED){
+            munmap((void *) data, len);
+            return 0;
+        }
+    }
+
+    const IndexEntry *entries = (const IndexEntry *) (data + sizeof(IndexHeader));
+    Receipt *tail = NULL;
+    uint8_t ok = 1;
+    reset_load_progress(header->count);
+
+    for(uint32_t i = 0; i < header->count; i++){
+        const IndexEntry *entry = &entries[i];
+        if(i % PROGRESS_STRIDE == 0){
+            atomic_store(&load_progress.records, i);
+            atomic_store(&load_progress.done, i);
+        }
+        if(entry->body_off + entry->body_len > text_len){
+            ok = 0;
+            break;
+        }
+
+        Receipt *node = node_alloc();
+        if(node == NULL){
+            ok = 0;
+            break;
+        }
+        set_receipt_name(node, entry->name, strnlen(entry->name, LEN_NAME-1));
+        node->id = entry->id;
+        node->body_len = entry->body_len;
+        node->body_off = (off_t) entry->body_off;
+        node->receipt = NULL;
+        if(text != NULL){
+            node->receipt = body_alloc(text + entry->body_off, entry->body_len);
+            if(node->receipt == NULL){
+                node_free(node);
+                ok = 0;
+                break;
+            }
+        }
+
+        node->next = NULL;
+        node->prev = tail;
+        if(tail != NULL) tail->next = node;
+        else *head = node;
+        tail = node;
+    }
+
+    uint32_t count = header->count;
+    if(text != NULL) munmap((void *) text, text_len);
+    munmap((void *) data, len);
+
+    if(!ok){
+        custom_log(LOG_WARN, "Index is corrupted, parsing text.\n");
+        free_list(*head);
+        *head = NULL;
+        return 0;
+    }
+
+    char log_msg[LEN_LOG_MSG];
+    snprintf(log_msg, sizeof(log_msg), "%u receipt(s) loaded from index!\n\n", count);
+    custom_log(LOG_INFO, log_msg);
+
+    if(lazy_bodies) open_body_source(data_path);
+    track_receipts_path(data_path, &data_st);
+    return 1;
+}
+
+/**
+ * @brief Adds appended records to the sidecar index
+ *
+ * Only applies when the index described the file exactly as it was before
+ * the append (size and mtime in before). The new entries are sorted and
+ * merged in, so a batch costs one pass over the index however large it
+ * is. Only the block the append started in and the ones it added are
+ * rehashed for the content hash, so the rest of the file is not reread.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param added The appended receipts, with body_off set (Receipt* const*)
+ * @param count Number of appended receipts (size_t)
+ * @param before Status of the text file before the append (const struct stat*)
+ * @return uint8_t 1 if the index was updated, 0 if it was left stale
+ */
+uint8_t index_append(const char *data_path, Receipt *const *added, size_t count, const struct stat *before){
+    char idx[LEN_PATH];
+    struct stat after;
+    IndexHeader header;
+    uint64_t old_terms, new_terms;
+
+    sidecar_path(idx, sizeof(idx), data_path, INDEX_EXT);
+    int fd = open(data_path, O_RDONLY);
+    if(fd < 0) return 0;
+    uint8_t hashed = fstat(fd, &after) == 0
+        && hash_blocks_at(fd, before->st_size, after.st_size, before->st_size, &old_terms)
+        && hash_blocks_at(fd, before->st_size, after.st_size, after.st_size, &new_terms);
+    close(fd);
+    if(!hashed) return 0;
+
+    FILE *fptr = fopen(idx, "rb");
+    if(fptr == NULL) return 0;
+    if(fread(&header, sizeof(header), 1, fptr) != 1
+       || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0
+       || header.version != INDEX_VERSION
+       || header.source_size != (uint64_t) before->st_size
+       || header.source_mtime_sec != before->st_mtim.tv_sec
+       || header.source_mtime_nsec != before->st_mtim.tv_nsec){
+        fclose(fptr);
+        return 0;
+    }
+
+    IndexEntry *entries = calloc((size_t) header.count + count, sizeof(IndexEntry));
+    IndexEntry *fresh = calloc(count, sizeof(IndexEntry));
+    if(entries == NULL || fresh == NULL || fread(entries, sizeof(IndexEntry), header.count, fptr) != header.count){
+        free(entries);
+        free(fresh);
+        fclose(fptr);
+        return 0;
+    }
+    fclose(fptr);
+
+    for(size_t i = 0; i < count; i++){
+        fresh[i].body_off = (uint64_t) added[i]->body_off;
+        fresh[i].id = added[i]->id;
+        fresh[i].body_len = added[i]->body_len;
+        memcpy(fresh[i].name, added[i]->name, strlen(added[i]->name));
+    }
+    qsort(fresh, count, sizeof(IndexEntry), compare_index_entries);
+
+    // Merge from the back, each new entry after the existing ones it ties with
+    size_t i = header.count, j = count, k = header.count + count;
+    while(j > 0){
+        if(i > 0 && compare_index_entries(&entries[i - 1], &fresh[j - 1]) > 0) entries[--k] = entries[--i];
+        else entries[--k] = fresh[--j];
+    }
+    free(fresh);
+
+    header.count += (uint32_t) count;
+    header.source_size = (uint64_t) after.st_size;
+    header.source_mtime_sec = after.st_mtim.tv_sec;
+    header.source_mtime_nsec = after.st_mtim.tv_nsec;
+    header.source_hash += new_terms - old_terms;
+
+    uint8_t ok = write_index_file(data_path, &header, entries);
+    free(entries);
+    return ok;
+}
+
+/**
+ * @brief Updates the sidecar index for a body patched in place
+ *
+ * Only applies when the index described the file exactly as it was before
+ * the patch (size and mtime in before). The receipt's entry is found by a
+ * binary search that reads one entry per step and is rewritten with the
+ * new body length; the header takes the new mtime and swaps the patched
+ * block's term of the content hash. Neither is read or written as a
+ * whole. A crash between the two leaves the header stale, so the index is
+ * rebuilt on the next load.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param r The patched receipt, still describing the old body (const Receipt*)
+ * @param body_len New body length (uint32_t)
+ * @param before Status of the text file before the patch (const struct stat*)
+ * @param after Status of the text file after the patch (const struct stat*)
+ * @param old_terms Hash term of the patched block before the patch (uint64_t)
+ * @param new_terms Hash term of the patched block after it (uint64_t)
+ * @return uint8_t 1 if the index was updated, 0 if it was left stale
+ */
+uint8_t index_patch(const char *data_path, const Receipt *r, uint32_t body_len, const struct stat *before, const struct stat *after, uint64_t old_terms, uint64_t new_terms){
+    char idx[LEN_PATH];
+    IndexHeader header;
+    IndexEntry key = {0}, entry;
+
+    sidecar_path(idx, sizeof(idx), data_path, INDEX_EXT);
+    int fd = open(idx, O_RDWR);
+    if(fd < 0) return 0;
+    if(pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)
+       || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0
+       || header.version != INDEX_VERSION
+       || header.source_size != (uint64_t) before->st_size
+       || header.source_mtime_sec != before->st_mtim.tv_sec
+       || header.source_mtime_nsec != before->st_mtim.tv_nsec){
+        close(fd);
+        return 0;
+    }
+
+    key.id = r->id;
+    memcpy(key.name, r->name, strlen(r->name));
+    size_t lo = 0, hi = header.count;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(pread(fd, &entry, sizeof(entry), (off_t) (sizeof(header) + mid * sizeof(entry))) != (ssize_t) sizeof(entry)){
+            close(fd);
+            return 0;
+        }
+        if(compare_index_entries(&entry, &key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    off_t at = (off_t) (sizeof(header) + lo * sizeof(entry));
+    uint8_t ok = lo < header.count
+        && pread(fd, &entry, sizeof(entry), at) == (ssize_t) sizeof(entry)
+        && compare_index_entries(&entry, &key) == 0
+        && entry.body_off == (uint64_t) r->body_off;
+    if(ok){
+        entry.body_len = body_len;
+        header.source_mtime_sec = after->st_mtim.tv_sec;
+        header.source_mtime_nsec = after->st_mtim.tv_nsec;
+        header.source_hash += new_terms - old_terms;
+        ok = pwrite(fd, &entry, sizeof(entry), at) == (ssize_t) sizeof(entry)
+             && pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    }
+    if(close(fd) != 0) ok = 0;
+    return ok;
+}
+
+/**
+ * @brief Checks the sidecar index against the text file
+ *
+ * Verifies the header (signature, version, size, mtime and full content
+ * hash), that entries are sorted with unique IDs, and that they describe
+ * exactly the records a fresh parse of the text file finds. Prints a
+ * report to stdout.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @return int 0 if the index is valid, 1 otherwise
+ */
+int verify_index(const char *data_path){
+    char idx[LEN_PATH];
+    struct stat st;
+    IndexHeader header;
+    uint64_t hash = 0;
+
+    sidecar_path(idx, sizeof(idx), data_path, INDEX_EXT);
+    printf("Verifying %s against %s\n", idx, data_path);
+
+    FILE *fptr = fopen(idx, "rb");
+    if(fptr == NULL || fread(&header, sizeof(header), 1, fptr) != 1){
+        printf("FAIL: index missing or truncated\n");
+        if(fptr) fclose(fptr);
+        return 1;
+    }
+    if(memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != INDEX_VERSION){
+        printf("FAIL: unknown index format\n");
+        fclose(fptr);
+        return 1;
+    }
+
+    IndexEntry *entries = calloc(header.count ? header.count : 1, sizeof(IndexEntry));
+    if(entries == NULL || fread(entries, sizeof(IndexEntry), header.count, fptr) != header.count){
+        printf("FAIL: index entries truncated\n");
+        free(entries);
+        fclose(fptr);
+        return 1;
+    }
+    fclose(fptr);
+
+    int status = 0;
+    if(stat(data_path, &st) != 0 || !hash_file_blocks(data_path, &hash)){
+        printf("FAIL: %s could not be read\n", data_path);
+        free(entries);
+        return 1;
+    }
+    if(header.source_size != (uint64_t) st.st_size
+       || header.source_mtime_sec != st.st_mtim.tv_sec
+       || header.source_mtime_nsec != st.st_mtim.tv_nsec){
+        printf("FAIL: size/mtime do not match (index is stale)\n");
+        status = 1;
+    }
+    if(header.source_hash != hash){
+        printf("FAIL: content hash does not match\n");
+        status = 1;
+    }
+
+    // Order and ID uniqueness
+    uint32_t i;
+    for(i = 1; i < header.count; i++){
+        if(compare_index_entries(&entries[i-1], &entries[i]) > 0){
+            printf("FAIL: entries out of order at %u\n", i);
+            status = 1;
+            break;
+        }
+    }
+    uint32_t *ids = malloc((header.count ? header.count : 1) * sizeof(uint32_t));
+    if(ids != NULL){
+        for(i = 0; i < header.count; i++) ids[i] = entries[i].id;
+        qsort(ids, header.count, sizeof(uint32_t), compare_ids);
+        for(i = 1; i < header.count; i++){
+            if(ids[i-1] == ids[i]){
+                printf("FAIL: duplicate ID %u\n", ids[i]);
+                status = 1;
+                break;
+            }
+        }
+    }
+    free(ids);
+
+    // Compare (name, offset, length) with a fresh parse, ordered by offset
+    uint8_t saved_lazy = lazy_bodies;
+    LogLevel saved_level = min_log_level;
+    lazy_bodies = 1;
+    min_log_level = LOG_WARN;
+    Receipt *parsed = load_receipts_threads(data_path, 0);
+    lazy_bodies = saved_lazy;
+    min_log_level = saved_level;
+
+    size_t parsed_count = 0;
+    for(Receipt *cur = parsed; cur != NULL; cur = cur->next) parsed_count++;
+    if(parsed_count != header.count){
+        printf("FAIL: index has %u entries, file has %zu records\n", header.count, parsed_count);
+        status = 1;
+    }
+    else{
+        uint64_t parsed_sum = 0, index_sum = 0;
+        for(Receipt *cur = parsed; cur != NULL; cur = cur->next){
+            uint64_t h = fnv1a64(FNV_OFFSET_BASIS, cur->name, strlen(cur->name));
+            h = fnv1a64(h, &cur->id, sizeof(cur->id));
+            h = fnv1a64(h, &cur->body_off, sizeof(cur->body_off));
+            h = fnv1a64(h, &cur->body_len, sizeof(cur->body_len));
+            parsed_sum += h;
+        }
+        for(i = 0; i < header.count; i++){
+            off_t off = (off_t) entries[i].body_off;
+            uint64_t h = fnv1a64(FNV_OFFSET_BASIS, entries[i].name, strnlen(entries[i].name, LEN_INDEX_NAME));
+            h = fnv1a64(h, &entries[i].id, sizeof(entries[i].id));
+            h = fnv1a64(h, &off, sizeof(off));
+            h = fnv1a64(h, &entries[i].body_len, sizeof(entries[i].body_len));
+            index_sum += h;
+        }
+        if(parsed_sum != index_sum){
+            printf("FAIL: entries do not match the records in the file\n");
+            status = 1;
+        }
+    }
+    free_list(parsed);
+    free(entries);
+
+    printf("%s: %u entries\n", status ? "INVALID" : "OK", header.count);
+    return status;
+}
+
+/**
+ * @brief Describes the text file as it is now, for a new journal header
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param header Receives the signature and the file's identity (JournalHeader*)
+ * @return uint8_t 1 on success, 0 if the file could not be read
+ */
+uint8_t journal_source(const char *data_path, JournalHeader *header){
+    int fd = open(data_path, O_RDONLY);
+    if(fd < 0) return 0;
+
+    struct stat st;
+    uint8_t ok = (fstat(fd, &st) == 0);
+    if(ok){
+        memset(header, 0, sizeof(*header));
+        memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+        header->version = JOURNAL_VERSION;
+        header->source_ino = (uint64_t) st.st_ino;
+        header->source_size = (uint64_t) st.st_size;
+        header->head_len = (st.st_size < WATCH_HEAD_BYTES) ? (uint32_t) st.st_size : WATCH_HEAD_BYTES;
+        ok = hash_file_head(fd, header->head_len, &header->head_hash);
+    }
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Checks that a journal's records apply to the text file
+ *
+ * They do while the file is the one the journal was started for (same
+ * inode, same leading bytes) and has at most grown since: appended
+ * records do not affect the ones the journal refers to. A rewrite, by this
+ * program or another, replaces the file and retires the journal.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param header Header read from the journal (const JournalHeader*)
+ * @return uint8_t 1 if the journal applies, 0 otherwise
+ */
+uint8_t journal_matches(const char *data_path, const JournalHeader *header){
+    if(memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0 || header->version != JOURNAL_VERSION){
+        return 0;
+    }
+
+    int fd = open(data_path, O_RDONLY);
+    if(fd < 0) return 0;
+
+    struct stat st;
+    uint64_t hash = 0;
+    uint8_t ok = fstat(fd, &st) == 0
+        && (uint64_t) st.st_ino == header->source_ino
+        && (uint64_t) st.st_size >= header->source_size
+        && hash_file_head(fd, header->head_len, &hash) && hash == header->head_hash;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Checksum of a journal record
+ *
+ * @param rec Record; its checksum field is not included (const JournalRecord*)
+ * @param name Name bytes, rec->name_len of them (const char*)
+ * @param body Body bytes, rec->body_len of them (const char*)
+ * @return uint64_t FNV-1a 64 of the record fields, the name and the body
+ */
+uint64_t journal_checksum(const JournalRecord *rec, const char *name, const char *body){
+    uint64_t hash = fnv1a64(FNV_OFFSET_BASIS, rec, sizeof(*rec) - sizeof(rec->checksum));
+    hash = fnv1a64(hash, name, rec->name_len);
+    return fnv1a64(hash, body, rec->body_len);
+}
+
+/**
+ * @brief Appends an update or a delete to the journal next to the text file
+ *
+ * An upsert carries the receipt's ID, name and body, a delete only the ID,
+ * so the I/O is proportional to the record rather than to the whole file.
+ * The record goes out in a single write at the end of the journal; a
+ * failed write is cut off again so the next record does not land behind
+ * it. It is flushed to disk as the durability policy says (see
+ * append_written()), and pending new receipts are written to the
+ * text file before it. A missing journal, or one left over from an earlier version of the
+ * text file, is started over with a header describing the file as it is
+ * now.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ * @param op JOURNAL_UPSERT or JOURNAL_DELETE (JournalOp)
+ * @param r Receipt that was updated, or is being deleted (Receipt*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t journal_append(const char *data_path, JournalOp op, Receipt *r){
+    JournalRecord rec = {0};
+    const char *body = "";
+    rec.op = (uint32_t) op;
+    rec.id = r->id;
+    if(op == JOURNAL_UPSERT){
+        body = receipt_body(r);
+        if(body == NULL) return 0;
+        rec.name_len = (uint32_t) strlen(r->name);
+        rec.body_len = r->body_len;
+    }
+    rec.checksum = journal_checksum(&rec, r->name, body);
+
+    // New receipts first, so a replay never meets a record the file does not have yet
+    if(!append_flush()) return 0;
+
+    size_t len = sizeof(rec) + rec.name_len + rec.body_len;
+    char *record = malloc(len);
+    if(record == NULL) return 0;
+    memcpy(record, &rec, sizeof(rec));
+    memcpy(record + sizeof(rec), r->name, rec.name_len);
+    memcpy(record + sizeof(rec) + rec.name_len, body, rec.body_len);
+
+    char path[LEN_PATH];
+    sidecar_path(path, sizeof(path), data_path, JOURNAL_EXT);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0){
+        free(record);
+        return 0;
+    }
+
+    struct stat st;
+    JournalHeader header;
+    uint8_t ok = (fstat(fd, &st) == 0);
+    off_t end = st.st_size;
+    if(ok && !((size_t) st.st_size >= sizeof(header)
+               && pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header)
+               && journal_matches(data_path, &header))){
+        // Start over for the text file as it is now
+        end = (off_t) sizeof(header);
+        ok = journal_source(data_path, &header) && ftruncate(fd, 0) == 0
+             && pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    }
+    if(ok && pwrite(fd, record, len, end) != (ssize_t) len){
+        if(ftruncate(fd, end) != 0) custom_log(LOG_ERROR, "Could not truncate journal.\n");
+        ok = 0;
+    }
+    if(ok) ok = append_written(fd, &appender.journal_unsynced);
+    if(close(fd) != 0) ok = 0;
+    free(record);
+    return ok;
+}
+
+/**
+ * @brief Applies the journal next to the text file to a freshly loaded list
+ *
+ * Records are applied in the order they were written (see
+ * journal_apply()). Replay stops at the first record that is cut short or
+ * fails its checksum, which is what a crash in the middle of an append
+ * leaves behind; that tail is truncated so later appends follow the last
+ * good record. A journal started for another version of the text file is
+ * ignored. Dead bytes are counted for compaction_due() on the way.
+ * Afterwards the ID counter is moved past every ID the journal
+ * mentions, so a deleted receipt's ID is not handed out again while a
+ * DELETE record for it is still in the journal.
+ *
+ * @param head Pointer to the head of the list loaded from the text file (Receipt*)
+ * @param data_path Path of the text receipts file (const char*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *journal_replay(Receipt *head, const char *data_path){
+    char path[LEN_PATH];
+    sidecar_path(path, sizeof(path), data_path, JOURNAL_EXT);
+    compaction.dead_bytes = 0;
+
+    // No journal: nothing changed since the last rewrite
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return head;
+
+    struct stat st;
+    JournalHeader header;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(header)
+       || pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)){
+        close(fd);
+        return head;
+    }
+    if(!journal_matches(data_path, &header)){
+        close(fd);
+        custom_log(LOG_WARN, "Journal does not match the receipts file, ignoring it.\n");
+        return head;
+    }
+
+    size_t len = (size_t) st.st_size;
+    char *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        custom_log(LOG_ERROR, "Could not map journal.\n");
+        return head;
+    }
+
+    size_t pos = sizeof(header);
+    size_t applied = 0;
+    uint32_t top_id = 0;
+    while(len - pos >= sizeof(JournalRecord)){
+        JournalRecord rec;
+        memcpy(&rec, data + pos, sizeof(rec));
+        const char *name = data + pos + sizeof(rec);
+
+        // Check the lengths against what is left before reading any payload byte
+        size_t left = len - pos - sizeof(rec);
+        if(rec.name_len >= LEN_NAME || rec.name_len > left || rec.body_len > left - rec.name_len
+           || journal_checksum(&rec, name, name + rec.name_len) != rec.checksum){
+            break;
+        }
+        head = journal_apply(head, &rec, name, name + rec.name_len);
+        if(rec.id > top_id) top_id = rec.id;
+        applied++;
+        pos += sizeof(rec) + rec.name_len + rec.body_len;
+    }
+    munmap(data, len);
+
+    if(pos < len){
+        custom_log(LOG_WARN, "Journal ends in a partial record, truncating it.\n");
+        if(truncate(path, (off_t) pos) != 0) custom_log(LOG_ERROR, "Could not truncate journal.\n");
+    }
+
+    if(applied > 0){
+        uint32_t next = get_new_id(head);
+        next_receipt_id = (top_id >= next) ? top_id + 1 : next;
+
+        char log_msg[LEN_LOG_MSG];
+        snprintf(log_msg, sizeof(log_msg), "%zu journal record(s) replayed.\n", applied);
+        custom_log(LOG_INFO, log_msg);
+    }
+    return head;
+}
+
+/**
+ * @brief Applies one journal record to the list
+ *
+ * A delete removes the receipt with the record's ID, if there is one. An
+ * upsert replaces that receipt's body, and its name, re-sorting it when
+ * the name changed; if there is no such receipt it is created with the
+ * record's ID. Bodies from the journal are kept in memory, also in lazy
+ * mode, until the next rewrite puts them in the text file.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param rec Record to apply (const JournalRecord*)
+ * @param name Name bytes of an upsert, not null-terminated (const char*)
+ * @param body Body bytes of an upsert, not null-terminated (const char*)
+ * @return Receipt* Updated head pointer of the receipt list
+ */
+Receipt *journal_apply(Receipt *head, const JournalRecord *rec, const char *name, const char *body){
+    Receipt *node = find_receipt(head, rec->id);
+
+    // Whatever version of the receipt came before is dead now, and so is a DELETE record
+    if(node != NULL) compaction.dead_bytes += record_bytes(node);
+    if(rec->op == JOURNAL_DELETE){
+        compaction.dead_bytes += sizeof(JournalRecord);
+        if(node != NULL){
+            head = detach_receipt(head, node);
+            body_cache_forget(node);
+            body_release(node->receipt);
+            node_free(node);
+        }
+        return head;
+    }
+    if(rec->op != JOURNAL_UPSERT) return head;
+
+    uint8_t created = (node == NULL);
+    uint8_t renamed = 0;
+    if(created){
+        node = node_alloc();
+        if(node == NULL){
+            custom_log(LOG_ERROR, "Memory allocation failed during journal replay.\n");
+            return head;
+        }
+        memset(node, 0, sizeof(Receipt));
+        node->id = rec->id;
+    }
+    else if(strlen(node->name) != rec->name_len || memcmp(node->name, name, rec->name_len) != 0){
+        // Take the node out while the ordered store can still find it by name
+        head = detach_receipt(head, node);
+        renamed = 1;
+    }
+
+    if(!set_receipt_body(node, body, rec->body_len)){
+        custom_log(LOG_ERROR, "Memory allocation failed for receipt body.\n");
+        if(created){
+            node_free(node);
+            return head;
+        }
+    }
+    if(created || renamed){
+        set_receipt_name(node, name, rec->name_len);
+        head = insert_alphabetically(head, node);
+    }
+    return head;
+}
+
+/**
+ * @brief Removes the journal next to the text file
+ *
+ * Called once a rewrite or compaction has put every journaled change into
+ * the text file, which leaves nothing dead in either file.
+ *
+ * @param data_path Path of the text receipts file (const char*)
+ */
+void journal_reset(const char *data_path){
+    char path[LEN_PATH];
+    sidecar_path(path, sizeof(path), data_path, JOURNAL_EXT);
+    unlink(path);
+    compaction.dead_bytes = 0;
+}
+
+/**
+ * @brief Bytes a receipt takes as a record of the text file
+ *
+ * @param r Receipt to measure (const Receipt*)
+ * @return uint64_t Length of its "Name:", "Id:" and "Receipt:" lines
+ */
+uint64_t record_bytes(const Receipt *r){
+    int id_len = snprintf(NULL, 0, "Id: %u\n", r->id);
+    return LEN_PREFIX_NAME + strlen(r->name) + 1 + (uint64_t) id_len + LEN_PREFIX_RECEIPT + r->body_len + 1;
+}
+
+/**
+ * @brief Size of a file, or 0 if it does not exist
+ *
+ * @param path Path of the file (const char*)
+ * @return uint64_t Size in bytes
+ */
+uint64_t file_bytes(const char *path){
+    struct stat st;
+    return (stat(path, &st) == 0) ? (uint64_t) st.st_size : 0;
+}
+
+/**
+ * @brief Tells whether enough of the receipts files is dead to compact them
+ *
+ * Dead bytes are the text records and journal records that no longer
+ * describe a receipt: earlier versions of updated receipts, deleted ones
+ * and the DELETE records themselves. They are estimated as the journal is
+ * written and replayed (see compaction.dead_bytes); live bytes are the
+ * rest of the text file and the journal.
+ *
+ * A renumbered ID (see id_index_sync()) makes a compaction due at once:
+ * until the text file has it, every load renumbers the node again.
+ *
+ * @return uint8_t 1 when IDs were renumbered, or dead bytes reach COMPACT_MIN_DEAD and COMPACT_DEAD_PCT percent of the live bytes
+ */
+uint8_t compaction_due(){
+    if(compaction.renumbered > 0) return 1;
+    if(compaction.dead_bytes < COMPACT_MIN_DEAD) return 0;
+
+    char journal[LEN_PATH];
+    sidecar_path(journal, sizeof(journal), receipts_path, JOURNAL_EXT);
+    uint64_t total = file_bytes(receipts_path) + file_bytes(journal);
+    uint64_t live = (total > compaction.dead_bytes) ? total - compaction.dead_bytes : 0;
+    return compaction.dead_bytes * 100 >= live * COMPACT_DEAD_PCT;
+}
+
+/**
+ * @brief Starts compacting the receipts files on a background thread
+ *
+ * Takes a private copy of the list on the calling thread: the nodes, in
+ * list order, and the bodies that are only in memory (those written to the
+ * journal since the last rewrite). Every other body is read by the worker
+ * from the current text file, through a descriptor opened here, so later
+ * edits, rewrites and lazy reads on this thread cannot pull anything from
+ * under it. The worker writes the compacted text file, its index and
+ * (when there is one) its snapshot next to the receipts file; see
+ * compaction_finish() for the swap.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if a compaction was started, 0 if one is running or the copy failed
+ */
+uint8_t compaction_start(Receipt *head){
+    if(atomic_load(&compaction.state) != COMPACT_IDLE) return 0;
+
+    // Pending new receipts go to the file first, or the swap would write them twice
+    if(!append_flush()) return 0;
+
+    size_t count = 0;
+    size_t resident = 0;
+    Receipt *current;
+    for(current = head; current != NULL; current = current->next, count++){
+        if(current->body_off < 0) resident += current->body_len;
+    }
+
+    char journal[LEN_PATH];
+    sidecar_path(journal, sizeof(journal), receipts_path, JOURNAL_EXT);
+    struct stat st;
+    compaction.source_fd = open(receipts_path, O_RDONLY);
+    compaction.nodes = malloc((count ? count : 1) * sizeof(Receipt));
+    compaction.bodies = malloc(resident ? resident : 1);
+    if(compaction.source_fd < 0 || fstat(compaction.source_fd, &st) != 0
+       || compaction.nodes == NULL || compaction.bodies == NULL){
+        compaction_release();
+        return 0;
+    }
+    compaction.source_ino = st.st_ino;
+    compaction.source_size = st.st_size;
+    compaction.journal_size = file_bytes(journal);
+    compaction.count = count;
+    compaction.renumbered_copied = compaction.renumbered;
+
+    // Copies linked in list order; bodies on disk are left to the worker
+    size_t i = 0;
+    char *body = compaction.bodies;
+    for(current = head; current != NULL; current = current->next, i++){
+        Receipt *copy = &compaction.nodes[i];
+        *copy = *current;
+        copy->prev = (i > 0) ? &compaction.nodes[i-1] : NULL;
+        copy->next = (i + 1 < count) ? &compaction.nodes[i+1] : NULL;
+        copy->receipt = NULL;
+        if(current->body_off < 0){
+            if(current->receipt == NULL){
+                compaction_release();
+                return 0;
+            }
+            memcpy(body, current->receipt, current->body_len);
+            copy->receipt = body;
+            body += current->body_len;
+        }
+    }
+
+    snprintf(compaction.path, sizeof(compaction.path), "%s%s", receipts_path, COMPACT_EXT);
+    char snap[LEN_PATH];
+    sidecar_path(snap, sizeof(snap), receipts_path, SNAPSHOT_EXT);
+    compaction.snapshot = (access(snap, F_OK) == 0);
+
+    atomic_store(&compaction.state, COMPACT_RUNNING);
+    if(pthread_create(&compaction.thread, NULL, compaction_worker, NULL) != 0){
+        atomic_store(&compaction.state, COMPACT_IDLE);
+        compaction_release();
+        return 0;
+    }
+    custom_log(LOG_DEBUG, "Compaction started.\n");
+    return 1;
+}
+
+/**
+ * @brief Thread body of a compaction
+ *
+ * Writes the private copy of the list to compaction.path, in sorted order
+ * with every ID and body in place, then the index and snapshot for that
+ * file. Touches nothing the menu thread uses.
+ *
+ * @param arg Unused (void*)
+ * @return void* Always NULL
+ */
+void *compaction_worker(void *arg){
+    (void) arg;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    Receipt *copy = (compaction.count > 0) ? compaction.nodes : NULL;
+    off_t *offsets = malloc((compaction.count ? compaction.count : 1) * sizeof(off_t));
+    size_t source_len = 0;
+    const char *source = map_for_copy(compaction.source_fd, &source_len);
+
+    uint8_t ok = offsets != NULL && write_receipts_file(copy, compaction.path, source, source_len, offsets, 1);
+    if(source != NULL) munmap((void *) source, source_len);
+
+    // The copies now describe the new file, so its index and snapshot can be built from them
+    if(ok){
+        for(size_t i = 0; i < compaction.count; i++){
+            compaction.nodes[i].body_off = offsets[i];
+            compaction.nodes[i].receipt = NULL;
+        }
+        ok = write_index(copy, compaction.path);
+    }
+    if(ok && compaction.snapshot) compaction.snapshot = write_snapshot(copy, compaction.path);
+    free(offsets);
+
+    char sidecar[LEN_PATH];
+    compaction.bytes_written = file_bytes(compaction.path);
+    sidecar_path(sidecar, sizeof(sidecar), compaction.path, INDEX_EXT);
+    compaction.bytes_written += file_bytes(sidecar);
+    sidecar_path(sidecar, sizeof(sidecar), compaction.path, SNAPSHOT_EXT);
+    compaction.bytes_written += file_bytes(sidecar);
+
+    compaction.ok = ok;
+    compaction.worker_ms = elapsed_ms(&start);
+    atomic_store(&compaction.state, COMPACT_DONE);
+    return NULL;
+}
+
+/**
+ * @brief Tells whether a compaction is running or waiting to be swapped in
+ *
+ * @return uint8_t 1 while compaction_finish() has work to do, 0 otherwise
+ */
+uint8_t compaction_running(){
+    return atomic_load(&compaction.state) != COMPACT_IDLE;
+}
+
+/**
+ * @brief Drives background compaction from the menu loop
+ *
+ * Swaps in a compaction that has finished, or starts one when
+ * compaction_due() says so. Never waits for the worker.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ */
+void compaction_poll(Receipt *head){
+    int state = atomic_load(&compaction.state);
+    if(state == COMPACT_DONE) compaction_finish(head);
+    else if(state == COMPACT_IDLE && compaction_due()) compaction_start(head);
+}
+
+/**
+ * @brief Waits for a running compaction and swaps its files in
+ *
+ * Runs on the thread that edits the list, so nothing is written to the
+ * receipts files while the swap happens. The compacted files replace the
+ * old ones only if neither the text file nor the journal changed since
+ * compaction_start() and the list still matches the copy; an edit made
+ * while the worker ran is already in the journal, and the result is
+ * thrown away (the next poll starts over). The swap renames the index and
+ * snapshot into place, then the text file, which retires the journal;
+ * whatever a crash leaves in between is either the old set of files or a
+ * text file whose stale sidecars are ignored. Afterwards every body offset
+ * points into the new file, as after rewrite_receipts_to_file().
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if the compacted files were swapped in, 0 otherwise
+ */
+uint8_t compaction_finish(Receipt *head){
+    if(atomic_load(&compaction.state) == COMPACT_IDLE) return 0;
+    pthread_join(compaction.thread, NULL);
+
+    char journal[LEN_PATH], idx[LEN_PATH], snap[LEN_PATH], tmp_idx[LEN_PATH], tmp_snap[LEN_PATH];
+    sidecar_path(journal, sizeof(journal), receipts_path, JOURNAL_EXT);
+    sidecar_path(idx, sizeof(idx), receipts_path, INDEX_EXT);
+    sidecar_path(snap, sizeof(snap), receipts_path, SNAPSHOT_EXT);
+    sidecar_path(tmp_idx, sizeof(tmp_idx), compaction.path, INDEX_EXT);
+    sidecar_path(tmp_snap, sizeof(tmp_snap), compaction.path, SNAPSHOT_EXT);
+
+    uint64_t before = file_bytes(receipts_path) + file_bytes(journal);
+    uint8_t swapped = compaction.ok && compaction_current(head)
+        && rename(tmp_idx, idx) == 0
+        && (!compaction.snapshot || rename(tmp_snap, snap) == 0)
+        && rename(compaction.path, receipts_path) == 0;
+
+    if(swapped){
+        // The journal may only go once the new name is on disk
+        if(!sync_directory_of(receipts_path)) custom_log(LOG_WARN, "Could not sync the receipts directory.\n");
+
+        size_t i = 0;
+        for(Receipt *current = head; current != NULL; current = current->next, i++){
+            current->body_off = compaction.nodes[i].body_off;
+            current->body_slack = 0;
+            current->journaled = 0;
+            if(lazy_bodies && current->receipt != NULL){
+                body_release(current->receipt);
+                current->receipt = NULL;
+            }
+        }
+        if(lazy_bodies) open_body_source(receipts_path);
+        track_receipts_path(receipts_path, NULL);
+        journal_reset(receipts_path);
+        compaction.renumbered -= compaction.renumbered_copied;
+
+        uint64_t after = file_bytes(receipts_path);
+        compaction_totals.runs++;
+        compaction_totals.last_ms = compaction.worker_ms;
+        compaction_totals.total_ms += compaction.worker_ms;
+        compaction_totals.bytes_before += before;
+        compaction_totals.bytes_after += after;
+        compaction_totals.bytes_written += compaction.bytes_written;
+        compaction_totals.journal_bytes += compaction.journal_size;
+
+        char log_msg[LEN_LOG_MSG];
+        snprintf(log_msg, sizeof(log_msg), "Compacted, %llu KiB reclaimed.\n",
+                 (unsigned long long) ((before > after) ? before - after : 0) >> 10);
+        custom_log(LOG_INFO, log_msg);
+    }
+    else{
+        unlink(compaction.path);
+        unlink(tmp_idx);
+        unlink(tmp_snap);
+        compaction_totals.discarded++;
+        custom_log(compaction.ok ? LOG_DEBUG : LOG_WARN, compaction.ok ? "Receipts changed during compaction, discarding it.\n"
+                                                                     : "Compaction failed.\n");
+    }
+
+    compaction_release();
+    atomic_store(&compaction.state, COMPACT_IDLE);
+    return swapped;
+}
+
+/**
+ * @brief Checks that a finished compaction still describes the receipts files
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if the text file and journal are as they were copied and the list matches the copy
+ */
+uint8_t compaction_current(Receipt *head){
+    char journal[LEN_PATH];
+    sidecar_path(journal, sizeof(journal), receipts_path, JOURNAL_EXT);
+
+    struct stat st;
+    if(stat(receipts_path, &st) != 0 || st.st_ino != compaction.source_ino || st.st_size != compaction.source_size
+       || file_bytes(journal) != compaction.journal_size){
+        return 0;
+    }
+
+    size_t i = 0;
+    for(Receipt *current = head; current != NULL; current = current->next, i++){
+        if(i >= compaction.count || current->id != compaction.nodes[i].id) return 0;
+    }
+    return i == compaction.count;
+}
+
+/**
+ * @brief Frees the private copy of a compaction and closes its source
+ */
+void compaction_release(){
+    free(compaction.nodes);
+    free(compaction.bodies);
+    if(compaction.source_fd >= 0) close(compaction.source_fd);
+    compaction.nodes = NULL;
+    compaction.bodies = NULL;
+    compaction.source_fd = -1;
+    compaction.count = 0;
+}
+
+/**
+ * @brief Prints the totals of the compactions swapped in so far
+ *
+ * Reclaimed bytes are the text file and journal sizes before a compaction
+ * minus the text file size after it. Write amplification is the bytes a
+ * compaction wrote (text file, index and snapshot) per byte of journal it
+ * folded in.
+ *
+ * @param label What the numbers were taken after (const char*)
+ */
+void print_compaction_stats(const char *label){
+    const CompactionStats *st = &compaction_totals;
+    uint64_t reclaimed = (st->bytes_before > st->bytes_after) ? st->bytes_before - st->bytes_after : 0;
+    printf("%s\n", label);
+    printf("  runs:   %zu swapped in, %zu discarded, last %.2f ms, total %.2f ms\n",
+           st->runs, st->discarded, st->last_ms, st->total_ms);
+    printf("  bytes:  %llu KiB before, %llu KiB after, %llu KiB reclaimed\n",
+           (unsigned long long) st->bytes_before >> 10, (unsigned long long) st->bytes_after >> 10,
+           (unsigned long long) reclaimed >> 10);
+    printf("  writes: %llu KiB written for %llu KiB of journal (write amplification %.1fx)\n",
+           (unsigned long long) st->bytes_written >> 10, (unsigned long long) st->journal_bytes >> 10,
+           st->journal_bytes ? (double) st->bytes_written / (double) st->journal_bytes : 0.0);
+}
+
+/**
+ * @brief Returns the milliseconds elapsed since a monotonic start time
+ *
+ * @param start Start time taken with clock_gettime(CLOCK_MONOTONIC) (const struct timespec*)
+ * @return double Elapsed time in milliseconds
+ */
+double elapsed_ms(const struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * @brief Writes a synthetic receipts file for benchmarking
+ *
+ * Generates count records named "Recipe NNNNNN" with a fixed body. When
+ * shuffled is set, records are written in a deterministic pseudo-random
+ * order; otherwise they are written in alphabetical order, matching the
+ * output of rewrite_receipts_to_file(). Records have no "Id: " lines, like
+ * files written before IDs were persisted, so they load with positional IDs.
+ *
+ * @param path Destination file path (const char*)
+ * @param count Number of records to write (size_t)
+ * @param shuffled 1 for shuffled order, 0 for sorted order (uint8_t)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_bench_corpus(const char *path, size_t count, uint8_t shuffled){
+    size_t *order = malloc(count * sizeof(size_t));
+    if(order == NULL) return 0;
+
+    size_t i;
+    for(i = 0; i < count; i++) order[i] = i;
+
+    if(shuffled){
+        // Fisher-Yates with a fixed xorshift seed so runs are comparable
+        uint32_t state = 2463534242u;
+        for(i = count; i > 1; i--){
+            size_t j = xorshift32(&state) % i;
+            size_t tmp = order[i-1];
+            order[i-1] = order[j];
+            order[j] = tmp;
+        }
+    }
+
+    FILE *fptr = fopen(path, "w");
+    if(fptr == NULL){
+        free(order);
+        return 0;
+    }
+    for(i = 0; i < count; i++){
+        fprintf(fptr, "Name: Recipe %06zu\n", order[i]);
+        fprintf(fptr, "Receipt: Mix the ingredients for recipe %zu, bake for 30 minutes and serve warm.\n", order[i]);
+    }
+    fclose(fptr);
+    free(order);
+    return 1;
+}
+
+/**
+ * @brief Creates a benchmark's temporary file, once
+ *
+ * A path that still ends in the BENCH_TEMPLATE placeholder is created with
+ * mkstemp(), which fills it in; any other path is left to be overwritten.
+ *
+ * @param path Path buffer, initialized from BENCH_TEMPLATE (char*)
+ * @return uint8_t 1 if the file exists, 0 if it could not be created
+ */
+uint8_t bench_temp_file(char *path){
+    size_t len = strlen(path);
+    if(len < 6 || strcmp(path + len - 6, "XXXXXX") != 0) return 1;
+
+    int fd = mkstemp(path);
+    if(fd < 0) return 0;
+    close(fd);
+    return 1;
+}
+
+/**
+ * @brief Writes a generated corpus to a benchmark's file
+ *
+ * Creates the file on first use (see bench_temp_file()). On failure logs
+ * it and removes the file and its sidecars, so callers only return.
+ *
+ * @param path Path buffer, initialized from BENCH_TEMPLATE (char*)
+ * @param spec Shape of the corpus (const CorpusSpec*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t bench_corpus_file(char *path, const CorpusSpec *spec){
+    if(bench_temp_file(path) && write_corpus(path, spec)) return 1;
+
+    custom_log(LOG_ERROR, "Could not write benchmark corpus.\n");
+    bench_cleanup(path);
+    return 0;
+}
+
+/**
+ * @brief Writes a write_bench_corpus() file (positional IDs) for a benchmark
+ *
+ * Like bench_corpus_file(), for the loader benchmarks' original corpus.
+ *
+ * @param path Path buffer, initialized from BENCH_TEMPLATE (char*)
+ * @param count Number of records to write (size_t)
+ * @param shuffled 1 for shuffled order, 0 for sorted order (uint8_t)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t bench_positional_file(char *path, size_t count, uint8_t shuffled){
+    if(bench_temp_file(path) && write_bench_corpus(path, count, shuffled)) return 1;
+
+    custom_log(LOG_ERROR, "Could not write benchmark corpus.\n");
+    bench_cleanup(path);
+    return 0;
+}
+
+/**
+ * @brief Removes a benchmark's file with its snapshot, index and journal
+ *
+ * @param path Benchmark file (const char*)
+ */
+void bench_cleanup(const char *path){
+    const char *exts[] = {SNAPSHOT_EXT, INDEX_EXT, JOURNAL_EXT};
+    char sidecar[LEN_PATH];
+    for(size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++){
+        sidecar_path(sidecar, sizeof(sidecar), path, exts[i]);
+        unlink(sidecar);
+    }
+    unlink(path);
+}
+
+/**
+ * @brief Returns the next value of a xorshift32 generator
+ *
+ * @param state Generator state, must not be 0 (uint32_t*)
+ * @return uint32_t Next pseudo-random value
+ */
+uint32_t xorshift32(uint32_t *state){
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Parses a "MIN-MAX" (or single "N") length range
+ *
+ * @param text Range text (const char*)
+ * @param min Receives the lower bound (uint32_t*)
+ * @param max Receives the upper bound (uint32_t*)
+ * @return uint8_t 1 on success, 0 if text is not a valid range
+ */
+uint8_t parse_range(const char *text, uint32_t *min, uint32_t *max){
+    char *end;
+    unsigned long lo = strtoul(text, &end, 10);
+    unsigned long hi = lo;
+    if(end == text) return 0;
+    if(*end == '-'){
+        const char *rest = end + 1;
+        hi = strtoul(rest, &end, 10);
+        if(end == rest) return 0;
+    }
+    if(*end != '\0' || hi < lo || hi > UINT32_MAX) return 0;
+    *min = (uint32_t) lo;
+    *max = (uint32_t) hi;
+    return 1;
+}
+
+/**
+ * @brief qsort() comparator for generated names (char[LEN_NAME] rows)
+ *
+ * @param a First name (const char*)
+ * @param b Second name (const char*)
+ * @return int Negative, zero or positive like strcmp()
+ */
+int compare_names(const void *a, const void *b){
+    return case_insensitive_compare((const char *) a, (const char *) b);
+}
+
+/**
+ * @brief Corpus spec of the default shape
+ *
+ * @param count Number of records (size_t)
+ * @param shuffled_pct Percentage of records out of alphabetical order (uint8_t)
+ * @return CorpusSpec Spec with the default name and body ranges and seed
+ */
+CorpusSpec corpus_spec(size_t count, uint8_t shuffled_pct){
+    CorpusSpec spec = {
+        .count = count,
+        .name_min = CORPUS_NAME_MIN, .name_max = CORPUS_NAME_MAX,
+        .body_min = CORPUS_BODY_MIN, .body_max = CORPUS_BODY_MAX,
+        .shuffled_pct = shuffled_pct,
+        .seed = CORPUS_DEFAULT_SEED,
+    };
+    return spec;
+}
+
+/**
+ * @brief Writes a synthetic receipts file of a given shape
+ *
+ * Names are random words with lengths drawn uniformly from the spec's name
+ * range, made unique by a numeric suffix when they would fit it; bodies are
+ * words from a fixed vocabulary with lengths drawn uniformly from the body
+ * range. Name lengths are capped to what the loader keeps (LEN_NAME-1);
+ * body lengths are not capped. Records are first put in alphabetical order, then
+ * shuffled_pct percent of them, picked at random, are shuffled among
+ * themselves: 0 gives a sorted file like rewrite_receipts_to_file()
+ * writes, 100 a fully shuffled one. Each record carries an "Id: " line
+ * with its position in the file. The same spec and seed always give the
+ * same file.
+ *
+ * @param path Destination file path (const char*)
+ * @param spec Shape of the corpus (const CorpusSpec*)
+ * @return uint8_t 1 on success, 0 on failure
+ */
+uint8_t write_corpus(const char *path, const CorpusSpec *spec){
+    static const char *words[] = {
+        "mix", "the", "flour", "with", "sugar", "and", "butter", "then", "bake", "for",
+        "minutes", "at", "medium", "heat", "stir", "gently", "add", "salt", "pepper", "serve",
+        "warm", "chop", "onions", "garlic", "simmer", "until", "golden", "whisk", "eggs", "milk",
+    };
+    const size_t num_words = sizeof(words) / sizeof(words[0]);
+    uint32_t state = spec->seed ? spec->seed : CORPUS_DEFAULT_SEED;
+    size_t count = spec->count;
+    size_t i;
+
+    uint32_t name_min = spec->name_min ? spec->name_min : 1;
+    uint32_t name_max = (spec->name_max < LEN_NAME-1) ? spec->name_max : LEN_NAME-1;
+    uint32_t body_max = spec->body_max;
+    uint32_t body_min = (spec->body_min < body_max) ? spec->body_min : body_max;
+    if(name_min > name_max) name_min = name_max;
+
+    char (*names)[LEN_NAME] = malloc((count ? count : 1) * sizeof(*names));
+    size_t *order = malloc((count ? count : 1) * sizeof(size_t));
+    size_t *picked = malloc((count ? count : 1) * sizeof(size_t));
+    char *body = malloc((size_t) body_max + 1);
+    if(names == NULL || order == NULL || picked == NULL || body == NULL){
+        free(names);
+        free(order);
+        free(picked);
+        free(body);
+        return 0;
+    }
+
+    // Names: a capitalized random word, with the record number as suffix when it fits
+    for(i = 0; i < count; i++){
+        uint32_t len = name_min + xorshift32(&state) % (name_max - name_min + 1);
+        char suffix[24];
+        int suffix_len = snprintf(suffix, sizeof(suffix), " %zu", i);
+        uint32_t letters = ((uint32_t) suffix_len < len) ? len - (uint32_t) suffix_len : len;
+        for(uint32_t c = 0; c < letters; c++){
+            char letter = (char) ('a' + xorshift32(&state) % 26);
+            names[i][c] = (c == 0) ? (char) toupper((unsigned char) letter) : letter;
+        }
+        if(letters < len) memcpy(names[i] + letters, suffix, (size_t) suffix_len);
+        names[i][len] = '\0';
+    }
+    qsort(names, count, sizeof(*names), compare_names);
+
+    // Order: sorted, then a random subset shuffled among itself
+    for(i = 0; i < count; i++) order[i] = i;
+    size_t num_picked = 0;
+    for(i = 0; i < count; i++){
+        if(xorshift32(&state) % 100 < spec->shuffled_pct) picked[num_picked++] = i;
+    }
+    for(i = num_picked; i > 1; i--){
+        size_t j = xorshift32(&state) % i;
+        size_t tmp = order[picked[i-1]];
+        order[picked[i-1]] = order[picked[j]];
+        order[picked[j]] = tmp;
+    }
+
+    FILE *fptr = fopen(path, "w");
+    uint8_t ok = (fptr != NULL);
+    if(ok) setvbuf(fptr, NULL, _IOFBF, SNAPSHOT_IO_BUFFER);
+
+    for(i = 0; ok && i < count; i++){
+        // Body: words from the vocabulary, cut to the drawn length
+        uint32_t len = body_min + xorshift32(&state) % (body_max - body_min + 1);
+        uint32_t n = 0;
+        while(n < len){
+            const char *word = words[xorshift32(&state) % num_words];
+            if(n > 0){
+                if(n + 1 >= len) break;
+                body[n++] = ' ';
+            }
+            while(*word != '\0' && n < len) body[n++] = *word++;
+        }
+        body[n] = '\0';
+
+        if(fprintf(fptr, "Name: %s\nId: %zu\nReceipt: %s\n", names[order[i]], i, body) < 0) ok = 0;
+    }
+    if(fptr != NULL && fclose(fptr) != 0) ok = 0;
+
+    free(names);
+    free(order);
+    free(picked);
+    free(body);
+    return ok;
+}
+
+/**
+ * @brief Command-line front end of write_corpus()
+ *
+ * Usage: generate PATH [--count N] [--name-len MIN-MAX] [--body-len MIN-MAX]
+ * [--shuffled PCT] [--seed N]
+ *
+ * @param argc Argument count, starting at "generate" (int)
+ * @param argv Arguments, starting at "generate" (char*[])
+ * @return int Exit status (0 for success, 1 on bad arguments or I/O failure)
+ */
+int run_generate(int argc, char *argv[]){
+    CorpusSpec spec = corpus_spec(CORPUS_DEFAULT_COUNT, 100);
+    const char *path = NULL;
+    uint8_t ok = 1;
+
+    for(int i = 1; i < argc && ok; i++){
+        const char *value = (i + 1 < argc) ? argv[i+1] : NULL;
+        if(strcmp(argv[i], "--count") == 0 && value != NULL){
+            spec.count = (size_t) strtoull(value, NULL, 10);
+            i++;
+        }
+        else if(strcmp(argv[i], "--name-len") == 0 && value != NULL){
+            ok = parse_range(value, &spec.name_min, &spec.name_max);
+            i++;
+        }
+        else if(strcmp(argv[i], "--body-len") == 0 && value != NULL){
+            ok = parse_range(value, &spec.body_min, &spec.body_max);
+            i++;
+        }
+        else if(strcmp(argv[i], "--shuffled") == 0 && value != NULL){
+            unsigned long pct = strtoul(value, NULL, 10);
+            spec.shuffled_pct = (uint8_t) ((pct > 100) ? 100 : pct);
+            i++;
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && value != NULL){
+            spec.seed = (uint32_t) strtoul(value, NULL, 10);
+            i++;
+        }
+        else if(argv[i][0] != '-' && path == NULL){
+            path = argv[i];
+        }
+        else{
+            ok = 0;
+        }
+    }
+
+    if(!ok || path == NULL){
+        printf("Usage: cookbook generate PATH [--count N] [--name-len MIN-MAX] [--body-len MIN-MAX] [--shuffled PCT] [--seed N]\n");
+        return 1;
+    }
+    if(!write_corpus(path, &spec)){
+        custom_log(LOG_ERROR, "Could not write corpus.\n");
+        return 1;
+    }
+
+    char msg[LEN_LOG_MSG];
+    snprintf(msg, sizeof(msg), "%zu receipt(s) written.\n", spec.count);
+    custom_log(LOG_INFO, msg);
+    return 0;
+}
+
+/**
+ * @brief Runs the benchmark suites
+ *
+ * @param suite Suite to run ("load", "parallel", "snapshot", "lazy", "index", "startup", "scan", "corpus", "ids", "traverse", "memory", "alloc", "keys", "rank", "store", "handles", "journal", "compact", "rewrite", "append" or "patch"), or NULL for all (const char*)
+ * @return int Exit status (0 for success)
+ */
+int run_benchmarks(const char *suite){
+    int status = 0;
+
+    // Silence per-load INFO logs while timing
+    min_log_level = LOG_WARN;
+
+    if(suite == NULL || strcmp(suite, "load") == 0) status |= bench_load();
+    if(suite == NULL || strcmp(suite, "parallel") == 0) status |= bench_parallel();
+    if(suite == NULL || strcmp(suite, "snapshot") == 0) status |= bench_snapshot();
+    if(suite == NULL || strcmp(suite, "lazy") == 0) status |= bench_lazy();
+    if(suite == NULL || strcmp(suite, "index") == 0) status |= bench_index();
+    if(suite == NULL || strcmp(suite, "startup") == 0) status |= bench_startup();
+    if(suite == NULL || strcmp(suite, "scan") == 0) status |= bench_scan();
+    if(suite == NULL || strcmp(suite, "corpus") == 0) status |= bench_corpus();
+    if(suite == NULL || strcmp(suite, "ids") == 0) status |= bench_ids();
+    if(suite == NULL || strcmp(suite, "traverse") == 0) status |= bench_traverse();
+    if(suite == NULL || strcmp(suite, "memory") == 0) status |= bench_memory();
+    if(suite == NULL || strcmp(suite, "alloc") == 0) status |= bench_alloc();
+    if(suite == NULL || strcmp(suite, "keys") == 0) status |= bench_keys();
+    if(suite == NULL || strcmp(suite, "rank") == 0) status |= bench_rank();
+    if(suite == NULL || strcmp(suite, "store") == 0) status |= bench_store();
+    if(suite == NULL || strcmp(suite, "handles") == 0) status |= bench_handles();
+    if(suite == NULL || strcmp(suite, "journal") == 0) status |= bench_journal();
+    if(suite == NULL || strcmp(suite, "compact") == 0) status |= bench_compact();
+    if(suite == NULL || strcmp(suite, "rewrite") == 0) status |= bench_rewrite();
+    if(suite == NULL || strcmp(suite, "append") == 0) status |= bench_append();
+    if(suite == NULL || strcmp(suite, "patch") == 0) status |= bench_patch();
+
+    min_log_level = MIN_LOG_LEVEL;
+    return status;
+}
+
+/**
+ * @brief Benchmarks startup time of the bulk loader
+ *
+ * For 1k, 10k and 65k records, in sorted and shuffled order, times
+ * load_receipts_from() (bulk load) and, up to BENCH_LEGACY_MAX records,
+ * the previous strategy of calling insert_alphabetically() once per record.
+ *
+ * @return int Exit status (0 for success)
+ */
+int bench_load(){
+    const size_t sizes[] = {1000, 10000, 65000};
+    const char *orders[] = {"sorted", "shuffled"};
+    char path[] = BENCH_TEMPLATE;
+
+    printf("%-8s %-9s %14s %18s\n", "records", "order", "bulk load (ms)", "per-insert (ms)");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        for(uint8_t o = 0; o < 2; o++){
+            if(!bench_positional_file(path, sizes[s], o)) return 1;
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            Receipt *head = load_receipts_threads(path, 1);
+            double bulk_ms = elapsed_ms(&start);
+
+            char legacy[32] = "skipped";
+            if(sizes[s] <= BENCH_LEGACY_MAX){
+                // Re-insert the loaded nodes in file order (ID order), one by one
+                Receipt **by_id = malloc(sizes[s] * sizeof(Receipt*));
+                if(by_id != NULL){
+                    for(Receipt *cur = head; cur != NULL; cur = cur->next) by_id[cur->id] = cur;
+                    Receipt *legacy_head = NULL;
+                    clock_gettime(CLOCK_MONOTONIC, &start);
+                    for(size_t i = 0; i < sizes[s]; i++){
+                        legacy_head = insert_alphabetically(legacy_head, by_id[i]);
+                    }
+                    snprintf(legacy, sizeof(legacy), "%.2f", elapsed_ms(&start));
+                    head = legacy_head;
+                    free(by_id);
+                }
+            }
+
+            printf("%-8zu %-9s %14.2f %18s\n", sizes[s], orders[o], bulk_ms, legacy);
+            free_list(head);
+        }
+    }
+
+    bench_cleanup(path);
+    return 0;
+}
+
+/**
+ * @brief Benchmarks the parallel loader against thread count
+ *
+ * Loads a shuffled 60k-record corpus with 1, 2, 4 and 8 threads (and the
+ * online CPU count if larger), checks that each result matches the
+ * single-threaded list node for node, and reports time and speedup.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_parallel(){
+    const size_t records = 60000;
+    unsigned counts[] = {1, 2, 4, 8, 0};
+    size_t num_counts = 4;
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus > 8){
+        counts[num_counts++] = (cpus > MAX_LOAD_THREADS) ? MAX_LOAD_THREADS : (unsigned) cpus;
+    }
+
+    if(!bench_positional_file(path, records, 1)) return 1;
+
+    Receipt *reference = load_receipts_threads(path, 1);
+    double base_ms = 0;
+
+    printf("%-8s %10s %8s %7s\n", "threads", "load (ms)", "speedup", "match");
+    for(size_t c = 0; c < num_counts; c++){
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Receipt *head = load_receipts_threads(path, counts[c]);
+        double ms = elapsed_ms(&start);
+        if(c == 0) base_ms = ms;
+
+        // Compare against the single-threaded result
+        uint8_t match = 1;
+        Receipt *a = reference, *b = head;
+        while(a != NULL && b != NULL){
+            if(a->id != b->id || strcmp(a->name, b->name) != 0 || strcmp(receipt_body(a), receipt_body(b)) != 0){
+                match = 0;
+                break;
+            }
+            a = a->next;
+            b = b->next;
+        }
+        if(a != NULL || b != NULL) match = 0;
+        if(!match) status = 1;
+
+        printf("%-8u %10.2f %7.2fx %7s\n", counts[c], ms, base_ms / ms, match ? "yes" : "NO");
+        free_list(head);
+    }
+
+    free_list(reference);
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief Benchmarks loading from the binary snapshot against parsing text
+ *
+ * For 10k and 65k shuffled records, writes a snapshot next to the corpus
+ * and times a text load against a snapshot load, checking both lists match.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_snapshot(){
+    const size_t sizes[] = {10000, 65000};
+    char path[] = BENCH_TEMPLATE;
+    char snap[LEN_PATH];
+    int status = 0;
+
+    if(!bench_temp_file(path)){
+        custom_log(LOG_ERROR, "Could not create benchmark file.\n");
+        return 1;
+    }
+    sidecar_path(snap, sizeof(snap), path, SNAPSHOT_EXT);
+
+    printf("%-8s %14s %18s %7s\n", "records", "text load (ms)", "snapshot load (ms)", "match");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        if(!bench_positional_file(path, sizes[s], 1)){
+            status = 1;
+            break;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Receipt *text = load_receipts_threads(path, 1);
+        double text_ms = elapsed_ms(&start);
+
+        if(!write_snapshot(text, path)){
+            custom_log(LOG_ERROR, "Could not write snapshot.\n");
+            free_list(text);
+            status = 1;
+            break;
+        }
+
+        Receipt *binary = NULL;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint8_t used = load_snapshot(path, &binary);
+        double snap_ms = elapsed_ms(&start);
+
+        uint8_t match = used;
+        Receipt *a = text, *b = binary;
+        while(match && a != NULL && b != NULL){
+            if(a->id != b->id || strcmp(a->name, b->name) != 0 || strcmp(receipt_body(a), receipt_body(b)) != 0) match = 0;
+            a = a->next;
+            b = b->next;
+        }
+        if(a != NULL || b != NULL) match = 0;
+        if(!match) status = 1;
+
+        printf("%-8zu %14.2f %18.2f %7s\n", sizes[s], text_ms, snap_ms, match ? "yes" : "NO");
+        free_list(text);
+        free_list(binary);
+    }
+
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief Estimates the memory held by a receipt list
+ *
+ * Counts node structs plus the arena slices of in-memory bodies (chunk
+ * slack excluded).
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return size_t Bytes held by the list
+ */
+size_t list_memory(Receipt *head){
+    size_t bytes = 0;
+    for(Receipt *cur = head; cur != NULL; cur = cur->next){
+        bytes += sizeof(Receipt);
+        if(cur->receipt != NULL) bytes += body_slice_size(cur->body_len);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Benchmarks lazy body loading against eager loading
+ *
+ * Loads a 65k-record corpus from text and from a snapshot, eagerly and
+ * lazily, and reports load time and list memory. The fixed-array layout
+ * this replaced (a 1000-byte body inside every node) is shown for
+ * reference. Also times fetching 1000 bodies through the cache.
+ *
+ * @return int Exit status (0 for success)
+ */
+int bench_lazy(){
+    const size_t records = 65000;
+    const size_t fixed_node = sizeof(uint16_t) + LEN_NAME + LEN_REC_FIXED + 2 * sizeof(void*);
+    char path[] = BENCH_TEMPLATE;
+    char snap[LEN_PATH];
+
+    if(!bench_positional_file(path, records, 0)) return 1;
+    sidecar_path(snap, sizeof(snap), path, SNAPSHOT_EXT);
+
+    printf("%-22s %10s %12s\n", "mode", "load (ms)", "memory (KiB)");
+    printf("%-22s %10s %12zu\n", "fixed 1000-byte bodies", "-", records * fixed_node / 1024);
+
+    for(uint8_t from_snapshot = 0; from_snapshot < 2; from_snapshot++){
+        for(uint8_t lazy = 0; lazy < 2; lazy++){
+            lazy_bodies = lazy;
+            struct timespec start;
+            Receipt *head = NULL;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if(from_snapshot) load_snapshot(path, &head);
+            else head = load_receipts_threads(path, 1);
+            double ms = elapsed_ms(&start);
+
+            char mode[32];
+            snprintf(mode, sizeof(mode), "%s %s", lazy ? "lazy" : "eager", from_snapshot ? "snapshot" : "text");
+            printf("%-22s %10.2f %12zu\n", mode, ms, list_memory(head) / 1024);
+
+            if(!from_snapshot && !lazy) write_snapshot(head, path);
+            if(lazy && !from_snapshot){
+                // Fetch every 65th body: all cache misses
+                size_t fetched = 0;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for(Receipt *cur = head; cur != NULL; cur = cur->next){
+                    if(cur->id % 65 == 0 && receipt_body(cur) != NULL) fetched++;
+                }
+                printf("  %zu on-demand body reads: %.2f ms\n", fetched, elapsed_ms(&start));
+            }
+            free_list(head);
+        }
+    }
+
+    lazy_bodies = 0;
+    if(body_fd >= 0){
+        close(body_fd);
+        body_fd = -1;
+    }
+    bench_cleanup(path);
+    return 0;
+}
+
+/**
+ * @brief Benchmarks startup from the sidecar index against parsing text
+ *
+ * For a shuffled 65k-record corpus, times a text parse, writing the index,
+ * and loading from the index eagerly and lazily.
+ *
+ * @return int Exit status (0 for success)
+ */
+int bench_index(){
+    const size_t records = 65000;
+    char path[] = BENCH_TEMPLATE;
+    char idx[LEN_PATH];
+    int status = 0;
+
+    if(!bench_positional_file(path, records, 1)) return 1;
+    sidecar_path(idx, sizeof(idx), path, INDEX_EXT);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Receipt *head = load_receipts_threads(path, 1);
+    printf("%-20s %10.2f ms\n", "text parse", elapsed_ms(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(!write_index(head, path)) status = 1;
+    printf("%-20s %10.2f ms\n", "write index", elapsed_ms(&start));
+    free_list(head);
+
+    for(uint8_t lazy = 0; lazy < 2 && status == 0; lazy++){
+        lazy_bodies = lazy;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if(!load_index(path, &head)) status = 1;
+        printf("%-20s %10.2f ms\n", lazy ? "index load (lazy)" : "index load (eager)", elapsed_ms(&start));
+        free_list(head);
+    }
+
+    lazy_bodies = 0;
+    if(body_fd >= 0){
+        close(body_fd);
+        body_fd = -1;
+    }
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief Benchmarks time-to-first-frame with blocking and background loads
+ *
+ * For a shuffled 65k-record corpus (text only, no snapshot or index),
+ * measures how long main() takes before the menu can draw: the whole load
+ * when blocking, only the thread start with the background loader. The
+ * time until the background list is ready (including the index rebuild a
+ * text load triggers) is reported as well.
+ *
+ * @return int Exit status (0 for success)
+ */
+int bench_startup(){
+    const size_t records = 65000;
+    char path[] = BENCH_TEMPLATE;
+
+    if(!bench_positional_file(path, records, 1)) return 1;
+
+    const char *saved_path = receipts_path;
+    receipts_path = path;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Receipt *head = load_receipts_threads(path, 0);
+    double blocking_ms = elapsed_ms(&start);
+    free_list(head);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    start_background_load();
+    double first_frame_ms = elapsed_ms(&start);
+    head = wait_for_load(NULL);
+    double ready_ms = elapsed_ms(&start);
+    free_list(head);
+
+    // Allow another background load in this process
+    background_load.done = 0;
+    background_load.collected = 0;
+    background_load.head = NULL;
+
+    printf("%-28s %10s %12s\n", "startup", "first frame", "list ready");
+    printf("%-28s %8.2f ms %9.2f ms\n", "blocking load_receipts()", blocking_ms, blocking_ms);
+    printf("%-28s %8.3f ms %9.2f ms\n", "background load", first_frame_ms, ready_ms);
+
+    // The background path also wrote the sidecar index
+    receipts_path = saved_path;
+    bench_cleanup(path);
+    return 0;
+}
+
+/**
+ * @brief Counts the records in a buffer with one memchr() call per line
+ *
+ * This is the loader's previous line walk, kept as the scanner benchmark's
+ * baseline.
+ *
+ * @param data Start of the buffer (const char*)
+ * @param len Length of the buffer in bytes (size_t)
+ * @return size_t Number of "Receipt: " lines that follow a "Name: " line
+ */
+size_t count_records_memchr(const char *data, size_t len){
+    const char *p = data;
+    const char *end = data + len;
+    size_t records = 0;
+    uint8_t named = 0;
+
+    while(p < end){
+        const char *eol = memchr(p, '\n', (size_t) (end - p));
+        if(eol == NULL) eol = end;
+        size_t line_len = (size_t) (eol - p);
+        if(line_len >= LEN_PREFIX_NAME && memcmp(p, "Name: ", LEN_PREFIX_NAME) == 0) named = 1;
+        else if(named && line_len >= LEN_PREFIX_RECEIPT && memcmp(p, "Receipt: ", LEN_PREFIX_RECEIPT) == 0){
+            records++;
+            named = 0;
+        }
+        p = eol + 1;
+    }
+    return records;
+}
+
+/**
+ * @brief Counts the records in a buffer with the selected line scanner
+ *
+ * @param data Start of the buffer (const char*)
+ * @param len Length of the buffer in bytes (size_t)
+ * @return size_t Number of "Receipt: " lines that follow a "Name: " line
+ */
+size_t count_records_scanner(const char *data, size_t len){
+    LineScanner scanner;
+    size_t pos = 0;
+    size_t records = 0;
+    uint8_t named = 0;
+
+    line_scanner_init(&scanner, data, len);
+    while(pos < len){
+        const char *p = data + pos;
+        const char *nl;
+        size_t eol;
+        if(newline_mask != NULL) eol = line_scanner_next(&scanner);
+        else eol = ((nl = memchr(p, '\n', len - pos)) != NULL) ? (size_t) (nl - data) : len;
+        size_t line_len = eol - pos;
+        if(line_len >= LEN_PREFIX_NAME && memcmp(p, "Name: ", LEN_PREFIX_NAME) == 0) named = 1;
+        else if(named && line_len >= LEN_PREFIX_RECEIPT && memcmp(p, "Receipt: ", LEN_PREFIX_RECEIPT) == 0){
+            records++;
+            named = 0;
+        }
+        pos = eol + 1;
+    }
+    return records;
+}
+
+/**
+ * @brief Benchmarks the newline scanners on a 100 MB corpus
+ *
+ * Writes a shuffled corpus of about BENCH_SCAN_BYTES, maps it and times a
+ * record count with the previous memchr() line walk and with each line
+ * scanner the CPU supports (best of BENCH_SCAN_RUNS), checking that all
+ * of them count the same records.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_scan(){
+    const char *scanners[] = {"memchr", "sse2", "avx2"};
+    const char *best = newline_scanner;
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    // Corpus records average a little under 100 bytes
+    if(!bench_positional_file(path, BENCH_SCAN_BYTES / 96, 1)) return 1;
+
+    struct stat st;
+    char *data = MAP_FAILED;
+    int fd = open(path, O_RDONLY);
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0){
+        data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if(fd >= 0) close(fd);
+    bench_cleanup(path);
+    if(data == MAP_FAILED){
+        custom_log(LOG_ERROR, "Could not map benchmark corpus.\n");
+        return 1;
+    }
+    size_t len = (size_t) st.st_size;
+
+    // Warm the page cache and the mapping
+    size_t expected = count_records_memchr(data, len);
+
+    printf("%-8s %10s %10s %10s %7s\n", "scanner", "scan (ms)", "MB/s", "records", "match");
+    for(int s = -1; s < (int) (sizeof(scanners) / sizeof(scanners[0])); s++){
+        const char *label = (s < 0) ? "baseline" : scanners[s];
+        if(s >= 0 && !select_newline_scanner(scanners[s])){
+            printf("%-8s %10s\n", label, "n/a");
+            continue;
+        }
+
+        double best_ms = 0;
+        size_t records = 0;
+        for(int run = 0; run < BENCH_SCAN_RUNS; run++){
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            records = (s < 0) ? count_records_memchr(data, len) : count_records_scanner(data, len);
+            double ms = elapsed_ms(&start);
+            if(run == 0 || ms < best_ms) best_ms = ms;
+        }
+        if(records != expected) status = 1;
+
+        printf("%-8s %10.2f %10.0f %10zu %7s\n", label, best_ms,
+               len / 1e6 / (best_ms / 1000.0), records, (records == expected) ? "yes" : "NO");
+    }
+    printf("Bytes scanned: %zu, loader uses: %s\n", len, best);
+
+    select_newline_scanner(best);
+    munmap(data, len);
+    return status;
+}
+
+/**
+ * @brief Prints one CSV row of the corpus benchmark
+ *
+ * @param spec Corpus the operation ran against (const CorpusSpec*)
+ * @param operation Operation name (const char*)
+ * @param ops Number of operations timed (size_t)
+ * @param ms Total time in milliseconds (double)
+ */
+void print_corpus_row(const CorpusSpec *spec, const char *operation, size_t ops, double ms){
+    printf("%zu,%u,%u-%u,%u-%u,%s,%zu,%.3f,%.1f\n", spec->count, spec->shuffled_pct,
+           spec->name_min, spec->name_max, spec->body_min, spec->body_max,
+           operation, ops, ms, ops ? ms * 1e6 / (double) ops : 0.0);
+}
+
+/**
+ * @brief Benchmarks the core operations against generated corpora
+ *
+ * For 1k, 10k, 65535 and 100k records, each sorted, 10% shuffled and fully
+ * shuffled, writes a corpus with write_corpus() and times load_receipts(),
+ * BENCH_CORPUS_OPS calls of insert_alphabetically(), find_receipt() and
+ * find_receipt_by_name(), and one rewrite_receipts_to_file(). Output is CSV
+ * (one row per operation, with a header) so runs can be compared by script.
+ *
+ * @return int Exit status (0 for success, 1 on I/O failure)
+ */
+int bench_corpus(){
+    const size_t sizes[] = {1000, 10000, 65535, 100000};
+    const uint8_t mixes[] = {0, 10, 100};
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    const char *saved_path = receipts_path;
+    receipts_path = path;
+
+    printf("records,shuffled_pct,name_len,body_len,operation,ops,total_ms,ns_per_op\n");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && status == 0; s++){
+        for(size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++){
+            CorpusSpec spec = corpus_spec(sizes[s], mixes[m]);
+            if(!bench_corpus_file(path, &spec)){
+                status = 1;
+                break;
+            }
+            uint32_t state = CORPUS_DEFAULT_SEED;
+            struct timespec start;
+            size_t i;
+
+            // Load (text parse plus index rebuild, as on a first start)
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            Receipt *head = load_receipts();
+            print_corpus_row(&spec, "load", spec.count, elapsed_ms(&start));
+
+            // Nodes by position, to pick lookup targets outside the timed loops
+            Receipt **nodes = malloc(spec.count * sizeof(Receipt*));
+            Receipt **fresh = malloc(BENCH_CORPUS_OPS * sizeof(Receipt*));
+            if(nodes == NULL || fresh == NULL){
+                free(nodes);
+                free(fresh);
+                free_list(head);
+                status = 1;
+                break;
+            }
+            i = 0;
+            for(Receipt *cur = head; cur != NULL; cur = cur->next) nodes[i++] = cur;
+            size_t loaded = i;
+
+            // Lookups by ID and by name
+            size_t hits = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < BENCH_CORPUS_OPS; i++){
+                if(find_receipt(head, (uint32_t) (xorshift32(&state) % spec.count)) != NULL) hits++;
+            }
+            print_corpus_row(&spec, "lookup_id", BENCH_CORPUS_OPS, elapsed_ms(&start));
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < BENCH_CORPUS_OPS && loaded > 0; i++){
+                if(find_receipt_by_name(head, nodes[xorshift32(&state) % loaded]->name) != NULL) hits++;
+            }
+            print_corpus_row(&spec, "lookup_name", BENCH_CORPUS_OPS, elapsed_ms(&start));
+
+            // Inserts of new names, removed again before the rewrite
+            size_t made = 0;
+            for(i = 0; i < BENCH_CORPUS_OPS; i++){
+                fresh[i] = node_alloc();
+                if(fresh[i] == NULL) break;
+                memset(fresh[i], 0, sizeof(Receipt));
+                char name[LEN_NAME];
+                uint32_t len = CORPUS_NAME_MIN + xorshift32(&state) % (CORPUS_NAME_MAX - CORPUS_NAME_MIN + 1);
+                for(uint32_t c = 0; c < len; c++) name[c] = (char) ('a' + xorshift32(&state) % 26);
+                set_receipt_name(fresh[i], name, len);
+                fresh[i]->body_off = -1;
+                made++;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < made; i++){
+                head = insert_alphabetically(head, fresh[i]);
+            }
+            print_corpus_row(&spec, "insert", made, elapsed_ms(&start));
+            for(i = 0; i < made; i++){
+                head = detach_receipt(head, fresh[i]);
+                node_free(fresh[i]);
+            }
+
+            // Full rewrite (text file, snapshot and index)
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if(!rewrite_receipts_to_file(head)) status = 1;
+            print_corpus_row(&spec, "rewrite", spec.count, elapsed_ms(&start));
+
+            free(nodes);
+            free(fresh);
+            free_list(head);
+            bench_cleanup(path);  // The next corpus loads from text, as on a first start
+            if(hits == 0 && loaded > 0) status = 1;
+        }
+    }
+
+    bench_cleanup(path);
+    receipts_path = saved_path;
+    return status;
+}
+
+/**
+ * @brief Benchmarks ID lookups through the ID index against a list walk
+ *
+ * Loads a shuffled 65535-record corpus and times BENCH_ID_OPS random ID
+ * lookups with find_receipt_linear() (what view, update and delete used to
+ * do) and with find_receipt(), checking both return the same nodes. The
+ * one-off index build is reported separately.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_ids(){
+    const size_t records = 65535;
+    CorpusSpec spec = corpus_spec(records, 100);
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+
+    Receipt *head = load_receipts_threads(path, 1);
+    Receipt **linear = malloc(BENCH_ID_OPS * sizeof(Receipt*));
+    uint32_t *ids = malloc(BENCH_ID_OPS * sizeof(uint32_t));
+    if(linear == NULL || ids == NULL){
+        free(linear);
+        free(ids);
+        free_list(head);
+        bench_cleanup(path);
+        return 1;
+    }
+    uint32_t state = CORPUS_DEFAULT_SEED;
+    for(size_t i = 0; i < BENCH_ID_OPS; i++) ids[i] = (uint32_t) (xorshift32(&state) % records);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_ID_OPS; i++) linear[i] = find_receipt_linear(head, ids[i]);
+    double linear_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    id_index_sync(head);
+    double build_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t mismatches = 0;
+    for(size_t i = 0; i < BENCH_ID_OPS; i++){
+        if(find_receipt(head, ids[i]) != linear[i]) mismatches++;
+    }
+    double indexed_ms = elapsed_ms(&start);
+    if(mismatches > 0) status = 1;
+
+    printf("%zu records, %d random ID lookups\n", records, BENCH_ID_OPS);
+    printf("%-14s %12s %12s\n", "lookup", "total (ms)", "per op (ns)");
+    printf("%-14s %12.2f %12.1f\n", "list walk", linear_ms, linear_ms * 1e6 / BENCH_ID_OPS);
+    printf("%-14s %12.2f %12.1f\n", "ID index", indexed_ms, indexed_ms * 1e6 / BENCH_ID_OPS);
+    printf("Index build: %.2f ms, speedup: %.0fx, match: %s\n", build_ms, linear_ms / indexed_ms, mismatches ? "NO" : "yes");
+
+    free(linear);
+    free(ids);
+    free_list(head);
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief Benchmarks list traversals against the name table's hot records
+ *
+ * Loads a sorted and a shuffled 65535-record corpus and times, through the
+ * next pointers and through the contiguous hot records: an ordered walk
+ * reading what display_receipts() prints, a scan for an ID that is not
+ * there, and BENCH_ID_OPS name searches (binary search through node
+ * handles, as the table did before it held keys, against the hot keys).
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_traverse(){
+    const size_t records = 65535;
+    const uint8_t shuffles[] = {0, 100};
+    int status = 0;
+
+    printf("sizeof(Receipt) = %zu, sizeof(HotRecord) = %zu, %zu records\n", sizeof(Receipt), sizeof(HotRecord), records);
+    printf("%-9s %-12s %12s %12s %9s\n", "corpus", "traversal", "list (ms)", "hot (ms)", "speedup");
+    for(size_t c = 0; c < sizeof(shuffles) / sizeof(shuffles[0]); c++){
+        CorpusSpec spec = corpus_spec(records, shuffles[c]);
+        char path[] = BENCH_TEMPLATE;
+        if(!bench_corpus_file(path, &spec)) return 1;
+
+        Receipt *head = load_receipts_threads(path, 1);
+        char **names = malloc(BENCH_ID_OPS * sizeof(char*));
+        if(names == NULL || !name_table_sync(head)){
+            free(names);
+            free_list(head);
+            bench_cleanup(path);
+            return 1;
+        }
+        const char *corpus = shuffles[c] ? "shuffled" : "sorted";
+        uint32_t state = CORPUS_DEFAULT_SEED;
+        for(size_t i = 0; i < BENCH_ID_OPS; i++) names[i] = name_table.items[xorshift32(&state) % name_table.count].node->name;
+
+        // Ordered walk: ID and name of every record
+        struct timespec start;
+        size_t list_sum = 0, hot_sum = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(int run = 0; run < BENCH_TRAVERSE_RUNS; run++){
+            for(Receipt *current = head; current != NULL; current = current->next) list_sum += current->id + (unsigned char) current->name[0];
+        }
+        double list_ms = elapsed_ms(&start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(int run = 0; run < BENCH_TRAVERSE_RUNS; run++){
+            for(size_t i = 0; i < name_table.count; i++) hot_sum += name_table.items[i].id + (unsigned char) name_table.items[i].node->name[0];
+        }
+        double hot_ms = elapsed_ms(&start);
+        if(list_sum != hot_sum) status = 1;
+        printf("%-9s %-12s %12.2f %12.2f %8.1fx\n", corpus, "walk", list_ms, hot_ms, list_ms / hot_ms);
+
+        // ID scan for an ID no record has
+        size_t list_hits = 0, hot_hits = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(int run = 0; run < BENCH_TRAVERSE_RUNS; run++){
+            if(find_receipt_linear(head, UINT32_MAX) != NULL) list_hits++;
+        }
+        list_ms = elapsed_ms(&start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(int run = 0; run < BENCH_TRAVERSE_RUNS; run++){
+            for(size_t i = 0; i < name_table.count; i++){
+                if(name_table.items[i].id == UINT32_MAX){
+                    hot_hits++;
+                    break;
+                }
+            }
+        }
+        hot_ms = elapsed_ms(&start);
+        if(list_hits != hot_hits) status = 1;
+        printf("%-9s %-12s %12.2f %12.2f %8.1fx\n", corpus, "id scan", list_ms, hot_ms, list_ms / hot_ms);
+
+        // Name searches: through node handles, then through the hot keys
+        size_t handle_pos = 0, hot_pos = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t i = 0; i < BENCH_ID_OPS; i++){
+            size_t lo = 0, hi = name_table.count;
+            while(lo < hi){
+                size_t mid = lo + (hi - lo) / 2;
+                if(case_insensitive_compare(name_table.items[mid].node->name, names[i]) < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            handle_pos += lo;
+        }
+        list_ms = elapsed_ms(&start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t i = 0; i < BENCH_ID_OPS; i++){
+            char folded[LEN_NAME];
+            fold_name(folded, names[i]);
+            hot_pos += name_table_lower_bound(name_key(folded), folded);
+        }
+        hot_ms = elapsed_ms(&start);
+        if(handle_pos != hot_pos) status = 1;
+        printf("%-9s %-12s %12.2f %12.2f %8.1fx\n", corpus, "name search", list_ms, hot_ms, list_ms / hot_ms);
+
+        free(names);
+        free_list(head);
+        bench_cleanup(path);
+    }
+    if(status != 0) custom_log(LOG_ERROR, "Hot records disagree with the list.\n");
+    return status;
+}
+
+/**
+ * @brief Measures the memory held by the bodies of a list
+ *
+ * Walks the list through each slice's length prefix and counts the arena
+ * chunks the bodies live in, each chunk once.
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @param live Receives the bytes of live slices (size_t*)
+ * @param reserved Receives the bytes of the chunks holding them, headers included (size_t*)
+ * @return uint8_t 1 on success, 0 on allocation failure
+ */
+uint8_t body_memory(Receipt *head, size_t *live, size_t *reserved){
+    size_t count = 0;
+    *live = 0;
+    *reserved = 0;
+    for(Receipt *cur = head; cur != NULL; cur = cur->next){
+        if(cur->receipt != NULL) count++;
+    }
+    const void **chunks = malloc((count ? count : 1) * sizeof(void*));
+    if(chunks == NULL) return 0;
+
+    size_t i = 0;
+    for(Receipt *cur = head; cur != NULL; cur = cur->next){
+        if(cur->receipt == NULL) continue;
+        *live += body_slice_size(body_slice_len(cur->receipt));
+        chunks[i++] = body_chunk(cur->receipt);
+    }
+
+    // Each chunk once: sort the addresses and skip repeats
+    qsort(chunks, count, sizeof(void*), compare_pointers);
+    for(i = 0; i < count; i++){
+        if(i > 0 && chunks[i] == chunks[i-1]) continue;
+        const BodyChunk *chunk = chunks[i];
+        *reserved += sizeof(BodyChunk) + chunk->size;
+    }
+    free(chunks);
+    return 1;
+}
+
+/**
+ * @brief qsort() comparator ordering pointers by address
+ *
+ * @param a Pointer to the first element (const void* const*)
+ * @param b Pointer to the second element (const void* const*)
+ * @return int Negative, zero or positive
+ */
+int compare_pointers(const void *a, const void *b){
+    uintptr_t pa = (uintptr_t) *(const void * const *) a;
+    uintptr_t pb = (uintptr_t) *(const void * const *) b;
+    return (pa > pb) - (pa < pb);
+}
+
+/**
+ * @brief Reports body memory of the fixed-array, per-body and arena layouts
+ *
+ * Loads two 65535-record corpora, one with the generator's default short
+ * bodies and one with bodies spread up to BENCH_MEMORY_BODY_MAX bytes, and
+ * compares the memory the bodies take:
+ *
+ * - fixed: a LEN_REC_FIXED-byte array inside every node, which also cuts
+ *   every longer body short
+ * - malloc: one heap block per body, with glibc's 8-byte header and 16-byte
+ *   rounding (estimated, minimum block 32 bytes)
+ * - arena: length-prefixed slices in shared chunks, as loaded (measured)
+ *
+ * @return int Exit status (0 for success, 1 on I/O failure or a cut body)
+ */
+int bench_memory(){
+    const size_t records = 65535;
+    const uint32_t body_ranges[][2] = {
+        {CORPUS_BODY_MIN, CORPUS_BODY_MAX},
+        {BENCH_MEMORY_BODY_MIN, BENCH_MEMORY_BODY_MAX},
+    };
+    int status = 0;
+
+    printf("%zu records per corpus\n", records);
+    printf("%-10s %-24s %14s %9s\n", "bodies", "layout", "memory (KiB)", "vs text");
+    for(size_t c = 0; c < sizeof(body_ranges) / sizeof(body_ranges[0]); c++){
+        CorpusSpec spec = {
+            .count = records,
+            .name_min = CORPUS_NAME_MIN, .name_max = CORPUS_NAME_MAX,
+            .body_min = body_ranges[c][0], .body_max = body_ranges[c][1],
+            .shuffled_pct = 0,
+            .seed = CORPUS_DEFAULT_SEED,
+        };
+        char path[] = BENCH_TEMPLATE;
+        if(!bench_corpus_file(path, &spec)) return 1;
+
+        Receipt *head = load_receipts_threads(path, 1);
+        size_t count = 0, text = 0, fixed = 0, heap = 0, cut = 0, longest = 0;
+        for(Receipt *cur = head; cur != NULL; cur = cur->next){
+            count++;
+            text += cur->body_len;
+            fixed += LEN_REC_FIXED;
+            if(cur->body_len > LEN_REC_FIXED - 1) cut++;
+            if(cur->body_len > longest) longest = cur->body_len;
+            size_t block = (cur->body_len + 1 + sizeof(size_t) + 15) & ~(size_t) 15;
+            heap += (block < 32) ? 32 : block;
+        }
+        size_t live = 0, reserved = 0;
+        if(!body_memory(head, &live, &reserved)) status = 1;
+        // Every body must come back whole: the longest ones reach the top of the range
+        if(count != records || longest + 16 < spec.body_max) status = 1;
+
+        char shape[24];
+        snprintf(shape, sizeof(shape), "%u-%u", spec.body_min, spec.body_max);
+        printf("%-10s %-24s %14zu %8.2fx\n", shape, "text", text / 1024, 1.0);
+        printf("%-10s %-24s %14zu %8.2fx  (%zu bodies cut at %d bytes)\n", shape, "fixed-size array", fixed / 1024, (double) fixed / text, cut, LEN_REC_FIXED - 1);
+        printf("%-10s %-24s %14zu %8.2fx\n", shape, "malloc per body (est.)", heap / 1024, (double) heap / text);
+        printf("%-10s %-24s %14zu %8.2fx\n", shape, "arena slices", live / 1024, (double) live / text);
+        printf("%-10s %-24s %14zu %8.2fx\n", shape, "arena chunks", reserved / 1024, (double) reserved / text);
+
+        free_list(head);
+        bench_cleanup(path);
+    }
+    return status;
+}
+
+/**
+ * @brief Benchmarks the node pool against one malloc() per node
+ *
+ * Times allocating and freeing 65535 nodes with malloc()/free() and with
+ * node_alloc()/node_pool_reset(), then loads a shuffled 65535-record
+ * corpus, deletes and re-creates 10% of it, and prints the allocator
+ * statistics at each step. Finally compares tearing a loaded list down
+ * node by node with free_list() against teardown_receipts().
+ *
+ * @return int Exit status (0 for success, 1 on I/O failure or if deleted slots are not reused)
+ */
+int bench_alloc(){
+    const size_t records = 65535;
+    const size_t churn = records / 10;
+    CorpusSpec spec = corpus_spec(records, 100);
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+    Receipt **nodes = malloc(records * sizeof(Receipt*));
+    if(nodes == NULL){
+        bench_cleanup(path);
+        return 1;
+    }
+
+    // Nothing from earlier suites is alive: start from an empty pool
+    teardown_receipts();
+
+    // Raw allocation and teardown
+    struct timespec start;
+    size_t i;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < records; i++){
+        nodes[i] = malloc(sizeof(Receipt));
+        if(nodes[i] != NULL) nodes[i]->id = (uint32_t) i;
+    }
+    double malloc_ms = elapsed_ms(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < records; i++) free(nodes[i]);
+    double free_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < records; i++){
+        nodes[i] = node_alloc();
+        if(nodes[i] != NULL) nodes[i]->id = (uint32_t) i;
+    }
+    double pool_ms = elapsed_ms(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    node_pool_reset();
+    double reset_ms = elapsed_ms(&start);
+
+    printf("%zu nodes of %zu bytes\n", records, sizeof(Receipt));
+    printf("%-20s %12s %12s\n", "", "malloc (ms)", "pool (ms)");
+    printf("%-20s %12.2f %12.2f\n", "allocate", malloc_ms, pool_ms);
+    printf("%-20s %12.2f %12.3f\n", "free all", free_ms, reset_ms);
+
+    // Load, then delete and re-create 10%: the freed slots are reused
+    Receipt *head = load_receipts_threads(path, 1);
+    print_allocator_stats("after load");
+    i = 0;
+    for(Receipt *cur = head; cur != NULL; cur = cur->next) nodes[i++] = cur;
+    size_t loaded = i;
+    uint32_t state = CORPUS_DEFAULT_SEED;
+    for(i = 0; i < churn && loaded > 0; i++){
+        size_t k = xorshift32(&state) % loaded;
+        head = detach_receipt(head, nodes[k]);
+        body_release(nodes[k]->receipt);
+        node_free(nodes[k]);
+        nodes[k] = nodes[--loaded];
+    }
+    print_allocator_stats("after deleting 10%");
+    AllocatorStats before;
+    allocator_stats(&before);
+    for(i = 0; i < churn; i++){
+        Receipt *node = node_alloc();
+        if(node == NULL) break;
+        memset(node, 0, sizeof(Receipt));
+        char name[LEN_NAME];
+        set_receipt_name(node, name, (size_t) snprintf(name, sizeof(name), "Churn %zu", i));
+        node->id = (uint32_t) (records + i);
+        if(!set_receipt_body(node, "re-created", 10)){
+            node_free(node);
+            break;
+        }
+        head = insert_alphabetically(head, node);
+    }
+    print_allocator_stats("after re-creating them");
+    AllocatorStats after;
+    allocator_stats(&after);
+    if(after.slabs != before.slabs || after.recycled - before.recycled != churn) status = 1;
+
+    // Teardown of a loaded list
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    free_list(head);
+    double list_ms = elapsed_ms(&start);
+    head = load_receipts_threads(path, 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    teardown_receipts();
+    double teardown_ms = elapsed_ms(&start);
+    printf("teardown of %zu loaded records: free_list() %.2f ms, teardown_receipts() %.3f ms\n", records, list_ms, teardown_ms);
+    print_allocator_stats("after teardown");
+
+    free(nodes);
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief qsort() comparator ordering receipts with case_insensitive_compare()
+ *
+ * The comparator compare_receipts() replaced, kept for the keys benchmark.
+ *
+ * @param a Pointer to the first element (const Receipt**)
+ * @param b Pointer to the second element (const Receipt**)
+ * @return int Negative, zero or positive like strcmp()
+ */
+int compare_receipts_tolower(const void *a, const void *b){
+    const Receipt *ra = *(const Receipt * const *) a;
+    const Receipt *rb = *(const Receipt * const *) b;
+    int cmp = case_insensitive_compare(ra->name, rb->name);
+    if(cmp != 0) return cmp;
+    return (ra->id > rb->id) - (ra->id < rb->id);
+}
+
+/**
+ * @brief Benchmarks ordering comparisons on folded sort keys against tolower()
+ *
+ * Sorts the nodes of a shuffled 65535-record corpus, in the same shuffled
+ * order each time, with compare_receipts_tolower() and with
+ * compare_receipts(), and checks both give the same order. Names are
+ * generated to share long prefixes in one run, so that the key tie-break
+ * path is timed as well.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_keys(){
+    const size_t records = 65535;
+    const uint32_t name_ranges[][2] = {
+        {CORPUS_NAME_MIN, CORPUS_NAME_MAX},
+        {CORPUS_NAME_MAX, CORPUS_NAME_MAX},
+    };
+    int status = 0;
+
+    printf("%zu records, qsort() of the shuffled nodes\n", records);
+    printf("%-10s %16s %16s %9s\n", "name len", "tolower (ms)", "keys (ms)", "speedup");
+    for(size_t c = 0; c < sizeof(name_ranges) / sizeof(name_ranges[0]); c++){
+        CorpusSpec spec = {
+            .count = records,
+            .name_min = name_ranges[c][0], .name_max = name_ranges[c][1],
+            .body_min = CORPUS_BODY_MIN, .body_max = CORPUS_BODY_MIN,
+            .shuffled_pct = 100,
+            .seed = CORPUS_DEFAULT_SEED,
+        };
+        char path[] = BENCH_TEMPLATE;
+        if(!bench_corpus_file(path, &spec)) return 1;
+
+        Receipt *head = load_receipts_threads(path, 1);
+        Receipt **shuffled = malloc(records * sizeof(Receipt*));
+        Receipt **by_tolower = malloc(records * sizeof(Receipt*));
+        Receipt **by_keys = malloc(records * sizeof(Receipt*));
+        size_t count = 0;
+        if(shuffled != NULL && by_tolower != NULL && by_keys != NULL){
+            for(Receipt *cur = head; cur != NULL && count < records; cur = cur->next) shuffled[count++] = cur;
+        }
+        uint32_t state = CORPUS_DEFAULT_SEED;
+        for(size_t i = count; i > 1; i--){
+            size_t j = xorshift32(&state) % i;
+            Receipt *tmp = shuffled[i-1];
+            shuffled[i-1] = shuffled[j];
+            shuffled[j] = tmp;
+        }
+
+        struct timespec start;
+        memcpy(by_tolower, shuffled, count * sizeof(Receipt*));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        qsort(by_tolower, count, sizeof(Receipt*), compare_receipts_tolower);
+        double tolower_ms = elapsed_ms(&start);
+
+        memcpy(by_keys, shuffled, count * sizeof(Receipt*));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        qsort(by_keys, count, sizeof(Receipt*), compare_receipts);
+        double keys_ms = elapsed_ms(&start);
+
+        if(count != records || memcmp(by_tolower, by_keys, count * sizeof(Receipt*)) != 0) status = 1;
+
+        char shape[24];
+        snprintf(shape, sizeof(shape), "%u-%u", spec.name_min, spec.name_max);
+        printf("%-10s %16.2f %16.2f %8.1fx\n", shape, tolower_ms, keys_ms, tolower_ms / keys_ms);
+
+        free(shuffled);
+        free(by_tolower);
+        free(by_keys);
+        free_list(head);
+        bench_cleanup(path);
+    }
+    if(status != 0) custom_log(LOG_ERROR, "Sort key order disagrees with case_insensitive_compare().\n");
+    return status;
+}
+
+/**
+ * @brief Benchmarks rank and select queries against walking the list
+ *
+ * Loads a shuffled 65535-record corpus and times BENCH_RANK_OPS random
+ * select-by-rank and rank-of-ID queries, counting next pointers from the
+ * head against select_receipt() and receipt_rank(), and checks that both
+ * give the same answers.
+ *
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
+ */
+int bench_rank(){
+    const size_t records = 65535;
+    CorpusSpec spec = corpus_spec(records, 100);
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+
+    Receipt *head = load_receipts_threads(path, 1);
+    Receipt **walked = malloc(BENCH_RANK_OPS * sizeof(Receipt*));
+    size_t *ranks = malloc(BENCH_RANK_OPS * sizeof(size_t));
+    uint32_t *ids = malloc(BENCH_RANK_OPS * sizeof(uint32_t));
+    if(walked == NULL || ranks == NULL || ids == NULL){
+        free(walked);
+        free(ranks);
+        free(ids);
+        teardown_receipts();
+        bench_cleanup(path);
+        return 1;
+    }
+    uint32_t state = CORPUS_DEFAULT_SEED;
+    for(size_t i = 0; i < BENCH_RANK_OPS; i++){
+        ranks[i] = xorshift32(&state) % records;
+        ids[i] = (uint32_t) (xorshift32(&state) % records);
+    }
+
+    // Select: walk from the head against the ordered store
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_RANK_OPS; i++){
+        Receipt *current = head;
+        for(size_t n = ranks[i]; current != NULL && n > 0; n--) current = current->next;
+        walked[i] = current;
+    }
+    double walk_select_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    store_sync(head);
+    id_index_sync(head);
+    double build_ms = elapsed_ms(&start);
+
+    size_t mismatches = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_RANK_OPS; i++){
+        if(select_receipt(head, ranks[i]) != walked[i]) mismatches++;
+    }
+    double select_ms = elapsed_ms(&start);
+
+    // Rank: count from the head until the ID turns up against index + table
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_RANK_OPS; i++){
+        size_t n = 0;
+        Receipt *current = head;
+        while(current != NULL && current->id != ids[i]){
+            current = current->next;
+            n++;
+        }
+        ranks[i] = n;
+    }
+    double walk_rank_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_RANK_OPS; i++){
+        size_t rank = 0;
+        if(!receipt_rank(head, ids[i], &rank) || rank != ranks[i]) mismatches++;
+    }
+    double rank_ms = elapsed_ms(&start);
+    if(mismatches > 0) status = 1;
+
+    printf("%zu records, %d random queries each\n", records, BENCH_RANK_OPS);
+    printf("%-24s %12s %12s\n", "query", "total (ms)", "per op (ns)");
+    printf("%-24s %12.2f %12.1f\n", "select: list walk", walk_select_ms, walk_select_ms * 1e6 / BENCH_RANK_OPS);
+    printf("%-24s %12.2f %12.1f\n", "select: store", select_ms, select_ms * 1e6 / BENCH_RANK_OPS);
+    printf("%-24s %12.2f %12.1f\n", "rank of ID: list walk", walk_rank_ms, walk_rank_ms * 1e6 / BENCH_RANK_OPS);
+    printf("%-24s %12.2f %12.1f\n", "rank of ID: index+store", rank_ms, rank_ms * 1e6 / BENCH_RANK_OPS);
+    printf("Store and index build: %.2f ms, match: %s\n", build_ms, mismatches ? "NO" : "yes");
+
+    free(walked);
+    free(ranks);
+    free(ids);
+    teardown_receipts();
+    bench_cleanup(path);
+    return status;
+}
+
+/**
+ * @brief Checks that the ordered store holds the list's nodes in list order
+ *
+ * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return uint8_t 1 if store and list agree, 0 otherwise
+ */
+uint8_t store_matches_list(Receipt *head){
+    if(!store_sync(head)) return 0;
+
+    StoreRun run;
+    Receipt *current = head;
+    size_t count = 0;
+    for(uint8_t more = ordered_store->seek(0, &run); more; more = ordered_store->next(&run)){
+        for(size_t i = 0; i < run.count; i++, count++){
+            if(current == NULL || run.items[i].node != current || run.items[i].id != current->id) return 0;
+            current = current->next;
+        }
+    }
+    return current == NULL && count == ordered_store->count();
+}
+
+/**
+ * @brief Benchmarks the ordered stores against each other
  *
- * Compares two strings character by character, ignoring case differences.
- * Returns the difference between the first mismatched characters.
+ * For shuffled corpora of 65535 and 262144 records, and for each store
+ * (the B+tree and the list with its sorted name table), times the build
+ * from a loaded list, BENCH_STORE_OPS inserts through
+ * insert_alphabetically(), an ordered scan of every record, BENCH_STORE_OPS
+ * selects by rank and the deletes of the inserted records through
+ * detach_receipt(). After each step the store is checked against the list.
  *
- * @param s1 First string to compare (const char*)
- * @param s2 Second string to compare (const char*)
- * @return int8_t Negative if s1 < s2, 0 if equal, positive if s1 > s2
+ * @return int Exit status (0 for success, 1 on mismatch or I/O failure)
  */
-int8_t case_insensitive_compare(const char *s1, const char *s2){
-    while(*s1 && *s2){
-        if(tolower((unsigned char) *s1) != tolower((unsigned char) *s2)){
-            return (tolower((unsigned char) *s1) - tolower((unsigned char) *s2));
+int bench_store(){
+    const size_t sizes[] = {65535, 262144};
+    const OrderedStore *stores[] = {&list_store, &btree_store};
+    const OrderedStore *saved_store = ordered_store;
+    int status = 0;
+
+    printf("%-8s %-6s %10s %12s %12s %10s %12s %12s\n", "records", "store", "build (ms)", "insert (ns)", "delete (ns)", "scan (ms)", "select (ns)", "memory (KiB)");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && status == 0; s++){
+        CorpusSpec spec = corpus_spec(sizes[s], 100);
+        char path[] = BENCH_TEMPLATE;
+        if(!bench_corpus_file(path, &spec)){
+            status = 1;
+            break;
         }
-        s1++;
-        s2++;
+
+        Receipt *head = load_receipts_threads(path, 1);
+        Receipt **fresh = malloc(BENCH_STORE_OPS * sizeof(Receipt*));
+        size_t *ranks = malloc(BENCH_STORE_OPS * sizeof(size_t));
+        if(fresh == NULL || ranks == NULL){
+            free(fresh);
+            free(ranks);
+            teardown_receipts();
+            bench_cleanup(path);
+            status = 1;
+            break;
+        }
+
+        for(size_t st = 0; st < sizeof(stores) / sizeof(stores[0]); st++){
+            select_ordered_store(stores[st]->name);
+            uint32_t state = CORPUS_DEFAULT_SEED;
+            struct timespec start;
+            size_t i;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            store_sync(head);
+            double build_ms = elapsed_ms(&start);
+            if(!store_matches_list(head)) status = 1;
+
+            // Inserts of new names, with IDs past the corpus
+            size_t made = 0;
+            for(i = 0; i < BENCH_STORE_OPS; i++){
+                fresh[i] = node_alloc();
+                if(fresh[i] == NULL) break;
+                memset(fresh[i], 0, sizeof(Receipt));
+                char name[LEN_NAME];
+                uint32_t len = CORPUS_NAME_MIN + xorshift32(&state) % (CORPUS_NAME_MAX - CORPUS_NAME_MIN + 1);
+                for(uint32_t c = 0; c < len; c++) name[c] = (char) ('a' + xorshift32(&state) % 26);
+                set_receipt_name(fresh[i], name, len);
+                fresh[i]->id = (uint32_t) (spec.count + i);
+                fresh[i]->body_off = -1;
+                made++;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < made; i++) head = insert_alphabetically(head, fresh[i]);
+            double insert_ms = elapsed_ms(&start);
+            if(!store_matches_list(head)) status = 1;
+
+            // Ordered scan of every record
+            StoreRun run;
+            size_t sum = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(uint8_t more = ordered_store->seek(0, &run); more; more = ordered_store->next(&run)){
+                for(size_t k = 0; k < run.count; k++) sum += run.items[k].id;
+            }
+            double scan_ms = elapsed_ms(&start);
+            if(sum == 0) status = 1;
+
+            // Selects by rank
+            size_t count = ordered_store->count();
+            for(i = 0; i < BENCH_STORE_OPS; i++) ranks[i] = xorshift32(&state) % count;
+            size_t found = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < BENCH_STORE_OPS; i++){
+                if(select_receipt(head, ranks[i]) != NULL) found++;
+            }
+            double select_ms = elapsed_ms(&start);
+            if(found != BENCH_STORE_OPS) status = 1;
+            size_t memory = (stores[st] == &btree_store) ? btree.nodes * BTREE_NODE_SIZE : name_table.capacity * sizeof(HotRecord);
+
+            // Deletes of the inserted records, in random order
+            for(i = made; i > 1; i--){
+                size_t k = xorshift32(&state) % i;
+                Receipt *tmp = fresh[i-1];
+                fresh[i-1] = fresh[k];
+                fresh[k] = tmp;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(i = 0; i < made; i++) head = detach_receipt(head, fresh[i]);
+            double delete_ms = elapsed_ms(&start);
+            if(!store_matches_list(head) || ordered_store->count() != spec.count) status = 1;
+            for(i = 0; i < made; i++) node_free(fresh[i]);
+
+            printf("%-8zu %-6s %10.2f %12.1f %12.1f %10.2f %12.1f %12zu\n", spec.count, stores[st]->name, build_ms,
+                   insert_ms * 1e6 / (double) (made ? made : 1), delete_ms * 1e6 / (double) (made ? made : 1),
+                   scan_ms, select_ms * 1e6 / BENCH_STORE_OPS, memory >> 10);
+        }
+
+        free(fresh);
+        free(ranks);
+        teardown_receipts();
+        bench_cleanup(path);
     }
-    return tolower((unsigned char) *s1) - tolower((unsigned char) *s2);
+
+    ordered_store = saved_store;
+    if(status != 0) custom_log(LOG_ERROR, "Ordered store disagrees with the list.\n");
+    return status;
 }
 
 /**
- * @brief Inserts a receipt into the list in alphabetical order by name
+ * @brief Benchmarks handle resolution and checks that stale handles are caught
  *
- * Maintains a doubly-linked list sorted alphabetically (case-insensitive).
- * Handles insertion at head, middle, or tail positions.
+ * Loads a shuffled 65535-record corpus, issues a handle for every record
+ * and times BENCH_HANDLE_OPS random resolutions with receipt_get() against
+ * reading the same records through raw pointers. Then deletes 10% of the
+ * records and creates as many new ones, which reuse the freed nodes and
+ * table slots, and checks that every deleted record's handle resolves to
+ * NULL while the others still resolve to their receipts.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @param new_receipt Pointer to the receipt to insert (Receipt*)
- * @return Receipt* Updated head pointer of the receipt list
+ * @return int Exit status (0 for success, 1 on a wrong resolution or I/O failure)
  */
-Receipt *insert_alphabetically(Receipt *head, Receipt *new_receipt){
-    // Case 1: Empty list
-    if(head == NULL){
-        new_receipt->next = NULL;
-        new_receipt->prev = NULL;
-        return new_receipt;
+int bench_handles(){
+    const size_t records = 65535;
+    const size_t churn = records / 10;
+    CorpusSpec spec = corpus_spec(records, 100);
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+
+    Receipt *head = load_receipts_threads(path, 1);
+    Receipt **nodes = malloc(records * sizeof(Receipt*));
+    ReceiptHandle *handles = malloc(records * sizeof(ReceiptHandle));
+    uint8_t *deleted = calloc(records, 1);
+    if(nodes == NULL || handles == NULL || deleted == NULL){
+        free(nodes);
+        free(handles);
+        free(deleted);
+        teardown_receipts();
+        bench_cleanup(path);
+        return 1;
     }
-    
-    // Case 2: New node goes at first position (head)
-    if(case_insensitive_compare(new_receipt->name, head->name) < 0){
-        new_receipt->prev = NULL;
-        new_receipt->next = head;
-        head->prev = new_receipt;
-        return new_receipt; // New node is now the head
+    size_t loaded = 0;
+    for(Receipt *cur = head; cur != NULL && loaded < records; cur = cur->next){
+        nodes[loaded] = cur;
+        handles[loaded] = receipt_handle(cur);
+        if(handles[loaded].slot == 0) status = 1;
+        loaded++;
     }
 
-    // Case 3: Middle or end
-    Receipt *current = head;
-    while(current->next != NULL && case_insensitive_compare(current->next->name, new_receipt->name) < 0){
-        current = current->next;
+    // Random reads of the ID, through raw pointers and through handles
+    uint32_t state = CORPUS_DEFAULT_SEED;
+    size_t raw_sum = 0, handle_sum = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_HANDLE_OPS && loaded > 0; i++){
+        raw_sum += nodes[xorshift32(&state) % loaded]->id;
     }
-    
-    // Insert new_receipt after current and before the current->next
-    new_receipt->prev = current;
-    new_receipt->next = current->next;
+    double raw_ms = elapsed_ms(&start);
+    state = CORPUS_DEFAULT_SEED;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < BENCH_HANDLE_OPS && loaded > 0; i++){
+        Receipt *node = receipt_get(handles[xorshift32(&state) % loaded]);
+        if(node != NULL) handle_sum += node->id;
+    }
+    double handle_ms = elapsed_ms(&start);
+    if(raw_sum != handle_sum) status = 1;
 
-    // Check if current->next exists
-    if(current->next != NULL){
-        current->next->prev = new_receipt;
+    // Delete 10%, then create as many records, which take over the freed nodes and slots
+    size_t removed = 0;
+    while(removed < churn && removed < loaded){
+        size_t k = xorshift32(&state) % loaded;
+        if(deleted[k]) continue;
+        head = detach_receipt(head, nodes[k]);
+        body_release(nodes[k]->receipt);
+        node_free(nodes[k]);
+        deleted[k] = 1;
+        removed++;
+    }
+    size_t reused = 0;
+    for(size_t i = 0; i < removed; i++){
+        Receipt *node = node_alloc();
+        if(node == NULL) break;
+        memset(node, 0, sizeof(Receipt));
+        char name[LEN_NAME];
+        set_receipt_name(node, name, (size_t) snprintf(name, sizeof(name), "Churn %zu", i));
+        node->id = (uint32_t) (records + i);
+        node->body_off = -1;
+        head = insert_alphabetically(head, node);
+        if(find_receipt(head, node->id) != node) status = 1;
+        for(size_t k = 0; k < loaded; k++){
+            if(deleted[k] && nodes[k] == node){
+                reused++;
+                break;
+            }
+        }
     }
-    current->next = new_receipt;
 
-    return head;
+    size_t stale = 0, live = 0, wrong = 0;
+    for(size_t k = 0; k < loaded; k++){
+        Receipt *node = receipt_get(handles[k]);
+        if(deleted[k]){
+            if(node == NULL) stale++;
+            else wrong++;
+        }
+        else if(node == nodes[k]) live++;
+        else wrong++;
+    }
+    if(wrong > 0) status = 1;
+
+    printf("%zu records, %d random reads each\n", loaded, BENCH_HANDLE_OPS);
+    printf("%-24s %12s %12s\n", "read", "total (ms)", "per op (ns)");
+    printf("%-24s %12.2f %12.2f\n", "raw pointer", raw_ms, raw_ms * 1e6 / BENCH_HANDLE_OPS);
+    printf("%-24s %12.2f %12.2f\n", "handle", handle_ms, handle_ms * 1e6 / BENCH_HANDLE_OPS);
+    printf("After deleting and re-creating %zu records (%zu nodes reused): %zu handles stale, %zu live, %zu wrong\n",
+           removed, reused, stale, live, wrong);
+    printf("Node table: %u slots, %u live\n", node_table.count, node_table.live);
+
+    free(nodes);
+    free(handles);
+    free(deleted);
+    teardown_receipts();
+    bench_cleanup(path);
+    if(status != 0) custom_log(LOG_ERROR, "A handle resolved to the wrong receipt.\n");
+    return status;
 }
 
 /**
- * @brief Detaches a receipt node from the linked list
+ * @brief Checks that two lists hold the same receipts in the same order
  *
- * Removes a node from the doubly-linked list by updating neighboring
- * nodes' pointers. Does not free the node's memory. Handles edge cases
- * for head, tail, and middle nodes.
+ * @param a Pointer to the head of the first list (Receipt*)
+ * @param b Pointer to the head of the second list (Receipt*)
+ * @return uint8_t 1 if IDs, names and bodies all match, 0 otherwise
+ */
+uint8_t lists_match(Receipt *a, Receipt *b){
+    while(a != NULL && b != NULL){
+        const char *body_a = receipt_body(a);
+        const char *body_b = receipt_body(b);
+        if(a->id != b->id || strcmp(a->name, b->name) != 0 || body_a == NULL || body_b == NULL
+           || a->body_len != b->body_len || memcmp(body_a, body_b, a->body_len) != 0){
+            return 0;
+        }
+        a = a->next;
+        b = b->next;
+    }
+    return a == NULL && b == NULL;
+}
+
+/**
+ * @brief Benchmarks journaled updates and deletes against full rewrites
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @param node Pointer to the node to detach (Receipt*)
- * @return Receipt* Updated head pointer of the receipt list
+ * For shuffled corpora of 10000 and 65535 records, times BENCH_JOURNAL_OPS
+ * body updates through update_receipt() and as many deletes through
+ * delete_receipt(), which append to the journal (in-place patching is
+ * off, see bench_patch()), against
+ * BENCH_REWRITE_OPS calls of rewrite_receipts_to_file(), which each of
+ * them used to make. Bytes written per operation are taken from the file
+ * sizes. Before the rewrites, the corpus is loaded again from the index
+ * and the journal replayed onto it with journal_replay(), which is timed,
+ * and the result is checked against the list in memory. So is a load
+ * after a torn record has been appended to the journal, which must also
+ * cut the journal back to its last good record.
+ *
+ * @return int Exit status (0 for success, 1 on a replay mismatch or I/O failure)
  */
-Receipt *detach_receipt(Receipt *head, Receipt *node){
-    if(head == NULL || node == NULL) return head;
+int bench_journal(){
+    const size_t sizes[] = {10000, 65535};
+    const char *saved_path = receipts_path;
+    char body[CORPUS_BODY_MAX + 1];
+    int status = 0;
 
-    // 1. Deataching the head
-    if(head == node){
-        head = node->next;
-    }
+    memset(body, 'b', CORPUS_BODY_MAX);
+    patch_in_place = 0;
+    printf("%-8s %-8s %8s %12s %12s\n", "records", "op", "ops", "per op (us)", "bytes/op");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && status == 0; s++){
+        CorpusSpec spec = corpus_spec(sizes[s], 100);
+        char path[] = BENCH_TEMPLATE;
+        char journal[LEN_PATH];
+        if(!bench_corpus_file(path, &spec)){
+            status = 1;
+            break;
+        }
+        receipts_path = path;
+        sidecar_path(journal, sizeof(journal), path, JOURNAL_EXT);
 
-    // 2. Update NEXT node's 'prev' pointer
-    if(node->next != NULL){
-        node->next->prev = node->prev;
-    }
+        Receipt *head = load_receipts();
+        uint32_t state = CORPUS_DEFAULT_SEED;
+        struct timespec start;
+        struct stat st;
+        size_t i;
 
-    // 3. Update PREV node's 'next' pointer
-    if(node->prev != NULL){
-        node->prev->next = node->next;
-    }
+        // Updates of random records with a new body
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < BENCH_JOURNAL_OPS; i++){
+            uint32_t len = CORPUS_BODY_MIN + xorshift32(&state) % (CORPUS_BODY_MAX - CORPUS_BODY_MIN + 1);
+            body[len] = '\0';
+            head = update_receipt(head, xorshift32(&state) % (uint32_t) spec.count, NULL, body);
+            body[len] = 'b';
+        }
+        double update_ms = elapsed_ms(&start);
+        off_t update_bytes = (stat(journal, &st) == 0) ? st.st_size : 0;
 
-    // 4. Cleanup node links
-    node->next = NULL;
-    node->prev = NULL;
+        // Deletes of evenly spread records
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < BENCH_JOURNAL_OPS; i++){
+            head = delete_receipt(head, (uint32_t) (i * (spec.count / BENCH_JOURNAL_OPS)));
+        }
+        double delete_ms = elapsed_ms(&start);
+        off_t journal_bytes = (stat(journal, &st) == 0) ? st.st_size : 0;
 
-    return head;
+        // Load again from the index with the journal moved aside, then replay it
+        char aside[LEN_PATH + 8];
+        snprintf(aside, sizeof(aside), "%s.tmp", journal);
+        if(rename(journal, aside) != 0) status = 1;
+        Receipt *reloaded = load_receipts();
+        if(rename(aside, journal) != 0) status = 1;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        reloaded = journal_replay(reloaded, path);
+        double replay_ms = elapsed_ms(&start);
+        if(!lists_match(head, reloaded)) status = 1;
+        free_list(reloaded);
+
+        // A torn tail, whose lengths run past the end of the file, is cut off on load
+        JournalRecord torn = {JOURNAL_UPSERT, 0, 20, 200000, 0};
+        int fd = open(journal, O_WRONLY | O_APPEND);
+        if(fd < 0 || write(fd, &torn, sizeof(torn)) != (ssize_t) sizeof(torn)
+           || write(fd, "torn!", 5) != 5){
+            status = 1;
+        }
+        if(fd >= 0) close(fd);
+        reloaded = load_receipts();
+        if(!lists_match(head, reloaded) || stat(journal, &st) != 0 || st.st_size != journal_bytes){
+            status = 1;
+        }
+        free_list(reloaded);
+
+        // What each update and delete cost before the journal
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < BENCH_REWRITE_OPS; i++){
+            if(!rewrite_receipts_to_file(head)) status = 1;
+        }
+        double rewrite_ms = elapsed_ms(&start);
+        off_t rewrite_bytes = (stat(path, &st) == 0) ? st.st_size : 0;
+        if(access(journal, F_OK) == 0) status = 1;
+
+        printf("%-8zu %-8s %8d %12.1f %12.0f\n", spec.count, "update", BENCH_JOURNAL_OPS,
+               update_ms * 1e3 / BENCH_JOURNAL_OPS, (double) update_bytes / BENCH_JOURNAL_OPS);
+        printf("%-8zu %-8s %8d %12.1f %12.0f\n", spec.count, "delete", BENCH_JOURNAL_OPS,
+               delete_ms * 1e3 / BENCH_JOURNAL_OPS, (double) (journal_bytes - update_bytes) / BENCH_JOURNAL_OPS);
+        printf("%-8zu %-8s %8d %12.1f %12.0f\n", spec.count, "replay", 2 * BENCH_JOURNAL_OPS,
+               replay_ms * 1e3 / (2 * BENCH_JOURNAL_OPS), (double) journal_bytes / (2 * BENCH_JOURNAL_OPS));
+        printf("%-8zu %-8s %8d %12.1f %12.0f\n", spec.count, "rewrite", BENCH_REWRITE_OPS,
+               rewrite_ms * 1e3 / BENCH_REWRITE_OPS, (double) rewrite_bytes);
+
+        free_list(head);
+        bench_cleanup(path);
+    }
+
+    receipts_path = saved_path;
+    patch_in_place = 1;
+    if(status != 0) custom_log(LOG_ERROR, "Journal replay does not match the list.\n");
+    return status;
 }
 
 /**
- * @brief Updates an existing receipt's name and/or content
+ * @brief Benchmarks background compaction
  *
- * Searches for a receipt by ID and updates its fields. If the name changes,
- * the receipt is detached and re-inserted to maintain alphabetical order.
- * Rewrites the file to persist changes.
+ * Loads a shuffled 65535-record corpus and updates random records, all
+ * journaled (in-place patching is off), until compaction_due() fires. Then times BENCH_COMPACT_OPS updates with no
+ * compaction running, and as many while one runs, which makes that
+ * compaction discard its result. A second compaction is left alone and
+ * swapped in; the time compaction_finish() spends on the calling thread is
+ * reported apart from the worker's. Finally the journal must be gone and a
+ * reload must match the list in memory.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @param receipt_id The ID of the receipt to update (uint16_t)
- * @param name New name for the recipe, or NULL/empty to keep current (const char*)
- * @param receipt New content, or NULL/empty to keep current (const char*)
- * @return Receipt* Updated head pointer of the receipt list
+ * @return int Exit status (0 for success, 1 on a mismatch or I/O failure)
  */
-Receipt *update_receipt(Receipt *head, uint16_t receipt_id, const char *name, const char *receipt){
-    if(name == NULL && receipt == NULL){
-        custom_log(LOG_INFO, "No changes were made.\n");
-        return head;
-    }
+int bench_compact(){
+    const char *saved_path = receipts_path;
+    char body[CORPUS_BODY_MAX + 1];
+    char path[] = BENCH_TEMPLATE;
+    char sidecar[LEN_PATH];
+    int status = 0;
+    CorpusSpec spec = corpus_spec(65535, 100);
 
-    char msg[LEN_LOG_MSG];
-    snprintf(msg, sizeof(msg), "Searching for ID: %d...\n", receipt_id);
-    custom_log(LOG_DEBUG, msg);
+    if(!bench_corpus_file(path, &spec)) return 1;
+    receipts_path = path;
+    memset(body, 'b', CORPUS_BODY_MAX);
+    memset(&compaction_totals, 0, sizeof(compaction_totals));
+    patch_in_place = 0;
 
-    Receipt *current = head;
-    uint16_t found = 0, name_changed = 0;
-    while(current != NULL){
-        if(current->id == receipt_id){
-            found = 1;
-            // Update name
-            if(name != NULL && name[0] != '\0'){
-                if(strcmp(name, current->name) != 0){
-                    strncpy(current->name, name, LEN_NAME-1);
-                    current->name[LEN_NAME-1] = '\0';  // Ensure null-termination
-                    name_changed = 1;
-                }
-            }
+    Receipt *head = load_receipts();
+    uint32_t state = CORPUS_DEFAULT_SEED;
+    struct timespec start;
+    size_t i;
 
-            // Update receipt
-            if(receipt != NULL && receipt[0] != '\0'){
-                strncpy(current->receipt, receipt, LEN_REC-1);
-                current->receipt[LEN_REC-1] = '\0';  // Ensure null-termination
-            }
-            break;
-        }
-        current = current->next;
+    // Updates with new bodies until enough of the files is dead
+    size_t updates = 0;
+    while(!compaction_due() && updates < 4 * spec.count){
+        uint32_t len = CORPUS_BODY_MIN + xorshift32(&state) % (CORPUS_BODY_MAX - CORPUS_BODY_MIN + 1);
+        body[len] = '\0';
+        head = update_receipt(head, xorshift32(&state) % (uint32_t) spec.count, NULL, body);
+        body[len] = 'b';
+        updates++;
     }
+    printf("%zu records: compaction due after %zu updates (%llu KiB dead)\n",
+           spec.count, updates, (unsigned long long) compaction.dead_bytes >> 10);
 
-    if(!found){
-        custom_log(LOG_WARN, "Receipt ID not found.\n");
+    // Update latency without and with a compaction running
+    double update_ms[2] = {0, 0};
+    uint8_t swapped[2] = {0, 0};
+    for(int run = 0; run < 2; run++){
+        if(run == 1 && !compaction_start(head)) status = 1;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < BENCH_COMPACT_OPS; i++){
+            uint32_t len = CORPUS_BODY_MIN + xorshift32(&state) % (CORPUS_BODY_MAX - CORPUS_BODY_MIN + 1);
+            body[len] = '\0';
+            head = update_receipt(head, xorshift32(&state) % (uint32_t) spec.count, NULL, body);
+            body[len] = 'b';
+        }
+        update_ms[run] = elapsed_ms(&start);
+        if(run == 1) swapped[0] = compaction_finish(head);
     }
 
-    if(name_changed){
-        head = detach_receipt(head, current);
-        head = insert_alphabetically(head, current);
-        custom_log(LOG_INFO, "Receipt updated and re-sorted.\n");
-    }
-    else{
-        custom_log(LOG_INFO, "Receipt updated (order unchanged).\n");
-    }
-    rewrite_receipts_to_file(head);
-    return head;
+    // A compaction nobody interferes with
+    if(!compaction_start(head)) status = 1;
+    while(atomic_load(&compaction.state) == COMPACT_RUNNING) poll(NULL, 0, 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    swapped[1] = compaction_finish(head);
+    double swap_ms = elapsed_ms(&start);
+    if(swapped[0] || !swapped[1]) status = 1;
+
+    sidecar_path(sidecar, sizeof(sidecar), path, JOURNAL_EXT);
+    if(access(sidecar, F_OK) == 0) status = 1;
+    Receipt *reloaded = load_receipts();
+    if(!lists_match(head, reloaded)) status = 1;
+    free_list(reloaded);
+
+    printf("%-36s %12s\n", "update", "per op (us)");
+    printf("%-36s %12.1f\n", "idle", update_ms[0] * 1e3 / BENCH_COMPACT_OPS);
+    printf("%-36s %12.1f\n", "while compacting (result discarded)", update_ms[1] * 1e3 / BENCH_COMPACT_OPS);
+    printf("Swap on the menu thread: %.2f ms\n", swap_ms);
+    print_compaction_stats("Compactions:");
+
+    free_list(head);
+    bench_cleanup(path);
+    receipts_path = saved_path;
+    patch_in_place = 1;
+    if(status != 0) custom_log(LOG_ERROR, "Compaction did not swap in, or lost a change.\n");
+    return status;
 }
 
 /**
- * @brief Deletes a receipt from the list by ID
+ * @brief Writes a list to a text file through stdio, one fprintf() per line
  *
- * Searches for a receipt with the given ID, detaches it from the list,
- * frees its memory, and rewrites the file to persist the deletion.
+ * This is the writer rewrite_receipts_to_file() used before
+ * write_receipts_file(), kept as the rewrite benchmark's baseline. Bodies
+ * must be in memory.
  *
  * @param head Pointer to the head of the receipt list (Receipt*)
- * @param receipt_id The ID of the receipt to delete (uint16_t)
- * @return Receipt* Updated head pointer of the receipt list
+ * @param path File to create or truncate (const char*)
+ * @return uint8_t 1 on success, 0 on failure
  */
-Receipt *delete_receipt(Receipt *head, uint16_t receipt_id){
-    if(head == NULL){
-        custom_log(LOG_WARN, "List is empty, nothing to delete.\n");
-        return NULL;
+uint8_t write_receipts_stdio(Receipt *head, const char *path){
+    FILE *fptr = fopen(path, "w");
+    if(fptr == NULL) return 0;
+
+    for(Receipt *current = head; current != NULL; current = current->next){
+        fprintf(fptr, "Name: %s\n", current->name);
+        fprintf(fptr, "Id: %u\n", current->id);
+        fprintf(fptr, "Receipt: %.*s\n", (int) current->body_len, current->receipt);
     }
+    uint8_t ok = !ferror(fptr);
+    if(fclose(fptr) != 0) ok = 0;
+    return ok;
+}
 
-    Receipt *current = head;
+/**
+ * @brief Benchmarks the text file writer
+ *
+ * For shuffled corpora of 65535 and 262144 records, loaded eagerly, times
+ * the old stdio writer, write_receipts_file() without and with fsync(),
+ * and the whole rewrite_receipts_to_file() (file fsync, rename, directory
+ * fsync, snapshot and index), best of BENCH_REWRITE_RUNS each. The
+ * buffered writer's output is checked to be byte-identical to the stdio
+ * writer's.
+ *
+ * @return int Exit status (0 for success, 1 on different output or I/O failure)
+ */
+int bench_rewrite(){
+    const size_t sizes[] = {65535, 262144};
+    const char *saved_path = receipts_path;
+    int status = 0;
 
-    while(current != NULL){
-        if(current->id == receipt_id) break;
-        current = current->next;
-    }
+    printf("%-8s %-22s %10s %10s\n", "records", "writer", "best (ms)", "MB/s");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && status == 0; s++){
+        CorpusSpec spec = corpus_spec(sizes[s], 100);
+        char path[] = BENCH_TEMPLATE;
+        char out[LEN_PATH + 8];
+        if(!bench_corpus_file(path, &spec)){
+            status = 1;
+            break;
+        }
+        snprintf(out, sizeof(out), "%s.out", path);
 
-    if(current == NULL){
-        char msg[LEN_LOG_MSG];
-        snprintf(msg, sizeof(msg), "Receipt ID %d not found.\n", receipt_id);
-        custom_log(LOG_WARN, msg);
-        return head;
-    }
+        Receipt *head = load_receipts_threads(path, 1);
+        off_t *offsets = malloc(spec.count * sizeof(off_t));
+        if(offsets == NULL){
+            teardown_receipts();
+            bench_cleanup(path);
+            status = 1;
+            break;
+        }
 
-    // Unlink from neighbors
-    head = detach_receipt(head, current);
+        const char *writers[] = {"stdio fprintf()", "buffered", "buffered + fsync", "rewrite_receipts_to_file"};
+        double best[4];
+        uint64_t stdio_hash = 0, buffered_hash = 0;
+        receipts_path = path;
+        for(int w = 0; w < 4; w++){
+            best[w] = -1;
+            for(int run = 0; run < BENCH_REWRITE_RUNS; run++){
+                struct timespec start;
+                uint8_t ok = 0;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                if(w == 0) ok = write_receipts_stdio(head, out);
+                else if(w == 1) ok = write_receipts_file(head, out, NULL, 0, offsets, 0);
+                else if(w == 2) ok = write_receipts_file(head, out, NULL, 0, offsets, 1);
+                else ok = rewrite_receipts_to_file(head);
+                double ms = elapsed_ms(&start);
+                if(!ok) status = 1;
+                if(best[w] < 0 || ms < best[w]) best[w] = ms;
+            }
+            if(w == 0 && !hash_file(out, &stdio_hash)) status = 1;
+            if(w == 1 && !hash_file(out, &buffered_hash)) status = 1;
+        }
+        if(stdio_hash != buffered_hash) status = 1;
 
-    // Update file
-    rewrite_receipts_to_file(head);
+        double mb = (double) file_bytes(out) / 1e6;
+        for(int w = 0; w < 4; w++){
+            printf("%-8zu %-22s %10.2f %10.1f\n", spec.count, writers[w], best[w], mb * 1e3 / best[w]);
+        }
 
-    // Cleanup node
-    free(current);
+        free(offsets);
+        teardown_receipts();
+        unlink(out);
+        bench_cleanup(path);
+    }
 
-    return head;
+    receipts_path = saved_path;
+    if(status != 0) custom_log(LOG_ERROR, "Buffered writer output differs, or a write failed.\n");
+    return status;
 }
 
 /**
- * @brief Displays the full details of a specific receipt
+ * @brief Appends one receipt with fopen(), fwrite() and fclose()
  *
- * Searches for a receipt by ID and prints its name and content to stdout.
- * Logs an error if the receipt is not found.
+ * This is save_receipt_to_file() before the append writer, kept as the
+ * append benchmark's baseline: the file is opened and closed and the index
+ * updated for every receipt, and nothing is flushed to disk.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
- * @param receipt_id The ID of the receipt to view (uint16_t)
+ * @param r Pointer to the receipt to save (Receipt*)
+ * @return uint8_t 1 on success, 0 on failure
  */
-void view_receipt(Receipt *head, uint16_t receipt_id){
-    if(head == NULL){
-        custom_log(LOG_WARN, "Receipt list is empty, nothing to view.\n");
-        return;
-    }
+uint8_t save_receipt_stdio(Receipt *r){
+    size_t name_len = strlen(r->name);
+    size_t id_len = (size_t) snprintf(NULL, 0, "Id: %u\n", r->id);
+    size_t len = LEN_PREFIX_NAME + name_len + 1 + id_len + LEN_PREFIX_RECEIPT + r->body_len + 1;
+    char *record = malloc(len + 1);
+    if(record == NULL) return 0;
+    snprintf(record, len + 1, "Name: %s\nId: %u\nReceipt: %s\n", r->name, r->id, r->receipt);
 
-    Receipt *current = head;
-    while(current != NULL){
-        if(current->id == receipt_id) break;
-        current = current->next;
+    FILE *fptr = fopen(receipts_path, "a");
+    if(fptr == NULL){
+        free(record);
+        return 0;
     }
 
-    if(current == NULL){
-        char msg[LEN_LOG_MSG];
-        snprintf(msg, sizeof(msg), "Receipt ID '%d' not found.\n", receipt_id);
-        custom_log(LOG_ERROR, msg);
-        return;
-    }
+    struct stat before;
+    uint8_t have_before = (fstat(fileno(fptr), &before) == 0);
+    uint8_t ok = (fwrite(record, 1, len, fptr) == len);
+    if(fclose(fptr) != 0) ok = 0;
 
-    printf("\n\t[%d] %s\n\n", current->id, current->name);
-    printf("\t%s\n", current->receipt);
+    if(ok && have_before){
+        r->body_off = before.st_size + (off_t) (LEN_PREFIX_NAME + name_len + 1 + id_len + LEN_PREFIX_RECEIPT);
+        track_own_append(&before, len);
+        index_append(receipts_path, &r, 1, &before);
+    }
+    free(record);
+    return ok;
 }
 
 /**
- * @brief Displays a summary list of all receipts
+ * @brief Benchmarks the append writer's durability policies
  *
- * Prints a formatted list showing the ID and name of each receipt.
- * Displays a message if the list is empty.
+ * On a shuffled 10000-record corpus with an index, creates
+ * BENCH_APPEND_OPS receipts per mode: the old open/write/close per
+ * receipt, then create_receipt() with every-op durability, commit windows
+ * of BENCH_APPEND_MS, and durability on exit. Each mode's time includes
+ * its final commit. Reports the time per receipt and the write() and
+ * fsync calls made, then checks that the list reloads the same from the
+ * index and from a parse of the text.
  *
- * @param r Pointer to the head of the receipt list (Receipt*)
+ * @return int Exit status (0 for success, 1 on a mismatch or I/O failure)
  */
-void display_receipts(Receipt *r){
-    if(r == NULL){
-        custom_log(LOG_INFO, "The cookbook is empty!\n");
-        return;
-    }
-    Receipt *current = r;
-    printf("[ID] Receipt name\n");
-    while(current != NULL){
-        printf("- [%d] %s\n", current->id, current->name);
-        current = current->next;
+int bench_append(){
+    const char *saved_path = receipts_path;
+    const char *modes[] = {"fopen/fclose per add", "always", "interval", "exit"};
+    const char *body = "Mix the flour and the butter, rest for an hour, then bake until golden.";
+    AppendWriter saved = appender;
+    char path[] = BENCH_TEMPLATE;
+    int status = 0;
+    CorpusSpec spec = corpus_spec(10000, 100);
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+    receipts_path = path;
+    Receipt *head = load_receipts();
+
+    printf("%-22s %12s %10s %8s\n", "writer", "per add (us)", "write()s", "fsyncs");
+    for(int m = 0; m < 4; m++){
+        append_close();
+        appender.durability = (m == 3) ? DURABLE_ON_EXIT : (m == 2) ? DURABLE_INTERVAL : DURABLE_EVERY_OP;
+        appender.interval_ms = BENCH_APPEND_MS;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t i = 0; i < BENCH_APPEND_OPS; i++){
+            char name[LEN_NAME];
+            snprintf(name, sizeof(name), "Bench %d-%zu", m, i);
+            if(m > 0){
+                head = create_receipt(head, name, body);
+                continue;
+            }
+
+            // create_receipt() as it was, with the old writer
+            Receipt *r = node_alloc();
+            if(r == NULL){
+                status = 1;
+                break;
+            }
+            memset(r, 0, sizeof(Receipt));
+            set_receipt_name(r, name, strlen(name));
+            if(!set_receipt_body(r, body, strlen(body))){
+                node_free(r);
+                status = 1;
+                break;
+            }
+            r->id = get_new_id(head);
+            head = insert_alphabetically(head, r);
+            if(!save_receipt_stdio(r)) status = 1;
+        }
+        if(m > 0 && !append_commit()) status = 1;
+        double ms = elapsed_ms(&start);
+
+        if(m == 0) printf("%-22s %12.1f %10d %8d\n", modes[m], ms * 1e3 / BENCH_APPEND_OPS, BENCH_APPEND_OPS, 0);
+        else printf("%-22s %12.1f %10zu %8zu\n", modes[m], ms * 1e3 / BENCH_APPEND_OPS, appender.writes, appender.syncs);
     }
+    append_close();
+
+    // Reload from the index (kept current by every batch), then from the text
+    Receipt *reloaded = load_receipts();
+    if(!lists_match(head, reloaded)) status = 1;
+    free_list(reloaded);
+    reloaded = load_receipts_threads(path, 1);
+    if(!lists_match(head, reloaded)) status = 1;
+    free_list(reloaded);
+
+    free_list(head);
+    bench_cleanup(path);
+    receipts_path = saved_path;
+    appender = saved;
+    if(status != 0) custom_log(LOG_ERROR, "Appended receipts did not reload, or a write failed.\n");
+    return status;
 }
 
 /**
- * @brief Frees all memory allocated for the receipt linked list
+ * @brief Benchmarks in-place patching of updated bodies
  *
- * Traverses the entire linked list and frees each node's memory.
- * Should be called before program exit to prevent memory leaks.
+ * On a shuffled 65535-record corpus, shortens the bodies of
+ * BENCH_PATCH_OPS random records through update_receipt() with patching
+ * off (every update journaled). A full rewrite then folds the journal in
+ * and writes a snapshot, as it does in use, and the bodies of as many
+ * other records are shortened with patching on, then grown back to their
+ * old length, into their slack. Reports time, the share patched in place
+ * and bytes written per update (patches and journal records). Patching
+ * must not be held off by the snapshot; afterwards the snapshot must be
+ * gone, the text file must have kept its size since the rewrite, the
+ * index must match its content hash, and the list must reload the same
+ * from the index and from a parse of the text, journal replayed.
  *
- * @param head Pointer to the head of the receipt list (Receipt*)
+ * @return int Exit status (0 for success, 1 on a mismatch or I/O failure)
  */
-void free_list(Receipt *head){
-    Receipt *tmp;
-    while(head != NULL){
-        tmp = head;
-        head = head->next;
-        free(tmp);
+int bench_patch(){
+    const char *saved_path = receipts_path;
+    const char *runs[] = {"journal (--no-patch)", "patch, shorter", "patch, back to length"};
+    char body[CORPUS_BODY_MAX + 1];
+    char path[] = BENCH_TEMPLATE;
+    char journal[LEN_PATH];
+    char sidecar[LEN_PATH];
+    uint32_t ids[BENCH_PATCH_OPS];
+    uint32_t lens[BENCH_PATCH_OPS];
+    int status = 0;
+    CorpusSpec spec = corpus_spec(65535, 100);
+
+    if(!bench_corpus_file(path, &spec)) return 1;
+    receipts_path = path;
+    sidecar_path(journal, sizeof(journal), path, JOURNAL_EXT);
+    memset(body, 'p', CORPUS_BODY_MAX);
+    memset(&patch_totals, 0, sizeof(patch_totals));
+
+    Receipt *head = load_receipts();
+    uint64_t size_before = 0;
+    uint32_t state = CORPUS_DEFAULT_SEED;
+
+    printf("%-22s %8s %12s %9s %10s\n", "update", "ops", "per op (us)", "in place", "bytes/op");
+    for(int run = 0; run < 3; run++){
+        if(run == 1){
+            // Patches start right after a rewrite, with its snapshot in place
+            if(!rewrite_receipts_to_file(head)) status = 1;
+            sidecar_path(sidecar, sizeof(sidecar), path, SNAPSHOT_EXT);
+            if(access(sidecar, F_OK) != 0) status = 1;
+            size_before = file_bytes(path);
+        }
+        patch_in_place = (run > 0);
+        PatchStats was = patch_totals;
+        uint64_t journal_was = file_bytes(journal);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t i = 0; i < BENCH_PATCH_OPS; i++){
+            if(run < 2){
+                // Odd IDs for the journal, even ones for the patches
+                ids[i] = (xorshift32(&state) % (uint32_t) (spec.count / 2)) * 2 + (run == 0);
+                Receipt *r = find_receipt(head, ids[i]);
+                if(r == NULL) continue;
+                lens[i] = r->body_len;
+                uint32_t len = r->body_len - 1 - xorshift32(&state) % 16;
+                body[(len > 0) ? len : 1] = '\0';
+                head = update_receipt(head, ids[i], NULL, body);
+                body[(len > 0) ? len : 1] = 'p';
+            }
+            else{
+                body[lens[i]] = '\0';
+                head = update_receipt(head, ids[i], NULL, body);
+                body[lens[i]] = 'p';
+            }
+        }
+        double ms = elapsed_ms(&start);
+
+        uint64_t bytes = (patch_totals.bytes - was.bytes) + (file_bytes(journal) - journal_was);
+        size_t patched = patch_totals.patched - was.patched;
+        printf("%-22s %8d %12.1f %8.1f%% %10.0f\n", runs[run], BENCH_PATCH_OPS, ms * 1e3 / BENCH_PATCH_OPS,
+               100.0 * (double) patched / BENCH_PATCH_OPS, (double) bytes / BENCH_PATCH_OPS);
+        if(run > 0 && patched < BENCH_PATCH_OPS / 2) status = 1;
+    }
+    patch_in_place = 1;
+
+    // The first patch drops the stale snapshot
+    sidecar_path(sidecar, sizeof(sidecar), path, SNAPSHOT_EXT);
+    if(access(sidecar, F_OK) == 0) status = 1;
+
+    // Patches keep the file's size and the index's hash current
+    IndexHeader header;
+    uint64_t hash = 0;
+    sidecar_path(sidecar, sizeof(sidecar), path, INDEX_EXT);
+    FILE *fptr = fopen(sidecar, "rb");
+    if(fptr == NULL || fread(&header, sizeof(header), 1, fptr) != 1
+       || !hash_file_blocks(path, &hash) || header.source_hash != hash){
+        status = 1;
     }
+    if(fptr != NULL) fclose(fptr);
+    if(file_bytes(path) != size_before) status = 1;
+
+    Receipt *reloaded = load_receipts();
+    if(!lists_match(head, reloaded)) status = 1;
+    free_list(reloaded);
+    reloaded = journal_replay(load_receipts_threads(path, 1), path);
+    if(!lists_match(head, reloaded)) status = 1;
+    free_list(reloaded);
+
+    free_list(head);
+    bench_cleanup(path);
+    receipts_path = saved_path;
+    if(status != 0) custom_log(LOG_ERROR, "Updates were not patched, or the patched file does not reload the same.\n");
+    return status;
 }